@@ -53,6 +53,20 @@ void StopParamService(void);
  */
 int LoadDefaultParams(const char *fileName, unsigned int mode);
 
+/**
+ * Init 接口
+ * 加载编译时生成的参数镜像，镜像与参数文件不一致时返回失败，需要重新加载默认参数
+ *
+ */
+int LoadParamImage(const char *fileName);
+
+/**
+ * Init 接口
+ * 将已加载的参数保存为参数镜像，paths为生成镜像时加载的参数文件或目录
+ *
+ */
+int SaveParamImage(const char *fileName, const char *paths[], unsigned int count);
+
 /**
  * Init 接口
  * 加载默认参数。
@@ -67,6 +81,13 @@ int LoadPersistParams(void);
  */
 int SystemWriteParam(const char *name, const char *value);
 
+/**
+ * Init 接口
+ * 删除参数，只读参数不能删除，参数不存在时返回 PARAM_CODE_NOT_FOUND。
+ *
+ */
+int SystemDeleteParam(const char *name);
+
 /**
  * Init 接口
  * 查询参数。
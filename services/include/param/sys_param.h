@@ -36,6 +36,14 @@ extern "C" {
  */
 int SystemSetParameter(const char *name, const char *value);
 
+/**
+ * 对外接口
+ * 删除参数，只读参数不能删除，参数不存在时返回 PARAM_CODE_NOT_FOUND。
+ * 删除后参数可以重新设置，已获取的 handle 读取时返回 PARAM_CODE_NOT_FOUND。
+ *
+ */
+int SystemDeleteParameter(const char *name);
+
 /**
  * 对外接口
  * 查询参数，主要用于其他进程使用，需要给定足够的内存保存参数。
@@ -45,6 +53,40 @@ int SystemSetParameter(const char *name, const char *value);
  */
 int SystemGetParameter(const char *name, char *value, unsigned int *len);
 
+/**
+ * 对外接口
+ * 批量查询参数，一次最多查询 PARAM_BATCH_MAX 个参数，每个安全标签只校验一次权限。
+ * 返回的参数值来自同一时刻，不存在的参数 lens[i] 为0，并返回 PARAM_CODE_NOT_FOUND。
+ * 如果 values[i] == null，获取对应value的长度
+ *
+ */
+#define PARAM_BATCH_MAX 64
+int SystemGetParameters(const char *names[], char *values[], unsigned int lens[], unsigned int count);
+
+/**
+ * 对外接口
+ * 批量设置参数，一次最多设置 PARAM_BATCH_MAX 个参数，按顺序生效，持久化和触发器只处理一次。
+ * results 不为 null 时返回每个参数的设置结果，函数返回第一个失败的结果。
+ *
+ */
+int SystemSetParameters(const char *names[], const char *values[], int results[], unsigned int count);
+
+/**
+ * 对外接口
+ * 异步设置、等待参数，调用不阻塞，结果通过 callback 返回。
+ * 异步请求使用独立的连接，调用者通过 SystemGetParameterEventFd 获取事件 fd 并加入自己的事件循环，
+ * fd 可读时调用 SystemProcessParameterEvents，callback 在该调用中执行。
+ * 等待成功时 value 为参数值，超时 result 为 PARAM_CODE_TIMEOUT。
+ * 事件 fd 在客户端初始化时创建，重新连接后保持不变；连接断开时未完成的请求以 PARAM_CODE_FAIL_CONNECT 回调。
+ *
+ */
+typedef void (*ParameterAsyncCallback)(const char *name, const char *value, int result, void *context);
+int SystemSetParameterAsync(const char *name, const char *value, ParameterAsyncCallback callback, void *context);
+int SystemWaitParameterAsync(const char *name, const char *value, int32_t timeout,
+    ParameterAsyncCallback callback, void *context);
+int SystemGetParameterEventFd(void);
+int SystemProcessParameterEvents(void);
+
 /**
  * 对外接口
  * 查询参数，主要用于其他进程使用，找到对应属性的handle。
@@ -60,6 +102,18 @@ int SystemFindParameter(const char *name, ParamHandle *handle);
  */
 int SystemGetParameterCommitId(ParamHandle handle, uint32_t *commitId);
 
+/**
+ * 对外接口
+ * 缓存参数的handle和权限检查结果，重复读取时不再解析参数名。
+ * 只有参数所在区域的标签发生变化时，CachedParameterGet 才重新查找和校验权限。
+ * 不再使用时需要调用 CachedParameterDestroy 释放。
+ *
+ */
+typedef void *CachedHandle;
+CachedHandle CachedParameterCreate(const char *name);
+int CachedParameterGet(CachedHandle handle, char *value, unsigned int *len);
+void CachedParameterDestroy(CachedHandle handle);
+
 /**
  * 外部接口
  * 遍历参数。
@@ -67,6 +121,17 @@ int SystemGetParameterCommitId(ParamHandle handle, uint32_t *commitId);
  */
 int SystemTraversalParameter(void (*traversalParameter)(ParamHandle handle, void *cookie), void *cookie);
 
+/**
+ * 外部接口
+ * 按前缀逐个遍历参数，prefix为完整的段路径，如 "const.product"，NULL 遍历全部参数。
+ * SystemTraversalParameterNext 遍历结束时返回 PARAM_CODE_NOT_FOUND。
+ * 遍历完成后需要调用 SystemTraversalParameterEnd 释放 cursor。
+ *
+ */
+int SystemTraversalParameterBegin(const char *prefix, void **cursor);
+int SystemTraversalParameterNext(void *cursor, ParamHandle *handle);
+void SystemTraversalParameterEnd(void *cursor);
+
 /**
  * 外部接口
  * 查询参数，主要用于其他进程使用，需要给定足够的内存保存参数。
@@ -90,6 +155,16 @@ int SystemGetParameterValue(ParamHandle handle, char *value, unsigned int *len);
  */
 int SystemWaitParameter(const char *name, const char *value, int32_t timeout);
 
+/**
+ * 外部接口
+ * 参数变化计数，prefix 为顶层前缀，如 "persist"，NULL 为全部参数。
+ * 不同前缀可能共用一个计数，计数变化后需要重新检查关心的参数。
+ * SystemWaitParameterChange 阻塞直到计数不等于 serial 或超时，serial 返回当前计数。
+ *
+ */
+int SystemGetParameterChangeSerial(const char *prefix, uint32_t *serial);
+int SystemWaitParameterChange(const char *prefix, uint32_t *serial, int32_t timeout);
+
 typedef void (*ParameterChangePtr)(const char *key, const char *value, void *context);
 int SystemWatchParameter(const char *keyprefix, ParameterChangePtr change, void *context);
 
@@ -175,10 +175,12 @@ void SystemLoadSelinux(void)
 void SystemConfig(void)
 {
     InitParamService();
-    // parse parameters
-    LoadDefaultParams("/system/etc/param/ohos_const", LOAD_PARAM_NORMAL);
-    LoadDefaultParams("/vendor/etc/param", LOAD_PARAM_NORMAL);
-    LoadDefaultParams("/system/etc/param", LOAD_PARAM_ONLY_ADD);
+    // parse parameters, the image built with the same files skips the parsing
+    if (LoadParamImage("/system/etc/param/param_image") != 0) {
+        LoadDefaultParams("/system/etc/param/ohos_const", LOAD_PARAM_NORMAL);
+        LoadDefaultParams("/vendor/etc/param", LOAD_PARAM_NORMAL);
+        LoadDefaultParams("/system/etc/param", LOAD_PARAM_ONLY_ADD);
+    }
     // read config
     ReadConfig();
     INIT_LOGI("Parse init config file done.");
@@ -14,47 +14,230 @@
  */
 
 #include <grp.h>
+#include <pthread.h>
 #include <pwd.h>
+#include <stdatomic.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 
 #include "init_utils.h"
 #include "param_security.h"
 #include "param_utils.h"
 
 #define OCT_BASE 8
+#define DAC_CACHE_CHECK_INTERVAL 1000 // ms between checks of the user and group files
+#define DAC_CACHE_INIT_SIZE 64
+
+typedef struct {
+    uint32_t id;
+    uint32_t nameOffset;
+} DacNameId;
+
+typedef struct {
+    uint32_t gid;
+    uint32_t uid;
+} DacGroupMember;
+
+// passwd and group are parsed once, a permission check is then a binary search
+typedef struct {
+    pthread_rwlock_t lock;
+    atomic_ullong checkTime;
+    int loaded;
+    struct timespec userTime;
+    struct timespec groupTime;
+    DacNameId *users;
+    uint32_t userCount;
+    uint32_t userSize;
+    DacNameId *groups;
+    uint32_t groupCount;
+    uint32_t groupSize;
+    DacGroupMember *members; // sorted by gid and uid
+    uint32_t memberCount;
+    uint32_t memberSize;
+    char *names;
+    uint32_t namesSize;
+    uint32_t namesUsed;
+} DacCredCache;
+
 static ParamSecurityLabel g_localSecurityLabel = {};
+static DacCredCache g_dacCache = { .lock = PTHREAD_RWLOCK_INITIALIZER };
+
+static int GrowDacArray(void **array, uint32_t *size, uint32_t count, uint32_t itemSize)
+{
+    if (count < *size) {
+        return 0;
+    }
+    uint32_t newSize = (*size == 0) ? DAC_CACHE_INIT_SIZE : *size;
+    while (newSize <= count) {
+        newSize *= 2; // 2 double the size
+    }
+    void *data = realloc(*array, (size_t)newSize * itemSize);
+    PARAM_CHECK(data != NULL, return -1, "Failed to alloc memory for dac cache");
+    *array = data;
+    *size = newSize;
+    return 0;
+}
+
+static int AddDacName(DacCredCache *cache, DacNameId **items, uint32_t *count, uint32_t *size,
+    uint32_t id, const char *name)
+{
+    int ret = GrowDacArray((void **)items, size, *count, sizeof(DacNameId));
+    PARAM_CHECK(ret == 0, return -1, "Failed to add %s", name);
+    uint32_t nameLen = strlen(name) + 1;
+    ret = GrowDacArray((void **)&cache->names, &cache->namesSize, cache->namesUsed + nameLen, 1);
+    PARAM_CHECK(ret == 0, return -1, "Failed to add %s", name);
+    (void)memcpy_s(cache->names + cache->namesUsed, cache->namesSize - cache->namesUsed, name, nameLen);
+    (*items)[*count].id = id;
+    (*items)[*count].nameOffset = cache->namesUsed;
+    (*count)++;
+    cache->namesUsed += nameLen;
+    return 0;
+}
+
+static int FindDacId(const DacCredCache *cache, const DacNameId *items, uint32_t count,
+    const char *name, uint32_t nameLen, uint32_t *id)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        const char *itemName = cache->names + items[i].nameOffset;
+        if ((strncmp(itemName, name, nameLen) == 0) && (itemName[nameLen] == '\0')) {
+            *id = items[i].id;
+            return 0;
+        }
+    }
+    return -1;
+}
 
-static void GetUserIdByName(FILE *fp, uid_t *uid, const char *name, uint32_t nameLen)
+static int AddDacGroupMember(DacCredCache *cache, uint32_t gid, const char *userName)
 {
-    *uid = -1;
-    (void)fseek(fp, 0, SEEK_SET);
+    uint32_t uid = 0;
+    if (FindDacId(cache, cache->users, cache->userCount, userName, strlen(userName), &uid) != 0) {
+        return 0;
+    }
+    int ret = GrowDacArray((void **)&cache->members, &cache->memberSize, cache->memberCount, sizeof(DacGroupMember));
+    PARAM_CHECK(ret == 0, return -1, "Failed to add member %s", userName);
+    cache->members[cache->memberCount].gid = gid;
+    cache->members[cache->memberCount].uid = uid;
+    cache->memberCount++;
+    return 0;
+}
+
+static int CompareDacGroupMember(const void *first, const void *second)
+{
+    const DacGroupMember *member1 = (const DacGroupMember *)first;
+    const DacGroupMember *member2 = (const DacGroupMember *)second;
+    if (member1->gid != member2->gid) {
+        return (member1->gid < member2->gid) ? -1 : 1;
+    }
+    if (member1->uid != member2->uid) {
+        return (member1->uid < member2->uid) ? -1 : 1;
+    }
+    return 0;
+}
+
+static void FreeDacCache(DacCredCache *cache)
+{
+    free(cache->users);
+    free(cache->groups);
+    free(cache->members);
+    free(cache->names);
+    cache->users = NULL;
+    cache->groups = NULL;
+    cache->members = NULL;
+    cache->names = NULL;
+    cache->userCount = 0;
+    cache->userSize = 0;
+    cache->groupCount = 0;
+    cache->groupSize = 0;
+    cache->memberCount = 0;
+    cache->memberSize = 0;
+    cache->namesSize = 0;
+    cache->namesUsed = 0;
+    cache->loaded = 0;
+}
+
+static void LoadDacUsers(DacCredCache *cache)
+{
+    FILE *fp = fopen(USER_FILE_PATH, "r");
+    PARAM_CHECK(fp != NULL, return, "Failed to open %s", USER_FILE_PATH);
     struct passwd *data = NULL;
     while ((data = fgetpwent(fp)) != NULL) {
-        if ((data->pw_name != NULL) && (strlen(data->pw_name) == nameLen) &&
-            (strncmp(data->pw_name, name, nameLen) == 0)) {
-            *uid = data->pw_uid;
-            return;
+        if (data->pw_name != NULL) {
+            PARAM_CHECK(AddDacName(cache, &cache->users, &cache->userCount, &cache->userSize,
+                data->pw_uid, data->pw_name) == 0,
+                break, "Failed to add user %s", data->pw_name);
         }
     }
+    (void)fclose(fp);
 }
 
-static void GetGroupIdByName(FILE *fp, gid_t *gid, const char *name, uint32_t nameLen)
+static void LoadDacGroups(DacCredCache *cache)
 {
-    *gid = -1;
-    (void)fseek(fp, 0, SEEK_SET);
+    FILE *fp = fopen(GROUP_FILE_PATH, "r");
+    PARAM_CHECK(fp != NULL, return, "Failed to open %s", GROUP_FILE_PATH);
     struct group *data = NULL;
     while ((data = fgetgrent(fp)) != NULL) {
-        if ((data->gr_name != NULL) && (strlen(data->gr_name) == nameLen) &&
-            (strncmp(data->gr_name, name, nameLen) == 0)) {
-            *gid = data->gr_gid;
-            break;
+        if (data->gr_name == NULL) {
+            continue;
+        }
+        PARAM_CHECK(AddDacName(cache, &cache->groups, &cache->groupCount, &cache->groupSize,
+            data->gr_gid, data->gr_name) == 0,
+            break, "Failed to add group %s", data->gr_name);
+        // a user is in the group listing it as member and in the group with the same name
+        (void)AddDacGroupMember(cache, data->gr_gid, data->gr_name);
+        for (int index = 0; data->gr_mem != NULL && data->gr_mem[index] != NULL; index++) {
+            (void)AddDacGroupMember(cache, data->gr_gid, data->gr_mem[index]);
         }
     }
+    (void)fclose(fp);
+    if (cache->memberCount > 0) {
+        qsort(cache->members, cache->memberCount, sizeof(DacGroupMember), CompareDacGroupMember);
+    }
+}
+
+static int IsDacFileChanged(const char *fileName, struct timespec *modifyTime)
+{
+    struct stat st = {};
+    if (stat(fileName, &st) != 0) {
+        st.st_mtim.tv_sec = 0;
+        st.st_mtim.tv_nsec = 0;
+    }
+    if (st.st_mtim.tv_sec == modifyTime->tv_sec && st.st_mtim.tv_nsec == modifyTime->tv_nsec) {
+        return 0;
+    }
+    *modifyTime = st.st_mtim;
+    return 1;
+}
+
+static void UpdateDacCache(void)
+{
+    struct timespec now = {};
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    const uint64_t nsPerMs = 1000 * 1000;
+    uint64_t current = (uint64_t)now.tv_sec * MS_UNIT + (uint64_t)now.tv_nsec / nsPerMs;
+    uint64_t checkTime = atomic_load_explicit(&g_dacCache.checkTime, memory_order_acquire);
+    if (checkTime != 0 && current - checkTime < DAC_CACHE_CHECK_INTERVAL) {
+        return;
+    }
+    pthread_rwlock_wrlock(&g_dacCache.lock);
+    if (atomic_load_explicit(&g_dacCache.checkTime, memory_order_relaxed) == checkTime) {
+        int userChanged = IsDacFileChanged(USER_FILE_PATH, &g_dacCache.userTime);
+        int groupChanged = IsDacFileChanged(GROUP_FILE_PATH, &g_dacCache.groupTime);
+        if (!g_dacCache.loaded || userChanged || groupChanged) {
+            FreeDacCache(&g_dacCache);
+            LoadDacUsers(&g_dacCache);
+            LoadDacGroups(&g_dacCache);
+            g_dacCache.loaded = 1;
+            PARAM_LOGD("Load dac cache users %u groups %u members %u",
+                g_dacCache.userCount, g_dacCache.groupCount, g_dacCache.memberCount);
+        }
+        atomic_store_explicit(&g_dacCache.checkTime, current, memory_order_release);
+    }
+    pthread_rwlock_unlock(&g_dacCache.lock);
 }
 
 // user:group:r|w
-static int GetParamDacData(FILE *fpForGroup, FILE *fpForUser, ParamDacData *dacData, const char *value)
+static int GetParamDacData(ParamDacData *dacData, const char *value)
 {
     if (dacData == NULL) {
         return -1;
@@ -67,8 +250,15 @@ static int GetParamDacData(FILE *fpForGroup, FILE *fpForUser, ParamDacData *dacD
     if (mode == NULL) {
         return -1;
     }
-    GetUserIdByName(fpForUser, &dacData->uid, value, groupName - value);
-    GetGroupIdByName(fpForGroup, &dacData->gid, groupName + 1, mode - groupName - 1);
+    uint32_t uid = (uint32_t)-1;
+    uint32_t gid = (uint32_t)-1;
+    pthread_rwlock_rdlock(&g_dacCache.lock);
+    (void)FindDacId(&g_dacCache, g_dacCache.users, g_dacCache.userCount, value, groupName - value, &uid);
+    (void)FindDacId(&g_dacCache, g_dacCache.groups, g_dacCache.groupCount,
+        groupName + 1, mode - groupName - 1, &gid);
+    pthread_rwlock_unlock(&g_dacCache.lock);
+    dacData->uid = uid;
+    dacData->gid = gid;
     dacData->mode = strtol(mode + 1, NULL, OCT_BASE);
     return 0;
 }
@@ -111,67 +301,40 @@ static int DecodeSecurityLabel(ParamSecurityLabel **srcLabel, const char *buffer
     return 0;
 }
 
-static int LoadParamLabels(const char *fileName, SecurityLabelFunc label, void *context)
+static int LoadParamLabelLines(const ParamFileLine *lines, uint32_t count, void *context)
 {
+    LabelFuncContext *cxt = (LabelFuncContext *)context;
     uint32_t infoCount = 0;
     ParamAuditData auditData = {0};
-    FILE *fpForGroup = fopen(GROUP_FILE_PATH, "r");
-    FILE *fpForUser = fopen(USER_FILE_PATH, "r");
-    FILE *fp = fopen(fileName, "r");
-    char *buff = (char *)calloc(1, PARAM_BUFFER_SIZE);
-    SubStringInfo *info = calloc(1, sizeof(SubStringInfo) * (SUBSTR_INFO_DAC + 1));
-    while (fp != NULL && fpForGroup != NULL && fpForUser != NULL &&
-        info != NULL && buff != NULL && fgets(buff, PARAM_BUFFER_SIZE, fp) != NULL) {
-        buff[PARAM_BUFFER_SIZE - 1] = '\0';
-        int subStrNumber = GetSubStringInfo(buff, strlen(buff), ' ', info, SUBSTR_INFO_DAC + 1);
-        if (subStrNumber <= SUBSTR_INFO_DAC) {
-            continue;
-        }
-        auditData.name = info[SUBSTR_INFO_NAME].value;
+    for (uint32_t i = 0; i < count; i++) {
+        auditData.name = lines[i].fields[SUBSTR_INFO_NAME];
 #ifdef STARTUP_INIT_TEST
-        auditData.label = info[SUBSTR_INFO_NAME].value;
+        auditData.label = lines[i].fields[SUBSTR_INFO_NAME];
 #endif
-        int ret = GetParamDacData(fpForGroup, fpForUser, &auditData.dacData, info[SUBSTR_INFO_DAC].value);
-        PARAM_CHECK(ret == 0, continue, "Failed to get param info %d %s", ret, buff);
-        ret = label(&auditData, context);
-        PARAM_CHECK(ret == 0, continue, "Failed to write param info %d %s", ret, buff);
+        int ret = GetParamDacData(&auditData.dacData, lines[i].fields[SUBSTR_INFO_DAC]);
+        PARAM_CHECK(ret == 0, continue, "Failed to get param info %d %s", ret, auditData.name);
+        ret = cxt->label(&auditData, cxt->context);
+        PARAM_CHECK(ret == 0, continue, "Failed to write param info %d %s", ret, auditData.name);
         infoCount++;
     }
-    PARAM_LOGI("Load parameter label total %u success %s", infoCount, fileName);
-    if (fp != NULL) {
-        (void)fclose(fp);
-    }
-    if (info != NULL) {
-        free(info);
-    }
-    if (fpForGroup != NULL) {
-        (void)fclose(fpForGroup);
-    }
-    if (fpForUser != NULL) {
-        (void)fclose(fpForUser);
-    }
-    if (buff != NULL) {
-        free(buff);
-    }
+    PARAM_LOGI("Load parameter label total %u success", infoCount);
     return 0;
 }
 
-static int ProcessParamFile(const char *fileName, void *context)
-{
-    LabelFuncContext *cxt = (LabelFuncContext *)context;
-    return LoadParamLabels(fileName, cxt->label, cxt->context);
-}
-
 static int GetParamSecurityLabel(SecurityLabelFunc label, const char *path, void *context)
 {
     PARAM_CHECK(label != NULL && path != NULL, return -1, "Invalid param");
-    struct stat st;
-    LabelFuncContext cxt = {label, context};
-    if ((stat(path, &st) == 0) && !S_ISDIR(st.st_mode)) {
-        return ProcessParamFile(path, &cxt);
-    }
     PARAM_LOGD("GetParamSecurityLabel %s ", path);
-    return ReadFileInDir(path, ".para.dac", ProcessParamFile, &cxt);
+    UpdateDacCache();
+    LabelFuncContext cxt = {label, context};
+    ParamFileLoader loader = {};
+    loader.ext = ".para.dac";
+    loader.delimiter = ' ';
+    loader.fieldCount = SUBSTR_INFO_DAC + 1;
+    loader.checkLine = NULL;
+    loader.loadLines = LoadParamLabelLines;
+    loader.context = &cxt;
+    return LoadParamFiles(path, &loader);
 }
 
 static int CheckFilePermission(const ParamSecurityLabel *localLabel, const char *fileName, int flags)
@@ -183,28 +346,12 @@ static int CheckFilePermission(const ParamSecurityLabel *localLabel, const char
 
 static int CheckUserInGroup(gid_t groupId, uid_t uid)
 {
-    struct group *data = getgrgid(groupId);
-    if (data == NULL) {
-        return -1;
-    }
-    struct passwd *user = getpwuid(uid);
-    if (user == NULL) {
-        return -1;
-    }
-
-    PARAM_LOGD("CheckUserInGroup pw_name %s ", user->pw_name);
-    int index = 0;
-    while (data->gr_mem[index]) {
-        PARAM_LOGD("CheckUserInGroup %s ", data->gr_mem[index]);
-        if (strcmp(data->gr_mem[index], user->pw_name) == 0) {
-            return 0;
-        }
-        index++;
-    }
-    if (strcmp(data->gr_name, user->pw_name) == 0) {
-        return 0;
-    }
-    return -1;
+    DacGroupMember key = { groupId, uid };
+    pthread_rwlock_rdlock(&g_dacCache.lock);
+    void *member = (g_dacCache.memberCount == 0) ? NULL : bsearch(&key, g_dacCache.members,
+        g_dacCache.memberCount, sizeof(DacGroupMember), CompareDacGroupMember);
+    pthread_rwlock_unlock(&g_dacCache.lock);
+    return (member != NULL) ? 0 : -1;
 }
 
 static int CheckMatchGroup(gid_t groupId)
@@ -212,21 +359,29 @@ static int CheckMatchGroup(gid_t groupId)
     if (getpid() == 1) {
         return -1;
     }
-    int num = getgroups(0, NULL);
-    PARAM_CHECK(num > 0, return -1, "Failed to getgroups");
-    gid_t *groups = calloc(1, sizeof(gid_t) * num);
-    PARAM_CHECK(groups != NULL, return -1, "Failed to alloc for groups");
-    num = getgroups(num, groups);
-    PARAM_CHECK(num > 0, free(groups);
-        return -1, "Failed to getgroups");
+    // setgroups changes them and a forked child does not share them with its parent, read them for each check
+    gid_t localGroups[PARAM_LOCAL_GROUP_MAX] = { 0 };
+    gid_t *groups = localGroups;
+    int num = getgroups(PARAM_LOCAL_GROUP_MAX, groups);
+    if (num < 0 && errno == EINVAL) {
+        num = getgroups(0, NULL);
+        PARAM_CHECK(num > 0, return -1, "Failed to getgroups");
+        groups = calloc(1, sizeof(gid_t) * num);
+        PARAM_CHECK(groups != NULL, return -1, "Failed to alloc for groups");
+        num = getgroups(num, groups);
+    }
+    PARAM_CHECK(num >= 0, num = 0, "Failed to getgroups");
+    int ret = -1;
     for (int index = 0; index < num; index++) {
         if (groups[index] == groupId) {
-            free(groups);
-            return 0;
+            ret = 0;
+            break;
         }
     }
-    free(groups);
-    return  -1;
+    if (groups != localGroups) {
+        free(groups);
+    }
+    return ret;
 }
 
 static int CheckParamPermission(const ParamSecurityLabel *srcLabel, const ParamAuditData *auditData, uint32_t mode)
@@ -240,6 +395,9 @@ static int CheckParamPermission(const ParamSecurityLabel *srcLabel, const ParamA
      * user:group:read|write|watch
      */
     uint32_t localMode;
+    if ((srcLabel->cred.uid != auditData->dacData.uid) && (srcLabel->cred.gid != auditData->dacData.gid)) {
+        UpdateDacCache();
+    }
     if (srcLabel->cred.uid == auditData->dacData.uid) {
         localMode = mode & (DAC_READ | DAC_WRITE | DAC_WATCH);
     } else if (srcLabel->cred.gid == auditData->dacData.gid) {
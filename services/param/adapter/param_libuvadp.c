@@ -16,6 +16,8 @@
 #include <sys/wait.h>
 
 static const uint32_t RECV_BUFFER_MAX = 5 * 1024;
+static LibuvBufferPool g_recvBufferPool = { 0 };
+static LibuvBufferPool g_writerPool = { 0 };
 
 static LibuvBaseTask *CreateLibuvTask(uint32_t size, uint32_t flags, uint16_t userDataSize, TaskClose close)
 {
@@ -30,6 +32,28 @@ static LibuvBaseTask *CreateLibuvTask(uint32_t size, uint32_t flags, uint16_t us
     return worker;
 }
 
+static void *GetPoolBuffer(LibuvBufferPool *pool, uint32_t size)
+{
+    if (pool->count > 0) {
+        pool->count--;
+        return pool->buffers[pool->count];
+    }
+    return malloc(size);
+}
+
+static void PutPoolBuffer(LibuvBufferPool *pool, void *buffer)
+{
+    if (buffer == NULL) {
+        return;
+    }
+    if (pool->count < BUFFER_POOL_MAX) {
+        pool->buffers[pool->count] = buffer;
+        pool->count++;
+        return;
+    }
+    free(buffer);
+}
+
 static void OnClientClose(uv_handle_t *handle)
 {
     PARAM_LOGD("OnClientClose handle: %p", handle);
@@ -38,6 +62,7 @@ static void OnClientClose(uv_handle_t *handle)
     if (worker->base.close != NULL) {
         worker->base.close((ParamTaskPtr)worker);
     }
+    PutPoolBuffer(&g_recvBufferPool, worker->recvBuffer);
     free(worker);
 }
 
@@ -62,12 +87,18 @@ static void OnTimerClose(uv_handle_t *handle)
     free(worker);
 }
 
-static void OnReceiveAlloc(uv_handle_t *handle, size_t suggestedSize, uv_buf_t *buf)
+PARAM_STATIC void OnReceiveAlloc(uv_handle_t *handle, size_t suggestedSize, uv_buf_t *buf)
 {
     UNUSED(suggestedSize);
     PARAM_CHECK(handle != NULL, return, "Invalid handle");
-    buf->len = RECV_BUFFER_MAX;
-    buf->base = (char *)malloc(buf->len);
+    LibuvStreamTask *client = PARAM_ENTRY(handle, LibuvStreamTask, stream);
+    if (client->recvBuffer != NULL) { // read the rest of the message behind its start
+        buf->base = client->recvBuffer + client->recvSize;
+        buf->len = RECV_BUFFER_MAX - client->recvSize;
+        return;
+    }
+    buf->base = (char *)GetPoolBuffer(&g_recvBufferPool, RECV_BUFFER_MAX);
+    buf->len = (buf->base == NULL) ? 0 : RECV_BUFFER_MAX;
 }
 
 static void OnWriteResponse(uv_write_t *req, int status)
@@ -77,51 +108,194 @@ static void OnWriteResponse(uv_write_t *req, int status)
     write_req_t *writer = (write_req_t *)req;
     if (writer != NULL) {
         free(writer->buf.base);
-        free(writer);
+        PutPoolBuffer(&g_writerPool, writer);
     }
 }
 
-static void OnReceiveRequest(uv_stream_t *handle, ssize_t nread, const uv_buf_t *buf)
+static ssize_t DispatchRequest(LibuvStreamTask *client, const char *buffer, ssize_t size)
 {
-    if (nread <= 0 || buf == NULL || buf->base == NULL) {
-        uv_close((uv_handle_t *)handle, OnClientClose);
-        if (buf != NULL) {
-            free(buf->base);
+    ssize_t curr = 0;
+    while ((curr + (ssize_t)sizeof(ParamMessage)) <= size) {
+        const ParamMessage *msg = (const ParamMessage *)(buffer + curr);
+        PARAM_CHECK(msg->msgSize >= sizeof(ParamMessage) && msg->msgSize <= RECV_BUFFER_MAX,
+            return -1, "Invalid msg size %u", msg->msgSize);
+        if ((ssize_t)(msg->msgSize + curr) > size) {
+            break;
         }
+        client->recvMessage(&client->base.worker, msg);
+        curr += msg->msgSize;
+    }
+    return curr;
+}
+
+PARAM_STATIC void OnReceiveRequest(uv_stream_t *handle, ssize_t nread, const uv_buf_t *buf)
+{
+    LibuvStreamTask *client = PARAM_ENTRY(handle, LibuvStreamTask, stream);
+    // the reassembly buffer stays with the client, only a pooled read buffer is given back
+    char *readBuffer = (buf == NULL || buf->base == NULL || client->recvBuffer != NULL) ? NULL : buf->base;
+    if (nread == 0) {
+        PutPoolBuffer(&g_recvBufferPool, readBuffer);
+        return;
+    }
+    if (nread < 0 || buf == NULL || buf->base == NULL) {
+        PutPoolBuffer(&g_recvBufferPool, readBuffer);
+        uv_close((uv_handle_t *)handle, OnClientClose);
         return;
     }
     PARAM_LOGD("OnReceiveRequest %d nread %d", buf->len, nread);
-    LibuvStreamTask *client = PARAM_ENTRY(handle, LibuvStreamTask, stream);
     if (client->recvMessage == NULL) {
-        free(buf->base);
+        PutPoolBuffer(&g_recvBufferPool, readBuffer);
         return;
     }
-    ssize_t curr = 0;
-    while (curr < nread) {
-        const ParamMessage *msg = (const ParamMessage *)(buf->base + curr);
-        if ((ssize_t)(msg->msgSize + curr) > nread) {
-            break;
-        }
-        client->recvMessage(&client->base.worker, msg);
-        curr += msg->msgSize;
+    // requests are pipelined, the message left over by the previous read is completed in place
+    char *buffer = (readBuffer == NULL) ? client->recvBuffer : readBuffer;
+    ssize_t size = (readBuffer == NULL) ? (client->recvSize + nread) : nread;
+    ssize_t curr = DispatchRequest(client, buffer, size);
+    if (curr < 0) {
+        PutPoolBuffer(&g_recvBufferPool, readBuffer);
+        uv_close((uv_handle_t *)handle, OnClientClose);
+        return;
+    }
+    if (curr == size) {
+        PutPoolBuffer(&g_recvBufferPool, buffer);
+        client->recvBuffer = NULL;
+        client->recvSize = 0;
+        return;
     }
-    free(buf->base);
+    // keep the partial message at the start of the buffer, it is shorter than RECV_BUFFER_MAX
+    if (curr > 0) {
+        (void)memmove_s(buffer, RECV_BUFFER_MAX, buffer + curr, size - curr);
+    }
+    client->recvBuffer = buffer;
+    client->recvSize = size - curr;
+}
+
+static LibuvAsyncEvent *TakeOverflowEvents(LibuvEventTask *worker)
+{
+    LibuvAsyncEvent *event = (LibuvAsyncEvent *)atomic_exchange_explicit(&worker->overflow, 0, memory_order_acquire);
+    LibuvAsyncEvent *ordered = NULL;
+    while (event != NULL) { // reverse to posting order
+        LibuvAsyncEvent *next = event->next;
+        event->next = ordered;
+        ordered = event;
+        event = next;
+    }
+    return ordered;
 }
 
-static void OnAsyncCloseCallback(uv_handle_t *handle)
+static void OnEventClose(uv_handle_t *handle)
 {
     PARAM_CHECK(handle != NULL, return, "Invalid handle");
-    free(handle);
+    LibuvEventTask *worker = PARAM_ENTRY(handle, LibuvEventTask, async);
+    PARAM_LOGI("Event task posted %u overflowed %u dropped %u max batch %u",
+        atomic_load(&worker->stat.posted), atomic_load(&worker->stat.overflowed),
+        atomic_load(&worker->stat.dropped), worker->stat.maxBatch);
+    LibuvAsyncEvent *event = TakeOverflowEvents(worker);
+    while (event != NULL) {
+        LibuvAsyncEvent *next = event->next;
+        free(event);
+        event = next;
+    }
+    if (worker->base.close != NULL) {
+        worker->base.close((ParamTaskPtr)worker);
+    }
+    free(worker->slots);
+    free(worker);
+}
+
+static uint32_t ProcessOverflowEvents(LibuvEventTask *worker)
+{
+    uint32_t count = 0;
+    LibuvAsyncEvent *event = TakeOverflowEvents(worker);
+    while (event != NULL) {
+        LibuvAsyncEvent *next = event->next;
+        worker->process(event->eventId, event->content, event->contentSize);
+        free(event);
+        event = next;
+        count++;
+    }
+    return count;
 }
 
 static void OnAsyncCallback(uv_async_t *handle)
 {
     PARAM_CHECK(handle != NULL, return, "Invalid handle");
-    LibuvAsyncEvent *event = (LibuvAsyncEvent *)handle;
-    if (event->task != NULL && event->task->process != NULL) {
-        event->task->process(event->eventId, event->content, event->contentSize);
+    LibuvEventTask *worker = PARAM_ENTRY(handle, LibuvEventTask, async);
+    uint32_t count = 0;
+    while (count < EVENT_SLOT_COUNT) {
+        LibuvEventSlot *slot = &worker->slots[worker->tail & (EVENT_SLOT_COUNT - 1)];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != worker->tail + 1) {
+            break; // empty, or the producer has not finished filling it and will signal again
+        }
+        worker->process(slot->eventId, slot->content, slot->contentSize);
+        atomic_store_explicit(&slot->sequence, worker->tail + EVENT_SLOT_COUNT, memory_order_release);
+        worker->tail++;
+        count++;
+    }
+    if (atomic_load_explicit(&worker->head, memory_order_acquire) != worker->tail) {
+        // the overflow list is newer than the ring and waits for it, a full batch gives the other
+        // handles a turn and a claimed slot is still being filled by its producer
+        uv_async_send(handle);
+    } else {
+        count += ProcessOverflowEvents(worker);
+    }
+    if (count > worker->stat.maxBatch) {
+        worker->stat.maxBatch = count;
     }
-    uv_close((uv_handle_t *)handle, OnAsyncCloseCallback);
+}
+
+static int PostEventToRing(LibuvEventTask *worker, uint64_t eventId, const char *content, uint32_t size)
+{
+    if (size >= EVENT_SLOT_CONTENT_MAX || atomic_load_explicit(&worker->overflow, memory_order_relaxed) != 0) {
+        return -1;
+    }
+    LibuvEventSlot *slot = NULL;
+    uint32_t pos = atomic_load_explicit(&worker->head, memory_order_relaxed);
+    while (1) {
+        slot = &worker->slots[pos & (EVENT_SLOT_COUNT - 1)];
+        int32_t diff = (int32_t)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - pos);
+        if (diff < 0) {
+            return -1; // full
+        }
+        if (diff == 0 && atomic_compare_exchange_weak_explicit(&worker->head, &pos, pos + 1,
+            memory_order_relaxed, memory_order_relaxed)) {
+            break;
+        }
+        if (diff > 0) {
+            pos = atomic_load_explicit(&worker->head, memory_order_relaxed);
+        }
+    }
+    slot->eventId = eventId;
+    slot->contentSize = size + 1;
+    if (content != NULL) {
+        (void)memcpy_s(slot->content, sizeof(slot->content), content, size);
+    }
+    slot->content[size] = '\0';
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    return 0;
+}
+
+static int PostEventToOverflow(LibuvEventTask *worker, uint64_t eventId, const char *content, uint32_t size)
+{
+    LibuvAsyncEvent *event = (LibuvAsyncEvent *)calloc(1, sizeof(LibuvAsyncEvent) + size + 1);
+    PARAM_CHECK(event != NULL, atomic_fetch_add(&worker->stat.dropped, 1);
+        return -1, "Failed to alloc event");
+    event->eventId = eventId;
+    event->contentSize = size + 1;
+    if (content != NULL) {
+        int ret = memcpy_s(event->content, event->contentSize, content, size);
+        PARAM_CHECK(ret == EOK, free(event);
+            atomic_fetch_add(&worker->stat.dropped, 1);
+            return -1, "Failed to memcpy content ");
+    }
+    event->content[size] = '\0';
+    uintptr_t top = atomic_load_explicit(&worker->overflow, memory_order_relaxed);
+    do {
+        event->next = (LibuvAsyncEvent *)top;
+    } while (!atomic_compare_exchange_weak_explicit(&worker->overflow, &top, (uintptr_t)event,
+        memory_order_release, memory_order_relaxed));
+    atomic_fetch_add(&worker->stat.overflowed, 1);
+    return 0;
 }
 
 static void OnConnection(uv_stream_t *server, int status)
@@ -235,13 +409,14 @@ int ParamTaskSendMsg(const ParamTaskPtr stream, const ParamMessage *msg)
         return -1;
     }
 #ifndef STARTUP_INIT_TEST
-    write_req_t *req = malloc(sizeof(write_req_t));
+    write_req_t *req = (write_req_t *)GetPoolBuffer(&g_writerPool, sizeof(write_req_t));
     PARAM_CHECK(req != NULL, LibuvFreeMsg(stream, msg);
         return -1, "Failed to create request");
     LibuvStreamTask *worker = (LibuvStreamTask *)stream;
     req->buf = uv_buf_init((char *)msg, msg->msgSize);
     int ret = uv_write(&req->writer, (uv_stream_t *)&worker->stream.pipe, &req->buf, 1, OnWriteResponse);
     PARAM_CHECK(ret >= 0, LibuvFreeMsg(stream, msg);
+        PutPoolBuffer(&g_writerPool, req);
         return -1, "Failed to uv_write2 ret %s", uv_strerror(ret));
 #endif
     return 0;
@@ -253,8 +428,21 @@ int ParamEventTaskCreate(ParamTaskPtr *stream, EventProcess eventProcess, EventP
     LibuvEventTask *worker = (LibuvEventTask *)CreateLibuvTask(sizeof(LibuvEventTask),
         WORKER_TYPE_EVENT | WORKER_TYPE_ASYNC, 0, NULL);
     PARAM_CHECK(worker != NULL, return -1, "Failed to alloc worker");
+    worker->slots = (LibuvEventSlot *)calloc(EVENT_SLOT_COUNT, sizeof(LibuvEventSlot));
+    PARAM_CHECK(worker->slots != NULL, free(worker);
+        return -1, "Failed to alloc event slots");
+    for (uint32_t i = 0; i < EVENT_SLOT_COUNT; i++) {
+        atomic_init(&worker->slots[i].sequence, i);
+    }
+    atomic_init(&worker->head, 0);
+    worker->tail = 0;
+    atomic_init(&worker->overflow, 0);
     worker->process = eventProcess;
     worker->beforeProcess = eventBeforeProcess;
+    int ret = uv_async_init(uv_default_loop(), &worker->async, OnAsyncCallback);
+    PARAM_CHECK(ret == 0, free(worker->slots);
+        free(worker);
+        return -1, "Failed to uv_async_init %d", ret);
     *stream = &worker->base.worker;
     return 0;
 }
@@ -267,23 +455,16 @@ int ParamEventSend(ParamTaskPtr stream, uint64_t eventId, const char *content, u
     int ret = PARAM_CODE_INVALID_PARAM;
     if (stream->flags & WORKER_TYPE_ASYNC) {
         LibuvEventTask *worker = (LibuvEventTask *)stream;
-        LibuvAsyncEvent *event = (LibuvAsyncEvent *)calloc(1, sizeof(LibuvAsyncEvent) + size + 1);
-        PARAM_CHECK(event != NULL, return -1, "Failed to alloc event");
-        event->eventId = eventId;
-        event->contentSize = size + 1;
-        event->task = worker;
-        if (content != NULL) {
-            ret = memcpy_s(event->content, event->contentSize, content, size);
-            PARAM_CHECK(ret == EOK, free(event);
-                return -1, "Failed to memcpy content ");
-            event->content[size] = '\0';
+        ret = PostEventToRing(worker, eventId, content, size);
+        if (ret != 0) {
+            ret = PostEventToOverflow(worker, eventId, content, size);
+            PARAM_CHECK(ret == 0, return -1, "Failed to post event %llu", (unsigned long long)eventId);
         }
-        uv_async_init(uv_default_loop(), &event->async, OnAsyncCallback);
+        atomic_fetch_add(&worker->stat.posted, 1);
         if (worker->beforeProcess != NULL) {
             worker->beforeProcess(eventId, content, size);
         }
-        uv_async_send(&event->async);
-        ret = 0;
+        uv_async_send(&worker->async);
     }
     return ret;
 }
@@ -301,6 +482,9 @@ int ParamTaskClose(ParamTaskPtr stream)
     } else if (stream->flags & WORKER_TYPE_MSG) {
         LibuvStreamTask *worker = (LibuvStreamTask *)stream;
         uv_close((uv_handle_t *)(&worker->stream.pipe), OnClientClose);
+    } else if (stream->flags & WORKER_TYPE_EVENT) {
+        LibuvEventTask *worker = (LibuvEventTask *)stream;
+        uv_close((uv_handle_t *)(&worker->async), OnEventClose);
     } else {
         free(stream);
     }
@@ -14,6 +14,7 @@
  */
 #ifndef BASE_STARTUP_PARAM_LIBUVADP_H
 #define BASE_STARTUP_PARAM_LIBUVADP_H
+#include <stdatomic.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -33,9 +34,17 @@ typedef struct {
     uv_buf_t buf;
 } write_req_t;
 
+#define BUFFER_POOL_MAX 8
+typedef struct {
+    uint32_t count;
+    void *buffers[BUFFER_POOL_MAX];
+} LibuvBufferPool;
+
 typedef struct {
     LibuvBaseTask base;
     RecvMessage recvMessage;
+    char *recvBuffer; // RECV_BUFFER_MAX bytes, starts with a message split across reads
+    uint32_t recvSize;
     union {
         uv_pipe_t pipe;
     } stream;
@@ -49,20 +58,43 @@ typedef struct {
     } server;
 } LibuvServerTask;
 
-typedef struct {
-    LibuvBaseTask base;
-    EventProcess process;
-    EventProcess beforeProcess;
-} LibuvEventTask;
+#define EVENT_SLOT_COUNT 64 // must be a power of 2
+#define EVENT_SLOT_CONTENT_MAX (PARAM_NAME_LEN_MAX + PARAM_VALUE_LEN_MAX + 2)
 
 typedef struct {
-    uv_async_t async;
-    LibuvEventTask *task;
+    atomic_uint sequence; // equal to the enqueue position once the slot is filled
+    uint32_t contentSize;
+    uint64_t eventId;
+    char content[EVENT_SLOT_CONTENT_MAX];
+} LibuvEventSlot;
+
+// event that does not fit in the ring
+typedef struct LibuvAsyncEvent_ {
+    struct LibuvAsyncEvent_ *next;
     uint64_t eventId;
     uint32_t contentSize;
     char content[0];
 } LibuvAsyncEvent;
 
+typedef struct {
+    atomic_uint posted;
+    atomic_uint overflowed; // posted to the overflow list
+    atomic_uint dropped; // lost for lack of memory
+    uint32_t maxBatch;
+} LibuvEventStat;
+
+typedef struct {
+    LibuvBaseTask base;
+    EventProcess process;
+    EventProcess beforeProcess;
+    uv_async_t async;
+    atomic_uint head; // next position to fill
+    uint32_t tail; // next position to process, only used on the loop
+    LibuvEventSlot *slots;
+    atomic_uintptr_t overflow; // LibuvAsyncEvent stack, newest first
+    LibuvEventStat stat;
+} LibuvEventTask;
+
 typedef struct {
     LibuvBaseTask base;
     uv_timer_t timer;
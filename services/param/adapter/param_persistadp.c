@@ -15,11 +15,13 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
 #include "init_utils.h"
 #include "param_persist.h"
+#include "param_trie.h"
 #include "param_utils.h"
 
 typedef struct {
@@ -27,9 +29,103 @@ typedef struct {
     PersistParamGetPtr persistParamGet;
 } PersistAdpContext;
 
-static int LoadPersistParam(PersistParamGetPtr persistParamGet, void *context)
+// a journal record, the checksum covers the lengths, the name and the value, stored without terminator
+typedef struct {
+    uint32_t checksum;
+    uint16_t nameLength;
+    uint16_t valueLength;
+    char data[0];
+} PersistJournalRecord;
+
+#define PERSIST_JOURNAL_RECORD_MAX (sizeof(PersistJournalRecord) + PARAM_NAME_LEN_MAX + PARAM_VALUE_LEN_MAX)
+
+typedef struct {
+    int fd;
+    uint32_t size;
+} PersistJournal;
+
+static PersistJournal g_persistJournal = { -1, 0 };
+
+static const char *GetPersistJournalPath(void)
+{
+    return (InUpdaterMode() == 0) ? PARAM_PERSIST_JOURNAL_PATH : "/param/persist_parameters_journal";
+}
+
+static uint32_t GetJournalRecordChecksum(const PersistJournalRecord *record)
+{
+    uint32_t size = sizeof(PersistJournalRecord) - sizeof(record->checksum) + record->nameLength + record->valueLength;
+    return GetTrieKeyHash((const char *)&record->nameLength, size);
+}
+
+static int ReadJournalRecord(FILE *fp, PersistJournalRecord *record, char *name, char *value)
+{
+    if (fread(record, sizeof(PersistJournalRecord), 1, fp) != 1) {
+        return PARAM_CODE_NOT_FOUND;
+    }
+    if (record->nameLength == 0 || record->nameLength >= PARAM_NAME_LEN_MAX ||
+        record->valueLength >= PARAM_VALUE_LEN_MAX) {
+        return PARAM_CODE_INVALID_PARAM;
+    }
+    size_t size = record->nameLength + record->valueLength;
+    if (fread(record->data, 1, size, fp) != size || GetJournalRecordChecksum(record) != record->checksum) {
+        return PARAM_CODE_INVALID_PARAM;
+    }
+    int ret = memcpy_s(name, PARAM_NAME_LEN_MAX, record->data, record->nameLength);
+    ret |= memcpy_s(value, PARAM_VALUE_LEN_MAX, record->data + record->nameLength, record->valueLength);
+    PARAM_CHECK(ret == EOK, return PARAM_CODE_INVALID_PARAM, "Failed to copy journal record");
+    name[record->nameLength] = '\0';
+    value[record->valueLength] = '\0';
+    return 0;
+}
+
+static int LoadPersistJournal(PersistParamGetPtr persistParamGet, void *context)
+{
+    FILE *fp = fopen(GetPersistJournalPath(), "r");
+    if (fp == NULL) {
+        return PARAM_CODE_NOT_FOUND;
+    }
+    uint32_t record[PERSIST_JOURNAL_RECORD_MAX / sizeof(uint32_t) + 1] = { 0 };
+    char name[PARAM_NAME_LEN_MAX] = { 0 };
+    char value[PARAM_VALUE_LEN_MAX] = { 0 };
+    uint32_t count = 0;
+    int ret;
+    while ((ret = ReadJournalRecord(fp, (PersistJournalRecord *)record, name, value)) == 0) {
+        count++;
+        int result = persistParamGet(name, value, context);
+        PARAM_CHECK(result == 0, continue, "Failed to set param %d %s", result, name);
+    }
+    // a record torn by power loss ends the journal, the next batch save drops it
+    if (ret != PARAM_CODE_NOT_FOUND) {
+        PARAM_LOGE("Invalid record in persist journal after %u records", count);
+    }
+    PARAM_LOGI("LoadPersistJournal %u records", count);
+    (void)fclose(fp);
+    return 0;
+}
+
+static int OpenPersistJournal(void)
+{
+    if (g_persistJournal.fd >= 0) {
+        return 0;
+    }
+    const char *path = GetPersistJournalPath();
+    g_persistJournal.fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    PARAM_CHECK(g_persistJournal.fd >= 0, return -1, "Failed to open %s error %d", path, errno);
+    struct stat st = {};
+    g_persistJournal.size = (fstat(g_persistJournal.fd, &st) == 0) ? (uint32_t)st.st_size : 0;
+    return 0;
+}
+
+static void ResetPersistJournal(void)
+{
+    PARAM_CHECK(OpenPersistJournal() == 0, return, "Failed to open persist journal");
+    PARAM_CHECK(ftruncate(g_persistJournal.fd, 0) == 0, return, "Failed to reset persist journal error %d", errno);
+    (void)fsync(g_persistJournal.fd);
+    g_persistJournal.size = 0;
+}
+
+static int LoadPersistSnapshot(PersistParamGetPtr persistParamGet, void *context)
 {
-    CheckAndCreateDir(PARAM_PERSIST_SAVE_PATH);
     int updaterMode = InUpdaterMode();
     char *tmpPath = (updaterMode == 0) ? PARAM_PERSIST_SAVE_TMP_PATH : "/param/tmp_persist_parameters";
     FILE *fp = fopen(tmpPath, "r");
@@ -60,12 +156,51 @@ static int LoadPersistParam(PersistParamGetPtr persistParamGet, void *context)
     return 0;
 }
 
+static int LoadPersistParam(PersistParamGetPtr persistParamGet, void *context)
+{
+    CheckAndCreateDir(PARAM_PERSIST_SAVE_PATH);
+    // the journal has the changes after the snapshot
+    int ret = LoadPersistSnapshot(persistParamGet, context);
+    if (LoadPersistJournal(persistParamGet, context) == 0) {
+        ret = 0;
+    }
+    return ret;
+}
+
 static int SavePersistParam(const char *name, const char *value)
 {
     PARAM_LOGD("SavePersistParam %s=%s", name, value);
+    uint32_t nameLen = strlen(name);
+    uint32_t valueLen = strlen(value);
+    PARAM_CHECK(nameLen > 0 && nameLen < PARAM_NAME_LEN_MAX && valueLen < PARAM_VALUE_LEN_MAX,
+        return PARAM_CODE_INVALID_PARAM, "Invalid persist param %s", name);
+    PARAM_CHECK(OpenPersistJournal() == 0, return -1, "Failed to open persist journal");
+
+    uint32_t buffer[PERSIST_JOURNAL_RECORD_MAX / sizeof(uint32_t) + 1] = { 0 };
+    PersistJournalRecord *record = (PersistJournalRecord *)buffer;
+    record->nameLength = nameLen;
+    record->valueLength = valueLen;
+    int ret = memcpy_s(record->data, PARAM_NAME_LEN_MAX + PARAM_VALUE_LEN_MAX, name, nameLen);
+    ret |= memcpy_s(record->data + nameLen, PARAM_VALUE_LEN_MAX, value, valueLen);
+    PARAM_CHECK(ret == EOK, return -1, "Failed to copy persist param %s", name);
+    record->checksum = GetJournalRecordChecksum(record);
+
+    uint32_t size = sizeof(PersistJournalRecord) + nameLen + valueLen;
+    if (write(g_persistJournal.fd, record, size) != (ssize_t)size || fdatasync(g_persistJournal.fd) != 0) {
+        PARAM_LOGE("Failed to append %s to persist journal error %d", name, errno);
+        // drop a partial record, or the records appended after it are lost when loaded
+        (void)ftruncate(g_persistJournal.fd, g_persistJournal.size);
+        return -1;
+    }
+    g_persistJournal.size += size;
     return 0;
 }
 
+static int NeedBatchSavePersistParam(void)
+{
+    return (g_persistJournal.size >= PARAM_PERSIST_JOURNAL_MAX) ? 1 : 0;
+}
+
 static int BatchSavePersistParamBegin(PERSIST_SAVE_HANDLE *handle)
 {
     FILE *fp = fopen((InUpdaterMode() == 0) ? PARAM_PERSIST_SAVE_TMP_PATH : "/param/tmp_persist_parameters", "w");
@@ -83,19 +218,26 @@ static int BatchSavePersistParam(PERSIST_SAVE_HANDLE handle, const char *name, c
     return 0;
 }
 
-static void BatchSavePersistParamEnd(PERSIST_SAVE_HANDLE handle)
+static int BatchSavePersistParamEnd(PERSIST_SAVE_HANDLE handle, int result)
 {
-    int ret;
     FILE *fp = (FILE *)handle;
-    (void)fclose(fp);
-    if (InUpdaterMode() == 0) {
-        unlink(PARAM_PERSIST_SAVE_PATH);
-        ret = rename(PARAM_PERSIST_SAVE_TMP_PATH, PARAM_PERSIST_SAVE_PATH);
-    } else {
-        unlink("/param/persist_parameters");
-        ret = rename("/param/tmp_persist_parameters", "/param/persist_parameters");
+    const char *tmpPath = (InUpdaterMode() == 0) ? PARAM_PERSIST_SAVE_TMP_PATH : "/param/tmp_persist_parameters";
+    const char *path = (InUpdaterMode() == 0) ? PARAM_PERSIST_SAVE_PATH : "/param/persist_parameters";
+    if (fflush(fp) != 0 || ferror(fp) != 0 || fsync(fileno(fp)) != 0) {
+        result = -1;
+    }
+    if (fclose(fp) != 0) {
+        result = -1;
     }
-    PARAM_CHECK(ret == 0, return, "BatchSavePersistParamEnd %s fail error %d", PARAM_PERSIST_SAVE_TMP_PATH, errno);
+    // the old snapshot and the journal still have all the parameters, the tmp file is loaded first if kept
+    PARAM_CHECK(result == 0, unlink(tmpPath);
+        return -1, "Failed to save persist parameters to %s error %d", tmpPath, errno);
+    unlink(path);
+    int ret = rename(tmpPath, path);
+    PARAM_CHECK(ret == 0, return -1, "BatchSavePersistParamEnd %s fail error %d", tmpPath, errno);
+    // all the parameters are in the snapshot now
+    ResetPersistJournal();
+    return 0;
 }
 
 int RegisterPersistParamOps(PersistParamOps *ops)
@@ -106,5 +248,6 @@ int RegisterPersistParamOps(PersistParamOps *ops)
     ops->batchSaveBegin = BatchSavePersistParamBegin;
     ops->batchSave = BatchSavePersistParam;
     ops->batchSaveEnd = BatchSavePersistParamEnd;
+    ops->needBatchSave = NeedBatchSavePersistParam;
     return 0;
 }
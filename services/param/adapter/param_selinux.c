@@ -63,56 +63,34 @@ static int DecodeSecurityLabel(ParamSecurityLabel **srcLabel, const char *buffer
     return 0;
 }
 
-static int LoadParamLabels(const char *fileName, SecurityLabelFunc label, void *context)
+static int LoadParamLabelLines(const ParamFileLine *lines, uint32_t count, void *context)
 {
-    FILE *fp = fopen(fileName, "r");
-    PARAM_CHECK(fp != NULL, return -1, "Open file %s fail", fileName);
-
-    SubStringInfo *info = calloc(1, sizeof(SubStringInfo) * (SUBSTR_INFO_DAC + 1));
-    char *buff = (char *)calloc(1, PARAM_BUFFER_SIZE);
+    LabelFuncContext *cxt = (LabelFuncContext *)context;
     int infoCount = 0;
     ParamAuditData auditData = {0};
-    while (info != NULL && buff != NULL && fgets(buff, PARAM_BUFFER_SIZE, fp) != NULL) {
-        buff[PARAM_BUFFER_SIZE - 1] = '\0';
-        int subStrNumber = GetSubStringInfo(buff, strlen(buff), ' ', info, SUBSTR_INFO_DAC + 1);
-        if (subStrNumber <= SUBSTR_INFO_DAC) {
-            continue;
-        }
-        auditData.name = info[SUBSTR_INFO_NAME].value;
-        auditData.label = info[SUBSTR_INFO_LABEL].value;
-        int ret = label(&auditData, context);
-        PARAM_CHECK(ret == 0, continue, "Failed to write param info %d %s", ret, buff);
+    for (uint32_t i = 0; i < count; i++) {
+        auditData.name = lines[i].fields[SUBSTR_INFO_NAME];
+        auditData.label = lines[i].fields[SUBSTR_INFO_LABEL];
+        int ret = cxt->label(&auditData, cxt->context);
+        PARAM_CHECK(ret == 0, continue, "Failed to write param info %d %s", ret, auditData.name);
         infoCount++;
     }
-    if (buff) {
-        free(buff);
-    }
-    if (info) {
-        free(info);
-    }
-    (void)fclose(fp);
-    PARAM_LOGI("Load parameter info %d success %s", infoCount, fileName);
+    PARAM_LOGI("Load parameter info %d success", infoCount);
     return 0;
 }
 
-static int ProcessParamFile(const char *fileName, void *context)
-{
-    LabelFuncContext *cxt = (LabelFuncContext *)context;
-    return LoadParamLabels(fileName, cxt->label, cxt->context);
-}
-
 static int GetParamSecurityLabel(SecurityLabelFunc label, const char *path, void *context)
 {
     PARAM_CHECK(label != NULL, return -1, "Invalid param");
-    int ret;
-    struct stat st;
     LabelFuncContext cxt = { label, context };
-    if ((stat(path, &st) == 0) && !S_ISDIR(st.st_mode)) {
-        ret = ProcessParamFile(path, &cxt);
-    } else {
-        ret = ReadFileInDir(path, ".para.selinux", ProcessParamFile, &cxt);
-    }
-    return ret;
+    ParamFileLoader loader = {};
+    loader.ext = ".para.selinux";
+    loader.delimiter = ' ';
+    loader.fieldCount = SUBSTR_INFO_DAC + 1;
+    loader.checkLine = NULL;
+    loader.loadLines = LoadParamLabelLines;
+    loader.context = &cxt;
+    return LoadParamFiles(path, &loader);
 }
 
 static int CheckFilePermission(const ParamSecurityLabel *localLabel, const char *fileName, int flags)
@@ -16,9 +16,13 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stddef.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "init_utils.h"
@@ -27,15 +31,42 @@
 
 #define INVALID_SOCKET (-1)
 #define INIT_PROCESS_PID 1
+#define PARAM_RECV_CHECK_INTERVAL 1000 // 1000ms
+#define PARAM_SEND_RETRY 2
 
 static const uint32_t RECV_BUFFER_MAX = 5 * 1024;
 
 static atomic_uint g_requestId = ATOMIC_VAR_INIT(1);
-static ClientWorkSpace g_clientSpace = { {}, -1, {} };
+static ClientWorkSpace g_clientSpace = { {}, -1, {}, {}, -1, NULL, NULL, { {}, -1, -1, -1, 0, NULL, NULL }, {} };
+static pthread_once_t g_clientOnce = PTHREAD_ONCE_INIT;
 
 __attribute__((constructor)) static void ClientInit(void);
 __attribute__((destructor)) static void ClientDeinit(void);
 
+static void InitParamConnection(void)
+{
+    pthread_mutex_init(&g_clientSpace.mutex, NULL);
+    pthread_condattr_t condAttr;
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_clientSpace.cond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+    g_clientSpace.clientFd = INVALID_SOCKET;
+    g_clientSpace.recvFd = INVALID_SOCKET;
+    pthread_mutex_init(&g_clientSpace.async.mutex, NULL);
+    g_clientSpace.async.fd = INVALID_SOCKET;
+    // created before any request, so the caller can add it to its event loop at once
+    g_clientSpace.async.eventFd = epoll_create1(EPOLL_CLOEXEC);
+    PARAM_CHECK(g_clientSpace.async.eventFd >= 0, return, "Failed to create epoll errno %d", errno);
+    g_clientSpace.async.notifyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    PARAM_CHECK(g_clientSpace.async.notifyFd >= 0, return, "Failed to create eventfd errno %d", errno);
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = g_clientSpace.async.notifyFd;
+    int ret = epoll_ctl(g_clientSpace.async.eventFd, EPOLL_CTL_ADD, g_clientSpace.async.notifyFd, &event);
+    PARAM_CHECK(ret == 0, return, "Failed to add eventfd errno %d", errno);
+}
+
 static int InitParamClient(void)
 {
     if (getpid() == INIT_PROCESS_PID) {
@@ -46,8 +77,8 @@ static int InitParamClient(void)
         return 0;
     }
     PARAM_LOGD("InitParamClient");
-    pthread_mutex_init(&g_clientSpace.mutex, NULL);
-    g_clientSpace.clientFd = INVALID_SOCKET;
+    // the connection may already carry requests of other threads when the workspace is not ready yet
+    (void)pthread_once(&g_clientOnce, InitParamConnection);
     return InitParamWorkSpace(&g_clientSpace.paramSpace, 1);
 }
 
@@ -68,6 +99,10 @@ void ClientInit(void)
 void ClientDeinit(void)
 {
     CloseParamWorkSpace(&g_clientSpace.paramSpace);
+    free(g_clientSpace.recvMsg);
+    g_clientSpace.recvMsg = NULL;
+    free(g_clientSpace.async.recvMsg);
+    g_clientSpace.async.recvMsg = NULL;
 }
 
 static ParamSecurityOps *GetClientParamSecurityOps(void)
@@ -95,6 +130,25 @@ static int FillLabelContent(const ParamMessage *request, uint32_t *start, uint32
     return 0;
 }
 
+static int FillNameValueContent(const ParamMessage *request, uint32_t *start, uint32_t reserved,
+    const char *name, const char *value)
+{
+    uint32_t bufferSize = request->msgSize - sizeof(ParamMessage) - reserved;
+    uint32_t length = strlen(name) + 1 + strlen(value);
+    uint32_t offset = *start;
+    if ((offset + sizeof(ParamMsgContent) + PARAM_ALIGN(length + 1)) > bufferSize) {
+        return PARAM_CODE_REACHED_MAX;
+    }
+    ParamMsgContent *content = (ParamMsgContent *)(request->data + offset);
+    content->type = PARAM_NAME_VALUE;
+    content->contentSize = length + 1;
+    int ret = sprintf_s(content->content, content->contentSize, "%s=%s", name, value);
+    PARAM_CHECK(ret > EOK, return -1, "Failed to fill %s", name);
+    offset += sizeof(ParamMsgContent) + PARAM_ALIGN(content->contentSize);
+    *start = offset;
+    return 0;
+}
+
 static int ProcessRecvMsg(const ParamMessage *recvMsg)
 {
     PARAM_LOGD("ProcessRecvMsg type: %u msgId: %u name %s", recvMsg->type, recvMsg->id.msgId, recvMsg->key);
@@ -103,6 +157,12 @@ static int ProcessRecvMsg(const ParamMessage *recvMsg)
         case MSG_SET_PARAM:
             result = ((ParamResponseMessage *)recvMsg)->result;
             break;
+        case MSG_SET_PARAM_BATCH:
+            result = ((ParamBatchResponseMessage *)recvMsg)->result;
+            break;
+        case MSG_WAIT_PARAM: // the wait timed out on the server
+            result = ((ParamResponseMessage *)recvMsg)->result;
+            break;
         case MSG_NOTIFY_PARAM:
             result = 0;
             break;
@@ -112,46 +172,193 @@ static int ProcessRecvMsg(const ParamMessage *recvMsg)
     return result;
 }
 
-static int StartRequest(int *fd, ParamMessage *request, int timeout)
+static int ConnectParamServer(int *fd)
 {
-    int ret = 0;
+    if (*fd != INVALID_SOCKET) {
+        return 0;
+    }
+    int clientFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    PARAM_CHECK(clientFd >= 0, return PARAM_CODE_FAIL_CONNECT, "Failed to create socket");
+    int ret = ConntectServer(clientFd, CLIENT_PIPE_NAME);
+    PARAM_CHECK(ret == 0, close(clientFd);
+        return PARAM_CODE_FAIL_CONNECT, "Failed to connect server");
     struct timeval time;
-    time.tv_sec = timeout;
+    time.tv_sec = DEFAULT_PARAM_SET_TIMEOUT;
     time.tv_usec = 0;
-    do {
-        int clientFd = *fd;
-        if (clientFd == INVALID_SOCKET) {
-            clientFd = socket(AF_UNIX, SOCK_STREAM, 0);
-            PARAM_CHECK(clientFd >= 0, return PARAM_CODE_FAIL_CONNECT, "Failed to create socket");
-            ret = ConntectServer(clientFd, CLIENT_PIPE_NAME);
-            PARAM_CHECK(ret == 0, close(clientFd);
-                return PARAM_CODE_FAIL_CONNECT, "Failed to connect server");
-            setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, (char *)&time, sizeof(struct timeval));
-            setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, (char *)&time, sizeof(struct timeval));
-            *fd = clientFd;
+    setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, (char *)&time, sizeof(struct timeval));
+    *fd = clientFd;
+    return 0;
+}
+
+static void CloseParamConnection(int fd, int result)
+{
+    if (g_clientSpace.clientFd == fd) {
+        g_clientSpace.clientFd = INVALID_SOCKET;
+    }
+    if (g_clientSpace.recvFd == fd) { // the receiving thread closes it when the read fails
+        shutdown(fd, SHUT_RDWR);
+    } else {
+        close(fd);
+    }
+    ParamRequestNode *node = g_clientSpace.requests;
+    while (node != NULL) {
+        if (node->fd == fd && !node->done) {
+            node->done = 1;
+            node->result = result;
+        }
+        node = node->next;
+    }
+    pthread_cond_broadcast(&g_clientSpace.cond);
+}
+
+static int SendParamRequest(ParamRequestNode *node)
+{
+    int ret = 0;
+    // the server may have closed an idle connection, reconnect once
+    for (int i = 0; i < PARAM_SEND_RETRY; i++) {
+        ret = ConnectParamServer(&g_clientSpace.clientFd);
+        PARAM_CHECK(ret == 0, return ret, "Failed to connect server");
+        ssize_t sendLen = send(g_clientSpace.clientFd, (char *)node->request, node->request->msgSize, MSG_NOSIGNAL);
+        if (sendLen == (ssize_t)node->request->msgSize) {
+            node->fd = g_clientSpace.clientFd;
+            return 0;
+        }
+        PARAM_LOGE("Send msg fail errno %d %zd", errno, sendLen);
+        ret = (errno == EAGAIN) ? PARAM_CODE_TIMEOUT : PARAM_CODE_FAIL_CONNECT;
+        CloseParamConnection(g_clientSpace.clientFd, ret);
+    }
+    return ret;
+}
+
+static int IsTimeout(const struct timespec *deadline)
+{
+    struct timespec now = {};
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec > deadline->tv_sec) ||
+        ((now.tv_sec == deadline->tv_sec) && (now.tv_nsec >= deadline->tv_nsec));
+}
+
+// ms left before the deadline, rounded up
+static int GetRemainingTime(const struct timespec *deadline)
+{
+    struct timespec now = {};
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    if (IsTimeout(deadline)) {
+        return 0;
+    }
+    int64_t remaining = (int64_t)(deadline->tv_sec - now.tv_sec) * 1000 + // 1000 ms of a second
+        (deadline->tv_nsec - now.tv_nsec + 999999) / 1000000; // 999999 1000000 round up to ms
+    return (remaining > INT32_MAX) ? INT32_MAX : (int)remaining;
+}
+
+static int RecvParamMessage(int fd, ParamMessage *msg, const struct timespec *deadline, uint32_t *recvSize)
+{
+    uint32_t msgSize = sizeof(ParamMessage);
+    *recvSize = 0;
+    while (*recvSize < msgSize) {
+        int timeout = GetRemainingTime(deadline);
+        if (*recvSize == 0) { // the waiting threads check their own timeout between responses
+            timeout = (timeout < PARAM_RECV_CHECK_INTERVAL) ? timeout : PARAM_RECV_CHECK_INTERVAL;
         }
-        ssize_t recvLen = 0;
-        ssize_t sendLen = send(clientFd, (char *)request, request->msgSize, 0);
-        if (sendLen > 0) {
-            recvLen = recv(clientFd, (char *)request, RECV_BUFFER_MAX, 0);
-            if (recvLen > 0) {
-                break;
-            }
+        struct pollfd pollFd = { fd, POLLIN, 0 };
+        int ret = poll(&pollFd, 1, timeout);
+        if (ret < 0 && errno == EINTR) {
+            continue;
         }
-        ret = errno;
-        close(clientFd);
-        *fd = INVALID_SOCKET;
-        if (errno == EAGAIN || recvLen == 0) {
-            ret = PARAM_CODE_TIMEOUT;
-            break;
+        PARAM_CHECK(ret >= 0, return PARAM_CODE_FAIL_CONNECT, "Poll msg fail errno %d", errno);
+        if (ret == 0) {
+            PARAM_CHECK(*recvSize == 0, return PARAM_CODE_TIMEOUT,
+                "Recv msg timeout, %u of %u bytes received", *recvSize, msgSize);
+            return PARAM_CODE_TIMEOUT;
+        }
+        ssize_t recvLen = recv(fd, (char *)msg + *recvSize, msgSize - *recvSize, MSG_DONTWAIT);
+        if (recvLen < 0 && (errno == EAGAIN || errno == EINTR)) {
+            continue;
         }
-        PARAM_LOGE("Send or recv msg fail errno %d %zd %zd", errno, sendLen, recvLen);
-    } while (1);
+        PARAM_CHECK(recvLen > 0, return PARAM_CODE_FAIL_CONNECT, "Recv msg fail errno %d %zd", errno, recvLen);
+        *recvSize += (uint32_t)recvLen;
+        if (*recvSize == sizeof(ParamMessage)) {
+            msgSize = msg->msgSize;
+            PARAM_CHECK(msgSize >= sizeof(ParamMessage) && msgSize <= RECV_BUFFER_MAX,
+                return PARAM_CODE_FAIL_CONNECT, "Invalid msg size %u", msgSize);
+        }
+    }
+    return 0;
+}
 
-    if (ret == 0) { // check result
-        ret = ProcessRecvMsg(request);
+static void DispatchParamResponse(const ParamMessage *recvMsg)
+{
+    ParamRequestNode *node = g_clientSpace.requests;
+    while (node != NULL) {
+        if (!node->done && node->request->id.msgId == recvMsg->id.msgId) {
+            int ret = memcpy_s(node->request, RECV_BUFFER_MAX, recvMsg, recvMsg->msgSize);
+            node->result = (ret == EOK) ? ProcessRecvMsg(node->request) : PARAM_CODE_INVALID_PARAM;
+            node->answered = 1;
+            node->done = 1;
+            return;
+        }
+        node = node->next;
     }
-    return ret;
+    PARAM_LOGD("Drop msg type %u msgId %u name %s", recvMsg->type, recvMsg->id.msgId, recvMsg->key);
+}
+
+static void ReceiveParamResponse(const struct timespec *deadline)
+{
+    int fd = g_clientSpace.clientFd;
+    g_clientSpace.recvFd = fd;
+    pthread_mutex_unlock(&g_clientSpace.mutex);
+    uint32_t recvSize = 0;
+    int ret = RecvParamMessage(fd, g_clientSpace.recvMsg, deadline, &recvSize);
+    pthread_mutex_lock(&g_clientSpace.mutex);
+    g_clientSpace.recvFd = INVALID_SOCKET;
+    if (ret == 0) {
+        DispatchParamResponse(g_clientSpace.recvMsg);
+    } else if (ret != PARAM_CODE_TIMEOUT || recvSize != 0) {
+        // the rest of a partial message can not be told from the next one
+        CloseParamConnection(fd, ret);
+    }
+    pthread_cond_broadcast(&g_clientSpace.cond);
+}
+
+static int StartRequest(ParamRequestNode *node, int timeout)
+{
+    struct timespec deadline = {};
+    (void)clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout;
+    node->fd = INVALID_SOCKET;
+    pthread_mutex_lock(&g_clientSpace.mutex);
+    if (g_clientSpace.recvMsg == NULL) {
+        g_clientSpace.recvMsg = (ParamMessage *)malloc(RECV_BUFFER_MAX);
+        PARAM_CHECK(g_clientSpace.recvMsg != NULL, pthread_mutex_unlock(&g_clientSpace.mutex);
+            return -1, "Failed to malloc for recv");
+    }
+    int ret = SendParamRequest(node);
+    if (ret != 0) {
+        pthread_mutex_unlock(&g_clientSpace.mutex);
+        return ret;
+    }
+    // requests share the connection, whoever is free reads it and hands the responses out by msgId
+    node->next = g_clientSpace.requests;
+    g_clientSpace.requests = node;
+    while (!node->done) {
+        if (IsTimeout(&deadline)) {
+            node->result = PARAM_CODE_TIMEOUT;
+            break;
+        }
+        if (g_clientSpace.recvFd == INVALID_SOCKET) {
+            ReceiveParamResponse(&deadline);
+        } else {
+            pthread_cond_timedwait(&g_clientSpace.cond, &g_clientSpace.mutex, &deadline);
+        }
+    }
+    ParamRequestNode **prev = &g_clientSpace.requests;
+    while (*prev != node) {
+        prev = &(*prev)->next;
+    }
+    *prev = node->next;
+    pthread_cond_broadcast(&g_clientSpace.cond);
+    pthread_mutex_unlock(&g_clientSpace.mutex);
+    return node->result;
 }
 
 static int NeedCheckParamPermission(const char *name)
@@ -175,59 +382,161 @@ static int NeedCheckParamPermission(const char *name)
     return 0;
 }
 
-int SystemSetParameter(const char *name, const char *value)
+static ParamMessage *CreateSetRequest(uint32_t type, const char *name, const char *value, int *result)
 {
-    InitParamClient();
-    PARAM_CHECK(name != NULL && value != NULL, return -1, "Invalid name or value");
     int ret = CheckParamName(name, 0);
-    PARAM_CHECK(ret == 0, return ret, "Illegal param name %s", name);
+    PARAM_CHECK(ret == 0, *result = ret;
+        return NULL, "Illegal param name %s", name);
+    *result = -1;
     uint32_t msgSize = sizeof(ParamMessage) + sizeof(ParamMsgContent) + PARAM_ALIGN(strlen(value) + 1);
     uint32_t labelLen = 0;
     ParamSecurityOps *ops = GetClientParamSecurityOps();
     if (NeedCheckParamPermission(name)) {
         ret = CheckParamPermission(&g_clientSpace.paramSpace, g_clientSpace.paramSpace.securityLabel, name, DAC_WRITE);
-        PARAM_CHECK(ret == 0, return ret, "Forbit to set parameter %s", name);
+        PARAM_CHECK(ret == 0, *result = ret;
+            return NULL, "Forbit to set parameter %s", name);
     } else if (!LABEL_IS_ALL_PERMITTED(g_clientSpace.paramSpace.securityLabel)) { // check local can check permissions
-        PARAM_CHECK(ops != NULL && ops->securityEncodeLabel != NULL, return -1, "Invalid securityEncodeLabel");
+        PARAM_CHECK(ops != NULL && ops->securityEncodeLabel != NULL, return NULL, "Invalid securityEncodeLabel");
         ret = ops->securityEncodeLabel(g_clientSpace.paramSpace.securityLabel, NULL, &labelLen);
-        PARAM_CHECK(ret == 0, return -1, "Failed to get label length");
+        PARAM_CHECK(ret == 0, return NULL, "Failed to get label length");
     }
     msgSize += sizeof(ParamMsgContent) + labelLen;
     msgSize = (msgSize < RECV_BUFFER_MAX) ? RECV_BUFFER_MAX : msgSize;
 
-    ParamMessage *request = (ParamMessage *)CreateParamMessage(MSG_SET_PARAM, name, msgSize);
-    PARAM_CHECK(request != NULL, return -1, "Failed to malloc for connect");
+    ParamMessage *request = (ParamMessage *)CreateParamMessage(type, name, msgSize);
+    PARAM_CHECK(request != NULL, return NULL, "Failed to malloc for connect");
     uint32_t offset = 0;
     ret = FillParamMsgContent(request, &offset, PARAM_VALUE, value, strlen(value));
     PARAM_CHECK(ret == 0, free(request);
-        return -1, "Failed to fill value");
+        return NULL, "Failed to fill value");
     ret = FillLabelContent(request, &offset, labelLen);
     PARAM_CHECK(ret == 0, free(request);
-        return -1, "Failed to fill label");
+        return NULL, "Failed to fill label");
     request->msgSize = offset + sizeof(ParamMessage);
     request->id.msgId = atomic_fetch_add(&g_requestId, 1);
+    *result = 0;
+    return request;
+}
 
-    pthread_mutex_lock(&g_clientSpace.mutex);
-    ret = StartRequest(&g_clientSpace.clientFd, request, DEFAULT_PARAM_SET_TIMEOUT);
-    pthread_mutex_unlock(&g_clientSpace.mutex);
+int SystemSetParameter(const char *name, const char *value)
+{
+    InitParamClient();
+    PARAM_CHECK(name != NULL && value != NULL, return -1, "Invalid name or value");
+    int ret = 0;
+    ParamMessage *request = CreateSetRequest(MSG_SET_PARAM, name, value, &ret);
+    PARAM_CHECK(request != NULL, return ret, "Failed to create request for %s", name);
+    ParamRequestNode node = {};
+    node.request = request;
+    ret = StartRequest(&node, DEFAULT_PARAM_SET_TIMEOUT);
     free(request);
     return ret;
 }
 
-int SystemWaitParameter(const char *name, const char *value, int32_t timeout)
+int SystemDeleteParameter(const char *name)
 {
     InitParamClient();
     PARAM_CHECK(name != NULL, return -1, "Invalid name");
+    int ret = 0;
+    // the value is not used, the name keeps the content of the message not empty
+    ParamMessage *request = CreateSetRequest(MSG_DEL_PARAM, name, name, &ret);
+    PARAM_CHECK(request != NULL, return ret, "Failed to create request for %s", name);
+    ParamRequestNode node = {};
+    node.request = request;
+    ret = StartRequest(&node, DEFAULT_PARAM_SET_TIMEOUT);
+    free(request);
+    return ret;
+}
+
+static int CheckSetParameters(const char *names[], const char *values[], uint32_t count, uint32_t *labelLen)
+{
+    int needLabel = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        PARAM_CHECK(names[i] != NULL && values[i] != NULL, return -1, "Invalid name or value %u", i);
+        int ret = CheckParamName(names[i], 0);
+        PARAM_CHECK(ret == 0, return ret, "Illegal param name %s", names[i]);
+        if (NeedCheckParamPermission(names[i])) {
+            ret = CheckParamPermission(&g_clientSpace.paramSpace,
+                g_clientSpace.paramSpace.securityLabel, names[i], DAC_WRITE);
+            PARAM_CHECK(ret == 0, return ret, "Forbit to set parameter %s", names[i]);
+        } else {
+            needLabel = 1;
+        }
+    }
+    *labelLen = 0;
+    ParamSecurityOps *ops = GetClientParamSecurityOps();
+    if (needLabel && !LABEL_IS_ALL_PERMITTED(g_clientSpace.paramSpace.securityLabel)) {
+        PARAM_CHECK(ops != NULL && ops->securityEncodeLabel != NULL, return -1, "Invalid securityEncodeLabel");
+        int ret = ops->securityEncodeLabel(g_clientSpace.paramSpace.securityLabel, NULL, labelLen);
+        PARAM_CHECK(ret == 0, return -1, "Failed to get label length");
+    }
+    return 0;
+}
+
+int SystemSetParameters(const char *names[], const char *values[], int results[], unsigned int count)
+{
+    InitParamClient();
+    PARAM_CHECK(names != NULL && values != NULL, return -1, "Invalid names or values");
+    PARAM_CHECK(count <= PARAM_BATCH_MAX, return PARAM_CODE_INVALID_PARAM, "Too many parameters %u", count);
+    uint32_t labelLen = 0;
+    int ret = CheckSetParameters(names, values, count, &labelLen);
+    PARAM_CHECK(ret == 0, return ret, "Failed to check parameters");
+    if (count == 0) {
+        return 0;
+    }
+
+    ParamMessage *request = (ParamMessage *)CreateParamMessage(MSG_SET_PARAM_BATCH, "*", RECV_BUFFER_MAX);
+    PARAM_CHECK(request != NULL, return -1, "Failed to malloc for batch");
+    // keep room for the label at the end, parameters beyond one message are sent in the next one
+    uint32_t reserved = sizeof(ParamMsgContent) + PARAM_ALIGN(labelLen);
+    int result = 0;
+    uint32_t start = 0;
+    while (start < count) {
+        request->type = MSG_SET_PARAM_BATCH;
+        request->msgSize = RECV_BUFFER_MAX;
+        uint32_t offset = 0;
+        uint32_t end = start;
+        while (end < count && FillNameValueContent(request, &offset, reserved, names[end], values[end]) == 0) {
+            end++;
+        }
+        PARAM_CHECK(end > start, ret = PARAM_CODE_INVALID_VALUE;
+            break, "Failed to fill parameter %s", names[start]);
+        ret = FillLabelContent(request, &offset, labelLen);
+        PARAM_CHECK(ret == 0, break, "Failed to fill label");
+        request->msgSize = offset + sizeof(ParamMessage);
+        request->id.msgId = atomic_fetch_add(&g_requestId, 1);
+
+        ParamRequestNode node = {};
+        node.request = request;
+        ret = StartRequest(&node, DEFAULT_PARAM_SET_TIMEOUT);
+        PARAM_CHECK(node.answered, break, "Failed to send batch %d", ret);
+
+        ParamBatchResponseMessage *response = (ParamBatchResponseMessage *)request;
+        for (uint32_t i = start; results != NULL && i < end; i++) {
+            results[i] = (i - start < response->count) ? response->results[i - start] : ret;
+        }
+        result = (result == 0) ? ret : result;
+        ret = 0;
+        start = end;
+    }
+    for (uint32_t i = start; results != NULL && i < count; i++) {
+        results[i] = ret;
+    }
+    free(request);
+    return (ret != 0) ? ret : result;
+}
+
+static ParamMessage *CreateWaitRequest(const char *name, const char *value, int32_t timeout, int *result)
+{
     int ret = CheckParamName(name, 0);
-    PARAM_CHECK(ret == 0, return ret, "Illegal param name %s", name);
+    PARAM_CHECK(ret == 0, *result = ret;
+        return NULL, "Illegal param name %s", name);
     ParamHandle handle = 0;
     ret = ReadParamWithCheck(&g_clientSpace.paramSpace, name, DAC_READ, &handle);
     if (ret != PARAM_CODE_NOT_FOUND && ret != 0) {
-        PARAM_CHECK(ret == 0, return ret, "Forbid to wait parameter %s", name);
-    }
-    if (timeout <= 0) {
-        timeout = DEFAULT_PARAM_WAIT_TIMEOUT;
+        PARAM_CHECK(ret == 0, *result = ret;
+            return NULL, "Forbid to wait parameter %s", name);
     }
+    *result = -1;
     uint32_t msgSize = sizeof(ParamMessage) + sizeof(ParamMsgContent) + sizeof(ParamMsgContent) + sizeof(uint32_t);
     msgSize = (msgSize < RECV_BUFFER_MAX) ? RECV_BUFFER_MAX : msgSize;
     uint32_t offset = 0;
@@ -235,16 +544,16 @@ int SystemWaitParameter(const char *name, const char *value, int32_t timeout)
     if (value != NULL && strlen(value) > 0) {
         msgSize += PARAM_ALIGN(strlen(value) + 1);
         request = (ParamMessage *)CreateParamMessage(MSG_WAIT_PARAM, name, msgSize);
-        PARAM_CHECK(request != NULL, return -1, "Failed to malloc for wait");
+        PARAM_CHECK(request != NULL, return NULL, "Failed to malloc for wait");
         ret = FillParamMsgContent(request, &offset, PARAM_VALUE, value, strlen(value));
     } else {
         msgSize += PARAM_ALIGN(1);
         request = (ParamMessage *)CreateParamMessage(MSG_WAIT_PARAM, name, msgSize);
-        PARAM_CHECK(request != NULL, return -1, "Failed to malloc for wait");
+        PARAM_CHECK(request != NULL, return NULL, "Failed to malloc for wait");
         ret = FillParamMsgContent(request, &offset, PARAM_VALUE, "*", 1);
     }
     PARAM_CHECK(ret == 0, free(request);
-        return -1, "Failed to fill value");
+        return NULL, "Failed to fill value");
     ParamMsgContent *content = (ParamMsgContent *)(request->data + offset);
     content->type = PARAM_WAIT_TIMEOUT;
     content->contentSize = sizeof(uint32_t);
@@ -253,39 +562,409 @@ int SystemWaitParameter(const char *name, const char *value, int32_t timeout)
 
     request->msgSize = offset + sizeof(ParamMessage);
     request->id.waitId = atomic_fetch_add(&g_requestId, 1);
-    int fd = INVALID_SOCKET;
-    ret = StartRequest(&fd, request, timeout);
-    if (fd != INVALID_SOCKET) {
-        close(fd);
+    *result = 0;
+    return request;
+}
+
+static int WaitParameterLocal(const char *name, const char *value, int32_t timeout)
+{
+    int ret = CheckParamName(name, 0);
+    PARAM_CHECK(ret == 0, return ret, "Illegal param name %s", name);
+    ParamHandle handle = 0;
+    ret = ReadParamWithCheck(&g_clientSpace.paramSpace, name, DAC_READ, &handle);
+    PARAM_CHECK(ret == 0 || ret == PARAM_CODE_NOT_FOUND, return ret, "Forbid to wait parameter %s", name);
+    return WaitParamValue(&g_clientSpace.paramSpace, name, (value != NULL && strlen(value) > 0) ? value : "*", timeout);
+}
+
+int SystemWaitParameter(const char *name, const char *value, int32_t timeout)
+{
+    InitParamClient();
+    PARAM_CHECK(name != NULL, return -1, "Invalid name");
+    if (timeout <= 0) {
+        timeout = DEFAULT_PARAM_WAIT_TIMEOUT;
     }
+    // wait on the futex of the shared memory, init is asked only when the workspace is not mapped
+    if (PARAM_TEST_FLAG(g_clientSpace.paramSpace.flags, WORKSPACE_FLAGS_INIT)) {
+        int ret = WaitParameterLocal(name, value, timeout);
+        PARAM_LOGI("SystemWaitParameter %s value %s result %d ", name, value, ret);
+        return ret;
+    }
+    int ret = 0;
+    ParamMessage *request = CreateWaitRequest(name, value, timeout, &ret);
+    PARAM_CHECK(request != NULL, return ret, "Failed to create request for %s", name);
+    ParamRequestNode node = {};
+    node.request = request;
+    ret = StartRequest(&node, timeout);
     free(request);
     PARAM_LOGI("SystemWaitParameter %s value %s result %d ", name, value, ret);
     return ret;
 }
 
+int SystemGetParameterChangeSerial(const char *prefix, uint32_t *serial)
+{
+    InitParamClient();
+    PARAM_CHECK(serial != NULL, return -1, "Invalid serial");
+    atomic_uint *changeSerial = GetParamChangeSerial(&g_clientSpace.paramSpace, prefix);
+    PARAM_CHECK(changeSerial != NULL, return PARAM_CODE_NOT_INIT, "Invalid workspace");
+    *serial = atomic_load_explicit(changeSerial, memory_order_acquire);
+    return 0;
+}
+
+int SystemWaitParameterChange(const char *prefix, uint32_t *serial, int32_t timeout)
+{
+    InitParamClient();
+    if (timeout <= 0) {
+        timeout = DEFAULT_PARAM_WAIT_TIMEOUT;
+    }
+    return WaitParamChange(&g_clientSpace.paramSpace, prefix, serial, timeout);
+}
+
+static void FailAsyncRequests(int result)
+{
+    ParamAsyncClient *async = &g_clientSpace.async;
+    while (async->requests != NULL) {
+        ParamAsyncRequest *node = async->requests;
+        async->requests = node->next;
+        pthread_mutex_unlock(&async->mutex);
+        node->callback(node->name, NULL, result, node->context);
+        free(node);
+        pthread_mutex_lock(&async->mutex);
+    }
+}
+
+static void CloseAsyncConnection(void)
+{
+    ParamAsyncClient *async = &g_clientSpace.async;
+    if (async->fd != INVALID_SOCKET) { // closing it also removes it from the epoll set
+        close(async->fd);
+        async->fd = INVALID_SOCKET;
+    }
+    async->recvSize = 0;
+}
+
+static int StartAsyncRequest(ParamMessage *request, ParameterAsyncCallback callback, void *context)
+{
+    ParamAsyncRequest *node = (ParamAsyncRequest *)calloc(1, sizeof(ParamAsyncRequest));
+    PARAM_CHECK(node != NULL, free(request);
+        return -1, "Failed to malloc for async request");
+    node->msgId = request->id.msgId;
+    node->callback = callback;
+    node->context = context;
+    int ret = strcpy_s(node->name, sizeof(node->name), request->key);
+    PARAM_CHECK(ret == EOK, free(request);
+        free(node);
+        return -1, "Failed to copy name %s", request->key);
+
+    ParamAsyncClient *async = &g_clientSpace.async;
+    pthread_mutex_lock(&async->mutex);
+    if (async->recvMsg == NULL) {
+        async->recvMsg = (ParamMessage *)malloc(RECV_BUFFER_MAX);
+    }
+    int connected = async->fd != INVALID_SOCKET;
+    ret = (async->recvMsg != NULL) ? ConnectParamServer(&async->fd) : -1;
+    if (ret == 0 && !connected) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = async->fd;
+        ret = epoll_ctl(async->eventFd, EPOLL_CTL_ADD, async->fd, &event);
+        PARAM_CHECK(ret == 0, CloseAsyncConnection();
+            ret = PARAM_CODE_FAIL_CONNECT, "Failed to add connection errno %d", errno);
+    }
+    if (ret == 0) {
+        ssize_t sendLen = send(async->fd, (char *)request, request->msgSize, MSG_NOSIGNAL);
+        if (sendLen != (ssize_t)request->msgSize) {
+            PARAM_LOGE("Send msg fail errno %d %zd", errno, sendLen);
+            // requests in flight are failed by the next SystemProcessParameterEvents
+            CloseAsyncConnection();
+            uint64_t notify = 1;
+            (void)write(async->notifyFd, &notify, sizeof(notify));
+            ret = PARAM_CODE_FAIL_CONNECT;
+        }
+    }
+    if (ret == 0) {
+        node->next = async->requests;
+        async->requests = node;
+    }
+    pthread_mutex_unlock(&async->mutex);
+    free(request);
+    if (ret != 0) {
+        free(node);
+    }
+    return ret;
+}
+
+int SystemSetParameterAsync(const char *name, const char *value, ParameterAsyncCallback callback, void *context)
+{
+    InitParamClient();
+    PARAM_CHECK(name != NULL && value != NULL && callback != NULL, return -1, "Invalid name or value");
+    int ret = 0;
+    ParamMessage *request = CreateSetRequest(MSG_SET_PARAM, name, value, &ret);
+    PARAM_CHECK(request != NULL, return ret, "Failed to create request for %s", name);
+    return StartAsyncRequest(request, callback, context);
+}
+
+int SystemWaitParameterAsync(const char *name, const char *value, int32_t timeout,
+    ParameterAsyncCallback callback, void *context)
+{
+    InitParamClient();
+    PARAM_CHECK(name != NULL && callback != NULL, return -1, "Invalid name");
+    if (timeout <= 0) {
+        timeout = DEFAULT_PARAM_WAIT_TIMEOUT;
+    }
+    int ret = 0;
+    ParamMessage *request = CreateWaitRequest(name, value, timeout, &ret);
+    PARAM_CHECK(request != NULL, return ret, "Failed to create request for %s", name);
+    return StartAsyncRequest(request, callback, context);
+}
+
+int SystemGetParameterEventFd(void)
+{
+    InitParamClient();
+    return g_clientSpace.async.eventFd;
+}
+
+static void DispatchAsyncResponse(const ParamMessage *recvMsg)
+{
+    ParamAsyncClient *async = &g_clientSpace.async;
+    ParamAsyncRequest **prev = &async->requests;
+    while (*prev != NULL && (*prev)->msgId != recvMsg->id.msgId) {
+        prev = &(*prev)->next;
+    }
+    ParamAsyncRequest *node = *prev;
+    if (node == NULL) {
+        PARAM_LOGD("Drop msg type %u msgId %u name %s", recvMsg->type, recvMsg->id.msgId, recvMsg->key);
+        return;
+    }
+    *prev = node->next;
+    const char *value = NULL;
+    if (recvMsg->type == MSG_NOTIFY_PARAM) {
+        uint32_t offset = 0;
+        ParamMsgContent *valueContent = GetNextContent(recvMsg, &offset);
+        value = (valueContent != NULL) ? valueContent->content : NULL;
+    }
+    int result = ProcessRecvMsg(recvMsg);
+    // the callback may start new requests
+    pthread_mutex_unlock(&async->mutex);
+    node->callback(node->name, value, result, node->context);
+    free(node);
+    pthread_mutex_lock(&async->mutex);
+}
+
+int SystemProcessParameterEvents(void)
+{
+    InitParamClient();
+    ParamAsyncClient *async = &g_clientSpace.async;
+    int ret = 0;
+    pthread_mutex_lock(&async->mutex);
+    uint64_t notify = 0;
+    (void)read(async->notifyFd, &notify, sizeof(notify));
+    while (async->fd != INVALID_SOCKET) {
+        ParamMessage *msg = async->recvMsg;
+        uint32_t msgSize = (async->recvSize < sizeof(ParamMessage)) ? sizeof(ParamMessage) : msg->msgSize;
+        ssize_t recvLen = recv(async->fd, (char *)msg + async->recvSize, msgSize - async->recvSize, MSG_DONTWAIT);
+        if (recvLen < 0 && (errno == EAGAIN || errno == EINTR)) {
+            break;
+        }
+        PARAM_CHECK(recvLen > 0, CloseAsyncConnection();
+            ret = PARAM_CODE_FAIL_CONNECT;
+            break, "Recv msg fail errno %d %zd", errno, recvLen);
+        async->recvSize += (uint32_t)recvLen;
+        if (async->recvSize == sizeof(ParamMessage)) {
+            PARAM_CHECK(msg->msgSize >= sizeof(ParamMessage) && msg->msgSize <= RECV_BUFFER_MAX,
+                CloseAsyncConnection();
+                ret = PARAM_CODE_FAIL_CONNECT;
+                break, "Invalid msg size %u", msg->msgSize);
+        }
+        if (async->recvSize == msg->msgSize) {
+            async->recvSize = 0;
+            DispatchAsyncResponse(msg);
+        }
+    }
+    if (async->fd == INVALID_SOCKET) { // nothing answers the requests sent on a closed connection
+        FailAsyncRequests(PARAM_CODE_FAIL_CONNECT);
+    }
+    pthread_mutex_unlock(&async->mutex);
+    return ret;
+}
+
+static int ReadParamCacheEntry(ParamCacheEntry *entry, const char *name, uint32_t hash, ParamCacheEntry *result)
+{
+    uint32_t serial = atomic_load_explicit(&entry->serial, memory_order_acquire);
+    if ((serial & 1) != 0 || entry->hash != hash || strncmp(entry->name, name, sizeof(entry->name)) != 0) {
+        return PARAM_CODE_NOT_FOUND;
+    }
+    result->hash = hash;
+    result->areaIndex = entry->areaIndex;
+    result->generation = entry->generation;
+    result->handle = entry->handle;
+    result->labelIndex = entry->labelIndex;
+    result->result = entry->result;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&entry->serial, memory_order_relaxed) != serial) {
+        return PARAM_CODE_NOT_FOUND;
+    }
+    // the server changed labels of the area after the entry was filled
+    if (result->generation != GetParamAreaGeneration(&g_clientSpace.paramSpace, result->areaIndex)) {
+        return PARAM_CODE_NOT_FOUND;
+    }
+    return 0;
+}
+
+static void WriteParamCacheEntry(ParamCacheEntry *entry, const char *name, const ParamCacheEntry *value)
+{
+    uint32_t serial = atomic_load_explicit(&entry->serial, memory_order_relaxed);
+    // another thread is filling the entry, the cache is only a hint so leave it to that thread
+    if ((serial & 1) != 0 || !atomic_compare_exchange_strong_explicit(&entry->serial, &serial, serial + 1,
+        memory_order_acquire, memory_order_relaxed)) {
+        return;
+    }
+    if (name != NULL && strcpy_s(entry->name, sizeof(entry->name), name) != EOK) {
+        entry->name[0] = '\0';
+    }
+    entry->hash = value->hash;
+    entry->areaIndex = value->areaIndex;
+    entry->generation = value->generation;
+    entry->handle = value->handle;
+    entry->labelIndex = value->labelIndex;
+    entry->result = value->result;
+    atomic_store_explicit(&entry->serial, serial + 2, memory_order_release); // 2 next even serial
+}
+
+static int ResolveParamCacheEntry(const char *name, uint32_t op, ParamCacheEntry *entry)
+{
+    entry->areaIndex = GetWorkSpaceIndex(name);
+    // read before the lookup, so a label added meanwhile makes the entry stale
+    entry->generation = GetParamAreaGeneration(&g_clientSpace.paramSpace, entry->areaIndex);
+    int ret = ReadParamIndex(&g_clientSpace.paramSpace, name, &entry->handle, &entry->labelIndex);
+    entry->result = CheckParamLabelPermission(&g_clientSpace.paramSpace,
+        name, entry->areaIndex, entry->labelIndex, op);
+    if (entry->result == 0) {
+        entry->result = ret;
+    }
+    return entry->result;
+}
+
+static int ReadParamWithCache(const char *name, uint32_t op, ParamHandle *handle)
+{
+    uint32_t nameLen = strlen(name);
+    uint32_t hash = GetTrieKeyHash(name, nameLen);
+    ParamCacheEntry *entry = &g_clientSpace.cache[hash % PARAM_CLIENT_CACHE_SIZE];
+    ParamCacheEntry cached = {};
+    if (ReadParamCacheEntry(entry, name, hash, &cached) == 0) {
+        // the label and security ops of this process may change, so only the lookup is reused
+        int ret = CheckParamLabelPermission(&g_clientSpace.paramSpace, name, cached.areaIndex, cached.labelIndex, op);
+        *handle = (ret == 0) ? cached.handle : (ParamHandle)-1;
+        return ret;
+    }
+    int ret = ResolveParamCacheEntry(name, op, &cached);
+    *handle = (ret == 0) ? cached.handle : (ParamHandle)-1;
+    if (ret == 0 && nameLen < PARAM_NAME_LEN_MAX) {
+        cached.hash = hash;
+        WriteParamCacheEntry(entry, name, &cached);
+    }
+    return ret;
+}
+
 int SystemGetParameter(const char *name, char *value, unsigned int *len)
 {
     InitParamClient();
     PARAM_CHECK(name != NULL && len != NULL, return -1, "The name or value is null");
     ParamHandle handle = 0;
-    int ret = ReadParamWithCheck(&g_clientSpace.paramSpace, name, DAC_READ, &handle);
+    int ret = ReadParamWithCache(name, DAC_READ, &handle);
     if (ret != PARAM_CODE_NOT_FOUND && ret != 0) {
         PARAM_CHECK(ret == 0, return ret, "Forbid to get parameter %s", name);
     }
     return ReadParamValue(&g_clientSpace.paramSpace, handle, value, len);
 }
 
+static int CheckParamLabelOnce(uint32_t labels[][2], uint32_t *labelCount, // 2 area and label
+    const char *name, uint32_t areaIndex, uint32_t labelIndex)
+{
+    for (uint32_t i = 0; i < *labelCount; i++) {
+        if (labels[i][0] == areaIndex && labels[i][1] == labelIndex) {
+            return 0;
+        }
+    }
+    int ret = CheckParamLabelPermission(&g_clientSpace.paramSpace, name, areaIndex, labelIndex, DAC_READ);
+    PARAM_CHECK(ret == 0, return ret, "Forbid to get parameter %s", name);
+    labels[*labelCount][0] = areaIndex;
+    labels[*labelCount][1] = labelIndex;
+    (*labelCount)++;
+    return 0;
+}
+
+int SystemGetParameters(const char *names[], char *values[], unsigned int lens[], unsigned int count)
+{
+    InitParamClient();
+    PARAM_CHECK(names != NULL && values != NULL && lens != NULL, return -1, "The names or values is null");
+    PARAM_CHECK(count <= PARAM_BATCH_MAX, return PARAM_CODE_INVALID_PARAM, "Too many parameters %u", count);
+    ParamHandle handles[PARAM_BATCH_MAX] = { 0 };
+    uint32_t labels[PARAM_BATCH_MAX][2] = { { 0 } }; // 2 area and label
+    uint32_t labelCount = 0;
+    int result = 0;
+    // names are resolved by the exact index, only the permission of each distinct label is checked
+    for (uint32_t i = 0; i < count; i++) {
+        PARAM_CHECK(names[i] != NULL, return PARAM_CODE_INVALID_PARAM, "The name %u is null", i);
+        uint32_t labelIndex = 0;
+        int ret = ReadParamIndex(&g_clientSpace.paramSpace, names[i], &handles[i], &labelIndex);
+        result = (ret == PARAM_CODE_NOT_FOUND) ? ret : result;
+        ret = CheckParamLabelOnce(labels, &labelCount, names[i], GetWorkSpaceIndex(names[i]), labelIndex);
+        PARAM_CHECK(ret == 0, return ret, "Forbid to get parameter %s", names[i]);
+    }
+    int ret = ReadParamValues(&g_clientSpace.paramSpace, handles, values, lens, count);
+    return (ret != 0) ? ret : result;
+}
+
 int SystemFindParameter(const char *name, ParamHandle *handle)
 {
     InitParamClient();
     PARAM_CHECK(name != NULL && handle != NULL, return -1, "The name or handle is null");
-    int ret = ReadParamWithCheck(&g_clientSpace.paramSpace, name, DAC_READ, handle);
+    int ret = ReadParamWithCache(name, DAC_READ, handle);
     if (ret != PARAM_CODE_NOT_FOUND && ret != 0) {
         PARAM_CHECK(ret == 0, return ret, "Forbid to access parameter %s", name);
     }
     return 0;
 }
 
+CachedHandle CachedParameterCreate(const char *name)
+{
+    InitParamClient();
+    PARAM_CHECK(name != NULL, return NULL, "The name is null");
+    int ret = CheckParamName(name, 0);
+    PARAM_CHECK(ret == 0, return NULL, "Illegal param name %s", name);
+    ParamCacheEntry *entry = (ParamCacheEntry *)calloc(1, sizeof(ParamCacheEntry));
+    PARAM_CHECK(entry != NULL, return NULL, "Failed to malloc for cached %s", name);
+    ParamCacheEntry value = {};
+    value.hash = GetTrieKeyHash(name, strlen(name));
+    (void)ResolveParamCacheEntry(name, DAC_READ, &value);
+    WriteParamCacheEntry(entry, name, &value);
+    return (CachedHandle)entry;
+}
+
+int CachedParameterGet(CachedHandle handle, char *value, unsigned int *len)
+{
+    PARAM_CHECK(handle != NULL && len != NULL, return -1, "The handle or len is null");
+    ParamCacheEntry *entry = (ParamCacheEntry *)handle;
+    ParamCacheEntry cached = {};
+    // a missing parameter is looked up again on every read until it is added
+    if (ReadParamCacheEntry(entry, entry->name, entry->hash, &cached) != 0 || cached.result == PARAM_CODE_NOT_FOUND) {
+        cached.hash = entry->hash;
+        (void)ResolveParamCacheEntry(entry->name, DAC_READ, &cached);
+        WriteParamCacheEntry(entry, NULL, &cached);
+    }
+    if (cached.result != 0) {
+        return cached.result;
+    }
+    return ReadParamValue(&g_clientSpace.paramSpace, cached.handle, value, len);
+}
+
+void CachedParameterDestroy(CachedHandle handle)
+{
+    if (handle != NULL) {
+        free(handle);
+    }
+}
+
 int SystemGetParameterCommitId(ParamHandle handle, uint32_t *commitId)
 {
     PARAM_CHECK(handle != 0 || commitId != NULL, return -1, "The handle is null");
@@ -318,6 +997,39 @@ int SystemTraversalParameter(
     return TraversalParam(&g_clientSpace.paramSpace, traversalParameter, cookie);
 }
 
+int SystemTraversalParameterBegin(const char *prefix, void **cursor)
+{
+    InitParamClient();
+    PARAM_CHECK(cursor != NULL, return -1, "The cursor is null");
+    ParamHandle handle = 0;
+    int ret = ReadParamWithCheck(&g_clientSpace.paramSpace, (prefix != NULL) ? prefix : "#", DAC_READ, &handle);
+    if (ret != PARAM_CODE_NOT_FOUND && ret != 0) {
+        PARAM_CHECK(ret == 0, return ret, "Forbid to traversal parameters");
+    }
+    ParamCursor *paramCursor = (ParamCursor *)malloc(sizeof(ParamCursor));
+    PARAM_CHECK(paramCursor != NULL, return -1, "Failed to malloc for cursor");
+    ret = ParamCursorBegin(paramCursor, &g_clientSpace.paramSpace, prefix);
+    PARAM_CHECK(ret == 0, free(paramCursor);
+        return ret, "Failed to begin traversal");
+    *cursor = paramCursor;
+    return 0;
+}
+
+int SystemTraversalParameterNext(void *cursor, ParamHandle *handle)
+{
+    PARAM_CHECK(cursor != NULL && handle != NULL, return -1, "The param is null");
+    return ParamCursorNext((ParamCursor *)cursor, handle);
+}
+
+void SystemTraversalParameterEnd(void *cursor)
+{
+    if (cursor == NULL) {
+        return;
+    }
+    ParamCursorEnd((ParamCursor *)cursor);
+    free(cursor);
+}
+
 void SystemDumpParameters(int verbose)
 {
     InitParamClient();
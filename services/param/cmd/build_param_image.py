@@ -0,0 +1,45 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+# Copyright (c) 2021 Huawei Device Co., Ltd.
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+
+
+# stage the files as they are installed on the target, then build the image of them
+def main():
+    parser = argparse.ArgumentParser(description='build the parameter image')
+    parser.add_argument('--compiler', required=True, help='param_compiler built for the host')
+    parser.add_argument('--root', required=True, help='staging root of the target')
+    parser.add_argument('--output', required=True, help='the parameter image')
+    parser.add_argument('--file', action='append', default=[], help='source:path on the target')
+    parser.add_argument('paths', nargs='+', help='parameter paths on the target, path:add to only add')
+    args = parser.parse_args()
+
+    if os.path.exists(args.root):
+        shutil.rmtree(args.root)
+    for item in args.file:
+        source, target = item.split(':', 1)
+        dest = os.path.join(args.root, target.lstrip('/'))
+        if not os.path.isdir(os.path.dirname(dest)):
+            os.makedirs(os.path.dirname(dest))
+        shutil.copyfile(source, dest)
+    return subprocess.call([args.compiler, args.root, args.output] + args.paths)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -22,6 +22,7 @@
 
 #define USAGE_INFO_PARAM_GET "param get [key]"
 #define USAGE_INFO_PARAM_SET "param set key value"
+#define USAGE_INFO_PARAM_DEL "param del key"
 #define USAGE_INFO_PARAM_WAIT "param wait key value"
 #define USAGE_INFO_PARAM_DUMP "param dump [verbose]"
 #define USAGE_INFO_PARAM_READ "param read key"
@@ -78,6 +79,18 @@ static void ExeuteCmdParamSet(int argc, char *argv[], int start)
     return;
 }
 
+static void ExeuteCmdParamDel(int argc, char *argv[], int start)
+{
+    UNUSED(argc);
+    int ret = SystemDeleteParameter(argv[start]);
+    if (ret == 0) {
+        printf("Delete parameter %s success\n", argv[start]);
+    } else {
+        printf("Delete parameter %s fail\n", argv[start]);
+    }
+    return;
+}
+
 static void ExeuteCmdParamDump(int argc, char *argv[], int start)
 {
     int verbose = 0;
@@ -151,6 +164,7 @@ int RunParamCommand(int argc, char *argv[])
 {
     static struct CmdArgs paramCmds[] = {
         { "set", 4, ExeuteCmdParamSet, USAGE_INFO_PARAM_SET }, // set param count
+        { "del", 3, ExeuteCmdParamDel, USAGE_INFO_PARAM_DEL }, // del param count
         { "get", 2, ExeuteCmdParamGet, USAGE_INFO_PARAM_GET }, // get param count
         { "wait", 3, ExeuteCmdParamWait, USAGE_INFO_PARAM_WAIT }, // wait param count
         { "dump", 2, ExeuteCmdParamDump, USAGE_INFO_PARAM_DUMP }, // dump param count
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "init_param.h"
+#include "param_manager.h"
+#include "param_service.h"
+#include "param_utils.h"
+
+#define USAGE_INFO_PARAM_COMPILER "param_compiler root image path[:add] [path[:add]]..."
+#define PARAM_COMPILER_PATH_MAX 16
+#define PARAM_COMPILER_MIN_ARGC 4
+
+#ifdef PARAM_IMAGE_TOOL
+static ParamToolPath g_paramToolPath = {};
+
+const ParamToolPath *GetParamToolPath(void)
+{
+    return &g_paramToolPath;
+}
+
+static int InitParamToolPath(const char *root, const char *image)
+{
+    int ret = sprintf_s(g_paramToolPath.user, sizeof(g_paramToolPath.user), "%s/system/etc/passwd", root);
+    PARAM_CHECK(ret > 0, return -1, "Invalid root %s", root);
+    ret = sprintf_s(g_paramToolPath.group, sizeof(g_paramToolPath.group), "%s/system/etc/group", root);
+    PARAM_CHECK(ret > 0, return -1, "Invalid root %s", root);
+    // the areas are scratch files of the build, not a part of the target
+    ret = sprintf_s(g_paramToolPath.storage, sizeof(g_paramToolPath.storage), "%s.storage", image);
+    PARAM_CHECK(ret > 0, return -1, "Invalid image %s", image);
+    return 0;
+}
+#endif
+
+// root is the root of the target on the host, the paths are the ones on the target in the order of init
+int RunParamCompiler(int argc, char *argv[])
+{
+    if (argc < PARAM_COMPILER_MIN_ARGC || (argc - PARAM_COMPILER_MIN_ARGC + 1) > PARAM_COMPILER_PATH_MAX) {
+        printf("usage: \n\t%s\n", USAGE_INFO_PARAM_COMPILER);
+        return -1;
+    }
+    const char *root = argv[1];
+    const char *image = argv[2]; // 2 after the root
+#ifdef PARAM_IMAGE_TOOL
+    if (InitParamToolPath(root, image) != 0) {
+        printf("Invalid root %s or image %s \n", root, image);
+        return -1;
+    }
+#endif
+    ParamWorkSpace *workSpace = GetParamWorkSpace();
+    int ret = InitParamWorkSpace(workSpace, 0);
+    PARAM_CHECK(ret == 0, return ret, "Failed to init parameter workspace");
+
+    const char *paths[PARAM_COMPILER_PATH_MAX] = { NULL };
+    uint32_t count = 0;
+    for (int i = PARAM_COMPILER_MIN_ARGC - 1; i < argc; i++) {
+        uint32_t mode = LOAD_PARAM_NORMAL;
+        char *flag = strrchr(argv[i], ':');
+        if (flag != NULL && strcmp(flag, ":add") == 0) {
+            *flag = '\0';
+            mode = LOAD_PARAM_ONLY_ADD;
+        }
+        char path[PARAM_BUFFER_SIZE] = { 0 };
+        ret = sprintf_s(path, sizeof(path), "%s%s%s", root, (argv[i][0] == '/') ? "" : "/", argv[i]);
+        if (ret <= 0 || LoadDefaultParams(path, mode) != 0) {
+            printf("Failed to load parameters from %s \n", argv[i]);
+        }
+        paths[count++] = argv[i];
+    }
+    ret = SaveParamImageAreas(workSpace, image, root, paths, count);
+    if (ret != 0) {
+        printf("Failed to save parameter image %s \n", image);
+    }
+    CloseParamWorkSpace(workSpace);
+    return ret;
+}
+
+#ifndef STARTUP_INIT_TEST
+int main(int argc, char *argv[])
+{
+    return RunParamCompiler(argc, argv);
+}
+#endif
@@ -35,6 +35,40 @@ extern "C" {
 #define futex_wait_always(addr1) syscall(SYS_futex, addr1, FUTEX_WAIT, *(int *)(addr1), 0, 0, 0)
 #define futex_wake_single(addr1) syscall(SYS_futex, addr1, FUTEX_WAKE, 1, 0, 0, 0)
 
+// area 0 is paramSpace, other areas hold the parameters with the prefix in g_paramAreaPrefix
+#define PARAM_AREA_DEFAULT 0
+#define PARAM_AREA_MAX 5
+// epoch:5 | area:3 | offset:24, a handle from an area before its last compaction is rejected by the epoch.
+// the epoch wraps after 32 compactions, a handle kept longer should be kept with the generation of its area
+#define PARAM_HANDLE_AREA_SHIFT 24
+#define PARAM_HANDLE_AREA_MASK 0x07
+#define PARAM_HANDLE_EPOCH_SHIFT 27
+#define PARAM_HANDLE_EPOCH_MASK 0x1f
+#define PARAM_HANDLE_OFFSET_MASK 0x00ffffff
+#define PARAM_HANDLE(area, epoch, offset) \
+    ((((uint32_t)(epoch) & PARAM_HANDLE_EPOCH_MASK) << PARAM_HANDLE_EPOCH_SHIFT) | \
+    ((uint32_t)(area) << PARAM_HANDLE_AREA_SHIFT) | (offset))
+#define PARAM_HANDLE_AREA(handle) (((uint32_t)(handle) >> PARAM_HANDLE_AREA_SHIFT) & PARAM_HANDLE_AREA_MASK)
+#define PARAM_HANDLE_EPOCH(handle) (((uint32_t)(handle) >> PARAM_HANDLE_EPOCH_SHIFT) & PARAM_HANDLE_EPOCH_MASK)
+#define PARAM_HANDLE_OFFSET(handle) ((uint32_t)(handle) & PARAM_HANDLE_OFFSET_MASK)
+#ifdef __cplusplus
+static_assert(PARAM_WORKSPACE_MAX <= PARAM_HANDLE_OFFSET_MASK + 1, "The offset of an area does not fit in a handle");
+#else
+_Static_assert(PARAM_WORKSPACE_MAX <= PARAM_HANDLE_OFFSET_MASK + 1, "The offset of an area does not fit in a handle");
+#endif
+
+// verdicts of this process for (area, label node, op), an entry is stale once the area generation
+// or the credential of this process, its supplementary groups included, changes
+#define PARAM_PERMISSION_CACHE_SIZE 64
+typedef struct {
+    atomic_ullong entries[PARAM_PERMISSION_CACHE_SIZE];
+    atomic_ullong cred; // uid and gid the entries were computed for
+    atomic_uint groups; // hash of the supplementary groups the entries were computed for
+    atomic_uint epoch; // changed with cred
+    atomic_uint hit;
+    atomic_uint miss;
+} ParamPermissionCache;
+
 typedef struct {
     uint32_t flags;
     WorkSpace paramSpace;
@@ -42,6 +76,8 @@ typedef struct {
     ParamSecurityOps paramSecurityOps;
     ParamTaskPtr serverTask;
     ParamTaskPtr timer;
+    WorkSpace areaSpace[PARAM_AREA_MAX - 1];
+    ParamPermissionCache permissionCache;
 } ParamWorkSpace;
 
 typedef struct {
@@ -54,20 +90,47 @@ typedef struct {
 int InitParamWorkSpace(ParamWorkSpace *workSpace, int onlyRead);
 void CloseParamWorkSpace(ParamWorkSpace *workSpace);
 
+uint32_t GetWorkSpaceIndex(const char *name);
+WorkSpace *GetWorkSpace(const ParamWorkSpace *workSpace, const char *name);
+WorkSpace *GetWorkSpaceByIndex(const ParamWorkSpace *workSpace, uint32_t index);
+int CheckLabelInWorkSpace(uint32_t index, const char *name);
+
 int ReadParamWithCheck(const ParamWorkSpace *workSpace, const char *name, uint32_t op, ParamHandle *handle);
+// name resolution and permission check of ReadParamWithCheck, for callers caching the resolved handle
+int ReadParamIndex(const ParamWorkSpace *workSpace, const char *name, ParamHandle *handle, uint32_t *labelIndex);
+int CheckParamLabelPermission(const ParamWorkSpace *workSpace,
+    const char *name, uint32_t areaIndex, uint32_t labelIndex, uint32_t mode);
+uint32_t GetParamAreaGeneration(const ParamWorkSpace *workSpace, uint32_t index);
 int ReadParamValue(const ParamWorkSpace *workSpace, ParamHandle handle, char *value, uint32_t *len);
+#define PARAM_SNAPSHOT_RETRY 16
+// read the values of all handles from one consistent set of commits, missing ones get length 0
+int ReadParamValues(const ParamWorkSpace *workSpace,
+    const ParamHandle handles[], char *values[], uint32_t lengths[], uint32_t count);
 int ReadParamName(const ParamWorkSpace *workSpace, ParamHandle handle, char *name, uint32_t len);
 int ReadParamCommitId(const ParamWorkSpace *workSpace, ParamHandle handle, uint32_t *commitId);
+// wait in the shared memory until the value matches, value is "*", "prefix*" or a whole value, timeout in second
+int WaitParamValue(const ParamWorkSpace *workSpace, const char *name, const char *value, uint32_t timeout);
+// change serial of the top-level prefix of name such as "persist", NULL or "" for all parameters
+atomic_uint *GetParamChangeSerial(const ParamWorkSpace *workSpace, const char *name);
+int WaitParamChange(const ParamWorkSpace *workSpace, const char *name, uint32_t *serial, uint32_t timeout);
 
 int CheckParamName(const char *name, int paramInfo);
 int CheckParamPermission(const ParamWorkSpace *workSpace,
     const ParamSecurityLabel *srcLabel, const char *name, uint32_t mode);
+void GetParamPermissionCacheStat(const ParamWorkSpace *workSpace, uint32_t *hit, uint32_t *miss);
 
-typedef void (*TraversalParamPtr)(ParamHandle handle, void *context);
 typedef struct {
-    TraversalParamPtr traversalParamPtr;
-    void *context;
-} ParamTraversalContext;
+    const ParamWorkSpace *workSpace;
+    uint32_t areaIndex;
+    char prefix[PARAM_NAME_LEN_MAX];
+    ParamTrieCursor trieCursor;
+} ParamCursor;
+// prefix is a whole segment path such as "const.product", NULL or "#" for all parameters
+int ParamCursorBegin(ParamCursor *cursor, const ParamWorkSpace *workSpace, const char *prefix);
+int ParamCursorNext(ParamCursor *cursor, ParamHandle *handle);
+void ParamCursorEnd(ParamCursor *cursor);
+
+typedef void (*TraversalParamPtr)(ParamHandle handle, void *context);
 int TraversalParam(const ParamWorkSpace *workSpace, TraversalParamPtr walkFunc, void *cookie);
 
 ParamWorkSpace *GetParamWorkSpace(void);
@@ -48,7 +48,9 @@ typedef enum {
     MSG_WAIT_PARAM,
     MSG_ADD_WATCHER,
     MSG_DEL_WATCHER,
-    MSG_NOTIFY_PARAM
+    MSG_NOTIFY_PARAM,
+    MSG_SET_PARAM_BATCH,
+    MSG_DEL_PARAM
 } ParamMsgType;
 
 typedef enum ContentType {
@@ -83,6 +85,13 @@ typedef struct {
     uint32_t result;
 } ParamResponseMessage;
 
+typedef struct {
+    ParamMessage msg;
+    uint32_t result;
+    uint32_t count;
+    int32_t results[0];
+} ParamBatchResponseMessage;
+
 struct ParamTask_;
 typedef struct ParamTask_ *ParamTaskPtr;
 typedef int (*IncomingConnect)(const ParamTaskPtr stream, uint32_t flags);
@@ -31,7 +31,10 @@ typedef struct {
     int (*save)(const char *name, const char *value);
     int (*batchSaveBegin)(PERSIST_SAVE_HANDLE *handle);
     int (*batchSave)(PERSIST_SAVE_HANDLE handle, const char *name, const char *value);
-    void (*batchSaveEnd)(PERSIST_SAVE_HANDLE handle);
+    // result of the batch save, the saved file is dropped if it or the end fails
+    int (*batchSaveEnd)(PERSIST_SAVE_HANDLE handle, int result);
+    // the parameters kept by save should be compacted by a batch save
+    int (*needBatchSave)(void);
 } PersistParamOps;
 
 #ifndef PARAM_SUPPORT_SAVE_PERSIST
@@ -44,8 +47,10 @@ int RegisterPersistParamOps(PersistParamOps *ops);
 
 #ifndef STARTUP_INIT_TEST
 #define PARAM_MUST_SAVE_PARAM_DIFF 10 // 10s
+#define PARAM_PERSIST_JOURNAL_MAX (32 * 1024)
 #else
 #define PARAM_MUST_SAVE_PARAM_DIFF 1
+#define PARAM_PERSIST_JOURNAL_MAX 1024
 #endif
 
 #ifdef __cplusplus
@@ -25,10 +25,55 @@ extern "C" {
 #endif
 #endif
 
+#define PARAM_CLIENT_CACHE_SIZE 64
+typedef struct {
+    atomic_uint serial; // odd while the entry is being filled
+    uint32_t hash;
+    uint32_t areaIndex;
+    uint32_t generation;
+    ParamHandle handle;
+    uint32_t labelIndex;
+    int result;
+    char name[PARAM_NAME_LEN_MAX];
+} ParamCacheEntry;
+
+typedef struct ParamRequestNode_ {
+    struct ParamRequestNode_ *next;
+    ParamMessage *request; // the response is copied back into the request buffer
+    int fd;
+    int done;
+    int answered;
+    int result;
+} ParamRequestNode;
+
+typedef struct ParamAsyncRequest_ {
+    struct ParamAsyncRequest_ *next;
+    uint32_t msgId;
+    ParameterAsyncCallback callback;
+    void *context;
+    char name[PARAM_NAME_LEN_MAX];
+} ParamAsyncRequest;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    int fd; // only read by SystemProcessParameterEvents
+    int eventFd; // epoll set of fd and notifyFd, the same fd for the callers across reconnections
+    int notifyFd; // wakes up the caller to fail the requests of a closed connection
+    uint32_t recvSize;
+    ParamMessage *recvMsg;
+    ParamAsyncRequest *requests;
+} ParamAsyncClient;
+
 typedef struct {
     ParamWorkSpace paramSpace;
     int clientFd;
     pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int recvFd; // the connection one of the waiting threads reads for all requests in flight
+    ParamMessage *recvMsg;
+    ParamRequestNode *requests;
+    ParamAsyncClient async;
+    ParamCacheEntry cache[PARAM_CLIENT_CACHE_SIZE];
 } ClientWorkSpace;
 
 int WatchParamCheck(const char *keyprefix);
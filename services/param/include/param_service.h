@@ -39,6 +39,13 @@ int InitPersistParamWorkSpace(const ParamWorkSpace *workSpace);
 void ClosePersistParamWorkSpace(void);
 int LoadPersistParam(ParamWorkSpace *workSpace);
 int WritePersistParam(ParamWorkSpace *workSpace, const char *name, const char *value);
+int WritePersistParams(ParamWorkSpace *workSpace, const char *names[], const char *values[], uint32_t count);
+int DeletePersistParam(ParamWorkSpace *workSpace, const char *name);
+
+// the files of the paths are read under root, NULL when they are read where they are on the target
+int SaveParamImageAreas(const ParamWorkSpace *workSpace,
+    const char *fileName, const char *root, const char *paths[], uint32_t count);
+int LoadParamImageAreas(ParamWorkSpace *workSpace, const char *fileName);
 
 #ifdef STARTUP_INIT_TEST
 int ProcessMessage(const ParamTaskPtr worker, const ParamMessage *msg);
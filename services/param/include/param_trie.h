@@ -44,6 +44,8 @@
 
 #define futex_wake(ftx, count) PARAM_FUTEX(ftx, FUTEX_WAKE, count, 0, 0)
 #define futex_wait(ftx, value) PARAM_FUTEX(ftx, FUTEX_WAIT, value, 100, 0)
+// timeout in ms, less than 1000
+#define futex_wait_timeout(ftx, value, timeout) PARAM_FUTEX(ftx, FUTEX_WAIT, value, timeout, 0)
 #endif
 
 #ifdef __cplusplus
@@ -52,7 +54,10 @@ extern "C" {
 #endif
 #endif
 
-#define PARAM_WORKSPACE_MAX (80 * 1024)
+#define PARAM_WORKSPACE_DEF (80 * 1024)
+#ifndef PARAM_WORKSPACE_MAX
+#define PARAM_WORKSPACE_MAX (1024 * 1024)
+#endif
 #define FILENAME_LEN_MAX 255
 typedef struct {
     uint32_t left;
@@ -67,15 +72,33 @@ typedef struct {
 #define PARAM_FLAGS_MODIFY 0x80000000
 #define PARAM_FLAGS_TRIGGED 0x40000000
 #define PARAM_FLAGS_WAITED 0x20000000
+#define PARAM_FLAGS_DELETED 0x10000000 // a tombstone, the node is added again or dropped by compaction
 #define PARAM_FLAGS_COMMITID 0x0000ffff
 
+// "key=value", the value is stored inline while it fits in valueSize, else in a value slot at valueIndex
 typedef struct {
     atomic_uint commitId;
     uint16_t keyLength;
     uint16_t valueLength;
+    uint16_t valueSize;
+    uint16_t reserved;
+    atomic_uint valueIndex;
     char data[0];
 } ParamNode;
 
+#define PARAM_NODE_DELETED(entry) \
+    ((atomic_load_explicit(&(entry)->commitId, memory_order_acquire) & PARAM_FLAGS_DELETED) != 0)
+
+// out-of-line value storage, freed slots are linked by next into the free list of their size class
+#define PARAM_VALUE_SIZE_MIN 8
+#define PARAM_VALUE_CLASS_MAX 5
+typedef struct {
+    uint32_t next;
+    uint16_t size;
+    uint16_t sizeClass;
+    char data[0];
+} ParamValueNode;
+
 typedef struct {
     uid_t uid;
     gid_t gid;
@@ -84,6 +107,55 @@ typedef struct {
     char data[0];
 } ParamSecruityNode;
 
+// children of a trie node: binary search tree by left/right, or a sorted array pointed by child
+typedef enum {
+    PARAM_TRIE_DEFAULT = 0,
+    PARAM_TRIE_BST,
+    PARAM_TRIE_ARRAY,
+} ParamTrieType;
+
+#ifdef PARAM_SUPPORT_TRIE_ARRAY
+#define PARAM_TRIE_TYPE_DEF PARAM_TRIE_ARRAY
+#else
+#define PARAM_TRIE_TYPE_DEF PARAM_TRIE_BST
+#endif
+
+#define PARAM_TRIE_ARRAY_INIT 4
+typedef struct {
+    uint32_t hash;
+    uint32_t offset;
+} ParamTrieEntry;
+
+typedef struct {
+    atomic_uint version; // odd while the entries are being changed
+    uint32_t count;
+    uint32_t capacity;
+    ParamTrieEntry entry[0];
+} ParamTrieArray;
+
+// exact name index: full-key hash to the parameter and its effective security label
+#define PARAM_HASH_INIT 64
+typedef struct {
+    atomic_uint hash; // 0 for an empty slot, stored after dataIndex and labelIndex
+    uint32_t dataIndex;
+    atomic_uint labelIndex;
+} ParamHashEntry;
+
+typedef struct {
+    uint32_t count;
+    uint32_t capacity; // power of 2, at most half used
+    ParamHashEntry entry[0];
+} ParamHashTable;
+
+// identical security labels are stored once, trie nodes of all the prefixes share the offset of one label node
+#define PARAM_LABEL_TABLE_INIT 16
+typedef struct {
+    uint32_t count;
+    uint32_t capacity; // power of 2, at most half used
+    uint32_t offset[0]; // 0 for an empty slot
+} ParamLabelTable;
+
+#define PARAM_PREFIX_SERIAL_MAX 16
 typedef struct {
     uint32_t trieNodeCount;
     uint32_t paramNodeCount;
@@ -91,33 +163,112 @@ typedef struct {
     uint32_t currOffset;
     uint32_t firstNode;
     uint32_t dataSize;
-    uint32_t reserved_[28];
+    uint32_t trieType;
+    atomic_uint hashIndex;
+    atomic_uint generation; // changed when a resolved handle or permission of the area may be stale
+    atomic_uint serial; // changed and woken up when a parameter is added to the area
+    // changes of all parameters and of the top-level prefixes by hash, only used in the default area
+    atomic_uint changeSerial;
+    atomic_uint prefixSerial[PARAM_PREFIX_SERIAL_MAX];
+    uint32_t freeValue[PARAM_VALUE_CLASS_MAX];
+    uint32_t deletedSize; // parameters deleted and not compacted yet
+    atomic_uint epoch; // changed when the area is compacted, the offsets of the old area are not valid
+    atomic_uint replaced; // set in the old area once a compacted one takes its file
+    uint32_t labelTableIndex; // only used when labels are added
     char data[0];
 } ParamTrieHeader;
 
+// compact an area when the deleted parameters take a quarter of it
+#define PARAM_COMPACT_RATIO 4
+#define PARAM_COMPACT_SIZE_MIN (4 * 1024)
+
+// an area replaced by a remap or a compaction, readers may still use it until the workspace is closed
+typedef struct ParamRetiredArea_ {
+    struct ParamRetiredArea_ *next;
+    ParamTrieHeader *area;
+} ParamRetiredArea;
+
 struct WorkSpace_;
 typedef struct WorkSpace_ {
     char fileName[FILENAME_LEN_MAX + 1];
     uint32_t (*allocTrieNode)(struct WorkSpace_ *workSpace, const char *key, uint32_t keyLen);
     int (*compareTrieNode)(const ParamTrieNode *node, const char *key2, uint32_t key2Len);
+    ParamTrieNode *(*findChildNode)(const struct WorkSpace_ *workSpace,
+        const ParamTrieNode *parent, const char *key, uint32_t keyLen);
+    ParamTrieNode *(*addChildNode)(struct WorkSpace_ *workSpace,
+        ParamTrieNode *parent, const char *key, uint32_t keyLen);
+    uint32_t spaceSizeMax;
+    uint32_t trieType;
     ParamTrieHeader *area;
+    ParamRetiredArea *retired; // newest first
 } WorkSpace;
 
+// the area is set up before it is published, readers check it without a lock
+#define PARAM_PUBLISH_AREA(workSpace, addr) __atomic_store_n(&(workSpace)->area, (addr), __ATOMIC_RELEASE)
+#define PARAM_LOAD_AREA(workSpace) __atomic_load_n(&(workSpace)->area, __ATOMIC_ACQUIRE)
+
 int InitWorkSpace(const char *fileName, WorkSpace *workSpace, int onlyRead);
 void CloseWorkSpace(WorkSpace *workSpace);
+// replace the area with a prebuilt one, the header and the data up to currOffset
+int LoadWorkSpaceImage(WorkSpace *workSpace, const char *image, uint32_t size);
+// copy the live parameters and labels to a new file and rename it over the area file,
+// the old area is marked replaced and its waiters are woken up
+int CompactWorkSpace(WorkSpace *workSpace);
+// map the area file again after it is replaced by a compacted one
+int RemapWorkSpace(WorkSpace *workSpace);
 
 ParamTrieNode *GetTrieNode(const WorkSpace *workSpace, uint32_t offset);
 void SaveIndex(uint32_t *index, uint32_t offset);
 
 ParamTrieNode *AddTrieNode(WorkSpace *workSpace, const char *key, uint32_t keyLen);
+// add one segment of a key below parent, or below the root when parent is NULL
+ParamTrieNode *AddTrieChildNode(WorkSpace *workSpace, ParamTrieNode *parent, const char *key, uint32_t keyLen);
 ParamTrieNode *FindTrieNode(const WorkSpace *workSpace, const char *key, uint32_t keyLen, uint32_t *matchLabel);
 
+#define PARAM_TRIE_STACK_MAX 256
+#define PARAM_TRIE_FRAME_NODE 0xffffffff
+#define PARAM_TRIE_FRAME_ROOT 0xfffffffe
+typedef struct {
+    uint32_t offset;
+    uint32_t index; // next entry of a child array, or PARAM_TRIE_FRAME_NODE/PARAM_TRIE_FRAME_ROOT
+} ParamTrieFrame;
+
+typedef struct {
+    const WorkSpace *workSpace;
+    const ParamTrieHeader *area; // the offsets in frame belong to it
+    uint32_t top;
+    int error;
+    ParamTrieFrame frame[PARAM_TRIE_STACK_MAX];
+} ParamTrieCursor;
+
+// walk the sub trie of root without recursion, a node is returned before the nodes below it
+int TrieCursorBegin(ParamTrieCursor *cursor, const WorkSpace *workSpace, const ParamTrieNode *root);
+ParamTrieNode *TrieCursorNext(ParamTrieCursor *cursor);
+// do not walk below the node returned last
+void TrieCursorSkipChild(ParamTrieCursor *cursor, const ParamTrieNode *node);
+void TrieCursorEnd(ParamTrieCursor *cursor);
+
 typedef int (*TraversalTrieNodePtr)(const WorkSpace *workSpace, const ParamTrieNode *node, void *cookie);
 int TraversalTrieNode(const WorkSpace *workSpace,
     const ParamTrieNode *subTrie, TraversalTrieNodePtr walkFunc, void *cookie);
 
+uint32_t GetTrieKeyHash(const char *key, uint32_t keyLen);
+int AddParamHashEntry(WorkSpace *workSpace, const char *key, uint32_t keyLen, uint32_t dataIndex);
+int FindParamHashEntry(const WorkSpace *workSpace,
+    const char *key, uint32_t keyLen, uint32_t *dataIndex, uint32_t *labelIndex);
+// 0 when dataIndex is the start of the parameter node of its own key
+int CheckParamNodeIndex(const WorkSpace *workSpace, uint32_t dataIndex);
+// set labelIndex to the indexed parameters under root that have no nearer label
+int UpdateParamHashLabel(WorkSpace *workSpace, const ParamTrieNode *root, uint32_t labelIndex);
+
 uint32_t AddParamSecruityNode(WorkSpace *workSpace, const ParamAuditData *auditData);
 uint32_t AddParamNode(WorkSpace *workSpace, const char *key, uint32_t keyLen, const char *value, uint32_t valueLen);
+// the space of the parameter node and its value slot
+uint32_t GetParamNodeSize(const WorkSpace *workSpace, const ParamNode *entry);
+// the storage of the current value and its size, only consistent within a commit of the parameter
+char *GetParamNodeValue(const WorkSpace *workSpace, const ParamNode *entry, uint32_t *size);
+uint32_t AllocateParamValue(WorkSpace *workSpace, uint32_t size);
+void FreeParamValue(WorkSpace *workSpace, uint32_t offset);
 #ifdef __cplusplus
 #if __cplusplus
 }
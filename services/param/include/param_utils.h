@@ -58,6 +58,16 @@ typedef enum {
 #define PARAM_STORAGE_PATH PARAM_DEFAULT_PATH "/__parameters__/param_storage"
 #define PARAM_PERSIST_SAVE_PATH PARAM_DEFAULT_PATH "/param/persist_parameters"
 #define PARAM_PERSIST_SAVE_TMP_PATH PARAM_DEFAULT_PATH "/param/tmp_persist_parameters"
+#define PARAM_PERSIST_JOURNAL_PATH PARAM_DEFAULT_PATH "/param/persist_parameters_journal"
+#elif defined PARAM_IMAGE_TOOL
+// param_compiler runs on the host, the areas are built next to the image it writes
+#define PARAM_STATIC static
+#define PARAM_DEFAULT_PATH "."
+#define PIPE_NAME PARAM_DEFAULT_PATH"/__parameters__/paramservice"
+#define PARAM_STORAGE_PATH (GetParamToolPath()->storage)
+#define PARAM_PERSIST_SAVE_PATH PARAM_DEFAULT_PATH "/__parameters__/persist_parameters"
+#define PARAM_PERSIST_SAVE_TMP_PATH PARAM_DEFAULT_PATH "/__parameters__/tmp_persist_parameters"
+#define PARAM_PERSIST_JOURNAL_PATH PARAM_DEFAULT_PATH "/__parameters__/persist_parameters_journal"
 #else
 #define PARAM_DEFAULT_PATH ""
 #define PARAM_STATIC static
@@ -65,11 +75,25 @@ typedef enum {
 #define PARAM_STORAGE_PATH "/dev/__parameters__/param_storage"
 #define PARAM_PERSIST_SAVE_PATH "/data/parameters/persist_parameters"
 #define PARAM_PERSIST_SAVE_TMP_PATH "/data/parameters/tmp_persist_parameters"
+#define PARAM_PERSIST_JOURNAL_PATH "/data/parameters/persist_parameters_journal"
 #endif
 
 #define PARAM_CMD_LINE "/proc/cmdline"
+#ifdef PARAM_IMAGE_TOOL
+// the files of the target are read under the root given to param_compiler
+#define PARAM_TOOL_PATH_MAX 256
+typedef struct {
+    char user[PARAM_TOOL_PATH_MAX];
+    char group[PARAM_TOOL_PATH_MAX];
+    char storage[PARAM_TOOL_PATH_MAX];
+} ParamToolPath;
+const ParamToolPath *GetParamToolPath(void);
+#define GROUP_FILE_PATH (GetParamToolPath()->group)
+#define USER_FILE_PATH (GetParamToolPath()->user)
+#else
 #define GROUP_FILE_PATH "/etc/group"
 #define USER_FILE_PATH "/etc/passwd"
+#endif
 
 #define WORKSPACE_FLAGS_INIT 0x01
 #define WORKSPACE_FLAGS_LOADED 0x02
@@ -94,6 +118,7 @@ typedef enum {
 
 #define MAX_LABEL_LEN 256
 #define PARAM_BUFFER_SIZE 256
+#define PARAM_LOCAL_GROUP_MAX 64 // supplementary groups read on the stack
 
 #define SUBSTR_INFO_NAME 0
 #define SUBSTR_INFO_VALUE 1
@@ -112,6 +137,28 @@ typedef struct {
 
 void CheckAndCreateDir(const char *fileName);
 int GetSubStringInfo(const char *buff, uint32_t buffLen, char delimiter, SubStringInfo *info, int subStrNumber);
+
+#define PARAM_FILE_FIELD_MAX 3
+#define PARAM_LOAD_WORKER_MAX 4
+
+typedef struct {
+    char *fields[PARAM_FILE_FIELD_MAX]; // terminated in the private mapping of the file
+    uint32_t fileIndex;
+    uint32_t lineIndex;
+} ParamFileLine;
+
+typedef struct {
+    const char *ext; // files loaded from a directory
+    char delimiter;
+    uint32_t fieldCount; // lines with fewer fields are skipped
+    // called by the workers, the line is dropped when it returns not 0
+    int (*checkLine)(const ParamFileLine *line, void *context);
+    // the lines of all files sorted by name, lines of the same name in the order of the files
+    int (*loadLines)(const ParamFileLine *lines, uint32_t count, void *context);
+    void *context;
+} ParamFileLoader;
+
+int LoadParamFiles(const char *path, const ParamFileLoader *loader);
 #ifdef __cplusplus
 #if __cplusplus
 }
@@ -18,6 +18,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include "sys_param.h"
+
 #ifdef __cplusplus
 #if __cplusplus
 extern "C" {
@@ -32,18 +34,24 @@ extern "C" {
 #define MAX_DATA_BUFFER_MAX (SUPPORT_DATA_BUFFER_MAX * 5)
 #define CONDITION_EXTEND_LEN 32
 
-#define LOGIC_DATA_FLAGS_ORIGINAL 0x1
-#define LOGIC_DATA_FLAGS_TRUE 0x08
+#define CONDITION_OP_AND '&'
+#define CONDITION_OP_OR '|'
+#define CONDITION_OP_PARAM 'p'   // name=value, compare with the parameter
+#define CONDITION_OP_CONTENT 'c' // compare with the trigger content, such as "boot" in "boot && aaa=1"
 
-#define LOGIC_DATA_TEST_FLAG(data, flag) (((data)->flags & flag) == (flag))
-#define LOGIC_DATA_SET_FLAG(data, flag) (data)->flags |= (flag)
-#define LOGIC_DATA_CLEAR_FLAG(data, flag) (data)->flags &= ~(flag)
+typedef struct {
+    uint8_t type;
+    uint16_t name;  // offset in the strings after the ops
+    uint16_t value;
+    ParamHandle handle; // resolved at the first read of the parameter, 0 before
+    uint32_t generation; // of the area when the handle was resolved
+} ConditionOp;
 
+// 编译后的条件，按后缀顺序保存操作，计算时不再解析条件字符串
 typedef struct {
-    uint32_t flags;
-    uint32_t startIndex;
-    uint32_t endIndex;
-} LogicData;
+    uint32_t count;
+    ConditionOp op[0];
+} ConditionCode;
 
 struct tagTriggerNode_;
 typedef int (*PARAM_CHECK_DONE)(struct tagTriggerNode_ *trigger, const char *content, uint32_t size);
@@ -53,18 +61,19 @@ typedef struct {
     int dataNumber;
     int endIndex;
     int dataUnit;
-    char *conditionName;
-    char *conditionContent;
     char *inputName;
     char *inputContent;
-    char *readContent;
     char *data;
+    char inputBuffer[SUPPORT_DATA_BUFFER_MAX + SUPPORT_DATA_BUFFER_MAX];
+    char readContent[SUPPORT_DATA_BUFFER_MAX];
 } LogicCalculator;
 
-int CalculatorInit(LogicCalculator *calculator, int dataNumber, int dataUnit, int needCondition);
+// dataNumber is the size of the stack for ConvertInfixToPrefix, 0 to compute conditions without allocation
+int CalculatorInit(LogicCalculator *calculator, int dataNumber, int dataUnit, int needInput);
 void CalculatorFree(LogicCalculator *calculator);
 int ConvertInfixToPrefix(const char *condition, char *prefix, uint32_t prefixLen);
-int ComputeCondition(LogicCalculator *calculator, const char *condition);
+int CompileCondition(const char *condition, ConditionCode **code);
+int ComputeCondition(LogicCalculator *calculator, ConditionCode *code);
 int GetValueFromContent(const char *content, uint32_t contentSize, uint32_t start, char *value, uint32_t valueSize);
 int CheckMatchSubCondition(const char *condition, const char *input, int length);
 
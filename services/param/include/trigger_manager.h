@@ -43,6 +43,7 @@ extern "C" {
 #define TRIGGER_FLAGS_ONCE 0x04       // 执行完成后释放
 #define TRIGGER_FLAGS_SUBTRIGGER 0x08 // 对init执行后，需要执行的init:xxx=aaa的trigger
 
+#define CMD_INDEX_FOR_PARA_WAIT_TIMEOUT 0xfffD
 #define CMD_INDEX_FOR_PARA_WAIT 0xfffE
 #define CMD_INDEX_FOR_PARA_WATCH 0xffff
 #define CMD_INDEX_FOR_PARA_TEST 0x10000
@@ -66,10 +67,12 @@ typedef enum {
 #define PARAM_TRIGGER_FOR_WAIT 0
 #define PARAM_TRIGGER_FOR_WATCH 1
 
+#define TRIGGER_INDEX_BUCKETS 64
 typedef struct {
     ListNode triggerList;
     uint32_t triggerCount;
     uint32_t cmdNodeCount;
+    ListNode *paramIndex; // TRIGGER_INDEX_BUCKETS lists of TriggerIndexNode, allocated with the first trigger
 } TriggerHeader;
 
 #define PARAM_TRIGGER_HEAD_INIT(head) \
@@ -77,6 +80,7 @@ typedef struct {
         ListInit(&(head).triggerList);  \
         (head).triggerCount = 0;        \
         (head).cmdNodeCount = 0;        \
+        (head).paramIndex = NULL;       \
     } while (0)
 
 // Command对象列表，主要存储每个triger需要执行那些Command操作。
@@ -86,6 +90,7 @@ typedef struct CommandNode_ {
     char content[0];
 } CommandNode;
 
+struct TriggerIndexNode_;
 typedef struct tagTriggerNode_ {
     ListNode node;
     uint32_t flags : 24;
@@ -93,12 +98,23 @@ typedef struct tagTriggerNode_ {
     TriggerHeader *triggerHead;
     CommandNode *firstCmd;
     CommandNode *lastCmd;
+    struct TriggerIndexNode_ *index;
+    ConditionCode *code;
+    uint32_t timeoutIndex; // 1 based position in the wait timeout heap, 0 if not waiting
     uint16_t extDataOffset;
     uint16_t extDataSize;
     char *condition;
     char name[0];
 } TriggerNode;
 
+// 参数名到trigger的索引，参数变化时只检查条件中引用了该参数的trigger
+typedef struct TriggerIndexNode_ {
+    ListNode node;
+    struct TriggerIndexNode_ *next; // next name of the same trigger
+    TriggerNode *trigger;
+    char name[0];
+} TriggerIndexNode;
+
 typedef struct {
     uint32_t queueCount;
     uint32_t startIndex;
@@ -109,16 +125,23 @@ typedef struct {
 typedef struct {
     TriggerHeader triggerHead;
     ListNode node;
-    uint32_t timeout;
     ParamTaskPtr stream;
 } ParamWatcher;
 
 typedef struct TriggerExtData_ {
     int (*excuteCmd)(const struct TriggerExtData_ *trigger, int cmd, const char *content);
     uint32_t watcherId;
+    uint32_t timeout; // seconds before a wait is answered with a timeout
     ParamWatcher *watcher;
 } TriggerExtData;
 
+// 等待超时按截止时间组成最小堆，只需为最早的截止时间启动定时器
+#define WAIT_TIMEOUT_INIT_SIZE 16
+typedef struct {
+    uint64_t deadline; // ms, CLOCK_MONOTONIC
+    TriggerNode *trigger;
+} WaitTimeout;
+
 typedef struct TriggerWorkSpace {
     void (*cmdExec)(const TriggerNode *trigger,
         const CommandNode *cmd, const char *content, uint32_t size);
@@ -128,6 +151,9 @@ typedef struct TriggerWorkSpace {
     TriggerHeader triggerHead[TRIGGER_MAX];
     ParamWatcher watcher;
     ListNode waitList;
+    WaitTimeout *waitTimeout;
+    uint32_t waitTimeoutCount;
+    uint32_t waitTimeoutSize;
 } TriggerWorkSpace;
 
 int InitTriggerWorkSpace(void);
@@ -160,6 +186,8 @@ TriggerNode *AddWatcherTrigger(ParamWatcher *watcher,
     int triggerType, const char *name, const char *condition, const TriggerExtData *extData);
 void DelWatcherTrigger(const ParamWatcher *watcher, uint32_t watcherId);
 void ClearWatcherTrigger(const ParamWatcher *watcher);
+uint64_t GetTriggerTime(void);
+uint64_t CheckWaitTriggerTimeout(TriggerWorkSpace *workSpace, uint64_t now);
 
 TriggerWorkSpace *GetTriggerWorkSpace(void);
 #ifdef __cplusplus
@@ -16,11 +16,19 @@
 #include "param_manager.h"
 
 #include <ctype.h>
+#include <pthread.h>
+#include <time.h>
 
 #if !defined PARAM_SUPPORT_SELINUX && !defined PARAM_SUPPORT_DAC
 static ParamSecurityLabel g_defaultSecurityLabel;
 #endif
 
+// keep read-mostly and write-heavy prefixes in separate areas
+static const char *g_paramAreaPrefix[PARAM_AREA_MAX] = {
+    "", "const.", PARAM_PERSIST_PREFIX, "init.svc.", "vendor."
+};
+static pthread_mutex_t g_areaMutex = PTHREAD_MUTEX_INITIALIZER;
+
 static int GetParamSecurityOps(ParamWorkSpace *workSpace, int isInit)
 {
     UNUSED(isInit);
@@ -36,6 +44,19 @@ static int GetParamSecurityOps(ParamWorkSpace *workSpace, int isInit)
     return 0;
 }
 
+static int InitParamArea(WorkSpace *space, uint32_t index, int onlyRead)
+{
+    const char *path = onlyRead ? CLIENT_PARAM_STORAGE_PATH : PARAM_STORAGE_PATH;
+    if (index == PARAM_AREA_DEFAULT) {
+        return InitWorkSpace(path, space, onlyRead);
+    }
+    char fileName[FILENAME_LEN_MAX] = { 0 };
+    size_t prefixLen = strlen(g_paramAreaPrefix[index]) - 1; // skip the last '.'
+    int ret = sprintf_s(fileName, sizeof(fileName), "%s.%.*s", path, (int)prefixLen, g_paramAreaPrefix[index]);
+    PARAM_CHECK(ret > 0, return PARAM_CODE_INVALID_NAME, "Failed to format area name %u", index);
+    return InitWorkSpace(fileName, space, onlyRead);
+}
+
 int InitParamWorkSpace(ParamWorkSpace *workSpace, int onlyRead)
 {
     PARAM_CHECK(workSpace != NULL, return PARAM_CODE_INVALID_NAME, "Invalid param");
@@ -64,12 +85,13 @@ int InitParamWorkSpace(ParamWorkSpace *workSpace, int onlyRead)
         ret = paramSecurityOps->securityCheckFilePermission(workSpace->securityLabel, PARAM_STORAGE_PATH, op);
         PARAM_CHECK(ret == 0, return PARAM_CODE_INVALID_NAME, "No permission to read file %s", PARAM_STORAGE_PATH);
     }
-    if (onlyRead) {
-        ret = InitWorkSpace(CLIENT_PARAM_STORAGE_PATH, &workSpace->paramSpace, onlyRead);
-    } else {
-        ret = InitWorkSpace(PARAM_STORAGE_PATH, &workSpace->paramSpace, onlyRead);
-    }
+    ret = InitParamArea(&workSpace->paramSpace, PARAM_AREA_DEFAULT, onlyRead);
     PARAM_CHECK(ret == 0, return PARAM_CODE_INVALID_NAME, "Failed to init workspace");
+    // client maps the other areas when they are accessed first
+    for (uint32_t i = PARAM_AREA_DEFAULT + 1; onlyRead == 0 && i < PARAM_AREA_MAX; i++) {
+        ret = InitParamArea(&workSpace->areaSpace[i - 1], i, onlyRead);
+        PARAM_CHECK(ret == 0, return PARAM_CODE_INVALID_NAME, "Failed to init workspace %u", i);
+    }
     PARAM_SET_FLAG(workSpace->flags, WORKSPACE_FLAGS_INIT);
     return ret;
 }
@@ -77,12 +99,104 @@ int InitParamWorkSpace(ParamWorkSpace *workSpace, int onlyRead)
 void CloseParamWorkSpace(ParamWorkSpace *workSpace)
 {
     CloseWorkSpace(&workSpace->paramSpace);
+    for (uint32_t i = PARAM_AREA_DEFAULT + 1; i < PARAM_AREA_MAX; i++) {
+        if (workSpace->areaSpace[i - 1].area != NULL) {
+            CloseWorkSpace(&workSpace->areaSpace[i - 1]);
+        }
+    }
     if (workSpace->paramSecurityOps.securityFreeLabel != NULL) {
         workSpace->paramSecurityOps.securityFreeLabel(workSpace->securityLabel);
     }
+    // generations start again with the next workspace
+    for (uint32_t i = 0; i < PARAM_PERMISSION_CACHE_SIZE; i++) {
+        atomic_store_explicit(&workSpace->permissionCache.entries[i], 0, memory_order_relaxed);
+    }
     workSpace->flags = 0;
 }
 
+uint32_t GetWorkSpaceIndex(const char *name)
+{
+    for (uint32_t i = PARAM_AREA_DEFAULT + 1; i < PARAM_AREA_MAX; i++) {
+        if (strncmp(name, g_paramAreaPrefix[i], strlen(g_paramAreaPrefix[i])) == 0) {
+            return i;
+        }
+    }
+    return PARAM_AREA_DEFAULT;
+}
+
+WorkSpace *GetWorkSpaceByIndex(const ParamWorkSpace *workSpace, uint32_t index)
+{
+    PARAM_CHECK(workSpace != NULL && index < PARAM_AREA_MAX, return NULL, "Invalid area index %u", index);
+    WorkSpace *space = (index == PARAM_AREA_DEFAULT) ?
+        (WorkSpace *)&workSpace->paramSpace : (WorkSpace *)&workSpace->areaSpace[index - 1];
+    // checked without the lock, an area is only published once its node ops are set
+    ParamTrieHeader *area = PARAM_LOAD_AREA(space);
+    if (area != NULL && !atomic_load_explicit(&area->replaced, memory_order_acquire)) {
+        return space;
+    }
+    if (index == PARAM_AREA_DEFAULT && area == NULL) {
+        return space;
+    }
+    // a compacted area takes the file, the clients map it again
+    pthread_mutex_lock(&g_areaMutex);
+    int ret = InitParamArea(space, index, 1);
+    while (ret == 0 && atomic_load_explicit(&space->area->replaced, memory_order_acquire)) {
+        ret = RemapWorkSpace(space);
+    }
+    pthread_mutex_unlock(&g_areaMutex);
+    PARAM_CHECK(ret == 0, return NULL, "Failed to map area %s", g_paramAreaPrefix[index]);
+    return space;
+}
+
+WorkSpace *GetWorkSpace(const ParamWorkSpace *workSpace, const char *name)
+{
+    PARAM_CHECK(name != NULL, return NULL, "Invalid name");
+    return GetWorkSpaceByIndex(workSpace, GetWorkSpaceIndex(name));
+}
+
+int CheckLabelInWorkSpace(uint32_t index, const char *name)
+{
+    PARAM_CHECK(name != NULL && index < PARAM_AREA_MAX, return 0, "Invalid param");
+    if (GetWorkSpaceIndex(name) == index) {
+        return 1;
+    }
+    // labels on the parents of the area prefix are needed in the area too, ex: '#' and 'init.'
+    if (strcmp(name, "#") == 0) {
+        return 1;
+    }
+    size_t nameLen = strlen(name);
+    if (nameLen > 0 && name[nameLen - 1] == '.') {
+        nameLen--;
+    }
+    const char *prefix = g_paramAreaPrefix[index];
+    return (nameLen < strlen(prefix) && strncmp(prefix, name, nameLen) == 0 && prefix[nameLen] == '.') ? 1 : 0;
+}
+
+static ParamNode *GetParamNode(const ParamWorkSpace *workSpace, ParamHandle handle, WorkSpace **paramSpace)
+{
+    uint32_t index = PARAM_HANDLE_AREA(handle);
+    if (index >= PARAM_AREA_MAX) {
+        return NULL;
+    }
+    WorkSpace *space = GetWorkSpaceByIndex(workSpace, index);
+    if (space == NULL) {
+        return NULL;
+    }
+    if (paramSpace != NULL) {
+        *paramSpace = space;
+    }
+    // the offset belongs to the layout of the area before it was compacted
+    uint32_t epoch = atomic_load_explicit(&space->area->epoch, memory_order_acquire);
+    if (PARAM_HANDLE_EPOCH(handle) != (epoch & PARAM_HANDLE_EPOCH_MASK)) {
+        return NULL;
+    }
+    // the epoch in the handle wraps, an offset of an older layout must still be the start of a parameter
+    if (CheckParamNodeIndex(space, PARAM_HANDLE_OFFSET(handle)) != 0) {
+        return NULL;
+    }
+    return (ParamNode *)GetTrieNode(space, PARAM_HANDLE_OFFSET(handle));
+}
+
 static uint32_t ReadCommitId(ParamNode *entry)
 {
     uint32_t commitId = atomic_load_explicit(&entry->commitId, memory_order_acquire);
@@ -90,64 +204,436 @@ static uint32_t ReadCommitId(ParamNode *entry)
         futex_wait(&entry->commitId, commitId);
         commitId = atomic_load_explicit(&entry->commitId, memory_order_acquire);
     }
-    return commitId & PARAM_FLAGS_COMMITID;
+    return commitId & (PARAM_FLAGS_COMMITID | PARAM_FLAGS_DELETED);
 }
 
 int ReadParamCommitId(const ParamWorkSpace *workSpace, ParamHandle handle, uint32_t *commitId)
 {
     PARAM_CHECK(workSpace != NULL && commitId != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
-    ParamNode *entry = (ParamNode *)GetTrieNode(&workSpace->paramSpace, handle);
+    ParamNode *entry = GetParamNode(workSpace, handle, NULL);
     if (entry == NULL) {
         return -1;
     }
     *commitId = ReadCommitId(entry);
+    if (*commitId & PARAM_FLAGS_DELETED) {
+        *commitId &= PARAM_FLAGS_COMMITID;
+        return PARAM_CODE_NOT_FOUND;
+    }
+    return 0;
+}
+
+static ParamNode *GetLiveParamNode(const WorkSpace *space, uint32_t dataIndex)
+{
+    ParamNode *entry = (ParamNode *)GetTrieNode(space, dataIndex);
+    return (entry == NULL || PARAM_NODE_DELETED(entry)) ? NULL : entry;
+}
+
+static void FindParamEntry(const WorkSpace *space, const char *name, uint32_t *dataIndex, uint32_t *labelIndex)
+{
+    uint32_t nameLen = strlen(name);
+    if (FindParamHashEntry(space, name, nameLen, dataIndex, labelIndex) == 0) {
+        return;
+    }
+    // not an existing parameter, the trie still gives the label of the nearest prefix
+    ParamTrieNode *node = FindTrieNode(space, name, nameLen, labelIndex);
+    *dataIndex = (node != NULL) ? node->dataIndex : 0;
+}
+
+static void FindParamIndex(const WorkSpace *space, const char *name, uint32_t *dataIndex, uint32_t *labelIndex)
+{
+    FindParamEntry(space, name, dataIndex, labelIndex);
+    // a deleted parameter keeps its label only
+    if (GetLiveParamNode(space, *dataIndex) == NULL) {
+        *dataIndex = 0;
+    }
+}
+
+// generation + epoch:32 | valid:1 | allowed:1 | op:3 | area:3 | labelIndex:24
+#define PERMISSION_ENTRY_VALID (1ULL << 31)
+#define PERMISSION_ENTRY_ALLOWED (1ULL << 30)
+#define PERMISSION_ENTRY_GENERATION_SHIFT 32
+#define PERMISSION_ENTRY_OP_SHIFT 27
+#define PERMISSION_ENTRY_MASK 0x3fffffffULL
+#define PERMISSION_OP_SHIFT 6 // DAC_WATCH is the lowest op bit
+
+static uint64_t GetPermissionEntryKey(uint32_t areaIndex, uint32_t labelIndex, uint32_t mode)
+{
+    uint64_t op = (mode >> PERMISSION_OP_SHIFT) & 0x7; // 0x7 read, write and watch
+    return (op << PERMISSION_ENTRY_OP_SHIFT) | ((uint64_t)areaIndex << PARAM_HANDLE_AREA_SHIFT) |
+        (labelIndex & PARAM_HANDLE_OFFSET_MASK);
+}
+
+static atomic_ullong *GetPermissionEntry(ParamPermissionCache *cache, uint64_t key)
+{
+    uint32_t hash = GetTrieKeyHash((const char *)&key, sizeof(key));
+    return &cache->entries[hash % PARAM_PERMISSION_CACHE_SIZE];
+}
+
+// 0 when there are more groups than read on the stack
+static uint32_t GetLocalGroupsHash(void)
+{
+    gid_t groups[PARAM_LOCAL_GROUP_MAX] = { 0 };
+    int num = getgroups(PARAM_LOCAL_GROUP_MAX, groups);
+    if (num < 0) {
+        return 0;
+    }
+    uint32_t hash = GetTrieKeyHash((const char *)groups, (uint32_t)num * sizeof(gid_t));
+    return (hash == 0) ? 1 : hash; // 0 marks unknown groups
+}
+
+// both only grow, so their sum changes whenever one of them does
+static int GetPermissionEpoch(ParamPermissionCache *cache, const ParamSecurityLabel *srcLabel, uint32_t *epoch)
+{
+    // setgroups changes the supplementary groups and keeps uid and gid
+    uint32_t groups = GetLocalGroupsHash();
+    if (groups == 0) {
+        return -1;
+    }
+    uint64_t cred = ((uint64_t)srcLabel->cred.uid << PERMISSION_ENTRY_GENERATION_SHIFT) | (uint32_t)srcLabel->cred.gid;
+    uint64_t old = atomic_load_explicit(&cache->cred, memory_order_acquire);
+    uint32_t oldGroups = atomic_load_explicit(&cache->groups, memory_order_acquire);
+    if (old != cred || oldGroups != groups) {
+        atomic_store_explicit(&cache->cred, cred, memory_order_release);
+        atomic_store_explicit(&cache->groups, groups, memory_order_release);
+        atomic_fetch_add_explicit(&cache->epoch, 1, memory_order_acq_rel);
+    }
+    *epoch = atomic_load_explicit(&cache->epoch, memory_order_acquire);
     return 0;
 }
 
+static int CheckParamPermissionWithLabel(const ParamWorkSpace *workSpace, const ParamSecurityLabel *srcLabel,
+    uint32_t areaIndex, const char *name, uint32_t labelIndex, uint32_t mode)
+{
+    if (LABEL_IS_ALL_PERMITTED(workSpace->securityLabel)) {
+        return 0;
+    }
+    PARAM_CHECK(srcLabel != NULL, return -1, "Invalid param");
+    if (workSpace->paramSecurityOps.securityCheckParamPermission == NULL) {
+        return DAC_RESULT_FORBIDED;
+    }
+    WorkSpace *space = GetWorkSpaceByIndex(workSpace, areaIndex);
+    PARAM_CHECK(space != NULL && space->area != NULL, return DAC_RESULT_FORBIDED, "Invalid workspace for %s", name);
+    // only the verdicts for this process are cached, the server checks many callers
+    int cacheable = (srcLabel == workSpace->securityLabel) && ((mode & ~(DAC_READ | DAC_WRITE | DAC_WATCH)) == 0);
+    // the cache is a hint owned by this process, it is updated through read-only workspace pointers
+    ParamPermissionCache *cache = (ParamPermissionCache *)&workSpace->permissionCache;
+    uint64_t key = GetPermissionEntryKey(areaIndex, labelIndex, mode);
+    atomic_ullong *entry = GetPermissionEntry(cache, key);
+    // read before the label, so a label changed meanwhile makes the entry stale
+    uint32_t generation = atomic_load_explicit(&space->area->generation, memory_order_acquire);
+    uint32_t epoch = 0;
+    if (cacheable && GetPermissionEpoch(cache, srcLabel, &epoch) != 0) {
+        cacheable = 0;
+    }
+    if (cacheable) {
+        generation += epoch;
+        uint64_t value = atomic_load_explicit(entry, memory_order_relaxed);
+        if ((value & PERMISSION_ENTRY_VALID) && ((value >> PERMISSION_ENTRY_GENERATION_SHIFT) == generation) &&
+            ((value & PERMISSION_ENTRY_MASK) == key)) {
+            atomic_fetch_add_explicit(&cache->hit, 1, memory_order_relaxed);
+            return (value & PERMISSION_ENTRY_ALLOWED) ? DAC_RESULT_PERMISSION : DAC_RESULT_FORBIDED;
+        }
+        atomic_fetch_add_explicit(&cache->miss, 1, memory_order_relaxed);
+    }
+    ParamSecruityNode *node = (ParamSecruityNode *)GetTrieNode(space, labelIndex);
+    PARAM_CHECK(node != NULL, return DAC_RESULT_FORBIDED, "Can not get security label %d", labelIndex);
+
+    ParamAuditData auditData = {};
+    auditData.name = name;
+    auditData.dacData.uid = node->uid;
+    auditData.dacData.gid = node->gid;
+    auditData.dacData.mode = node->mode;
+    auditData.label = node->data;
+    int ret = workSpace->paramSecurityOps.securityCheckParamPermission(srcLabel, &auditData, mode);
+    if (cacheable && (ret == DAC_RESULT_PERMISSION || ret == DAC_RESULT_FORBIDED)) {
+        uint64_t value = ((uint64_t)generation << PERMISSION_ENTRY_GENERATION_SHIFT) | PERMISSION_ENTRY_VALID | key;
+        if (ret == DAC_RESULT_PERMISSION) {
+            value |= PERMISSION_ENTRY_ALLOWED;
+        }
+        atomic_store_explicit(entry, value, memory_order_relaxed);
+    }
+    return ret;
+}
+
+void GetParamPermissionCacheStat(const ParamWorkSpace *workSpace, uint32_t *hit, uint32_t *miss)
+{
+    PARAM_CHECK(workSpace != NULL && hit != NULL && miss != NULL, return, "Invalid param");
+    ParamPermissionCache *cache = (ParamPermissionCache *)&workSpace->permissionCache;
+    *hit = atomic_load_explicit(&cache->hit, memory_order_relaxed);
+    *miss = atomic_load_explicit(&cache->miss, memory_order_relaxed);
+}
+
+int ReadParamIndex(const ParamWorkSpace *workSpace, const char *name, ParamHandle *handle, uint32_t *labelIndex)
+{
+    PARAM_CHECK(workSpace != NULL && name != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param name");
+    PARAM_CHECK(handle != NULL && labelIndex != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param handle");
+    *handle = -1;
+    *labelIndex = 0;
+    uint32_t index = GetWorkSpaceIndex(name);
+    WorkSpace *space = GetWorkSpaceByIndex(workSpace, index);
+    PARAM_CHECK(space != NULL, return PARAM_CODE_NOT_FOUND, "Invalid workspace for %s", name);
+    // one lookup gives both the data and the security label
+    uint32_t dataIndex = 0;
+    FindParamIndex(space, name, &dataIndex, labelIndex);
+    if (dataIndex != 0) {
+        *handle = PARAM_HANDLE(index, atomic_load_explicit(&space->area->epoch, memory_order_relaxed), dataIndex);
+        return 0;
+    }
+    return PARAM_CODE_NOT_FOUND;
+}
+
+int CheckParamLabelPermission(const ParamWorkSpace *workSpace,
+    const char *name, uint32_t areaIndex, uint32_t labelIndex, uint32_t mode)
+{
+    PARAM_CHECK(workSpace != NULL && workSpace->securityLabel != NULL,
+        return PARAM_CODE_INVALID_PARAM, "Invalid param");
+    PARAM_CHECK(name != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param name");
+    if (LABEL_IS_ALL_PERMITTED(workSpace->securityLabel)) {
+        return 0;
+    }
+    return CheckParamPermissionWithLabel(workSpace, workSpace->securityLabel, areaIndex, name, labelIndex, mode);
+}
+
+uint32_t GetParamAreaGeneration(const ParamWorkSpace *workSpace, uint32_t index)
+{
+    WorkSpace *space = GetWorkSpaceByIndex(workSpace, index);
+    if (space == NULL || space->area == NULL) {
+        return 0;
+    }
+    return atomic_load_explicit(&space->area->generation, memory_order_acquire);
+}
+
 int ReadParamWithCheck(const ParamWorkSpace *workSpace, const char *name, uint32_t op, ParamHandle *handle)
 {
     PARAM_CHECK(handle != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param handle");
     PARAM_CHECK(workSpace != NULL && name != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param name");
-    *handle = -1;
-    int ret = CheckParamPermission(workSpace, workSpace->securityLabel, name, op);
+    uint32_t labelIndex = 0;
+    int result = ReadParamIndex(workSpace, name, handle, &labelIndex);
+    int ret = CheckParamLabelPermission(workSpace, name, GetWorkSpaceIndex(name), labelIndex, op);
+    if (ret != 0) {
+        *handle = -1;
+    }
     PARAM_CHECK(ret == 0, return ret, "Forbid to access parameter %s", name);
+    return result;
+}
+
+static const char *GetParamValue(const WorkSpace *space, const ParamNode *entry, uint32_t *valueLength)
+{
+    uint32_t size = 0;
+    const char *value = GetParamNodeValue(space, entry, &size);
+    // the length and the storage may belong to different commits while the value is changed
+    *valueLength = entry->valueLength;
+    if (*valueLength >= size) {
+        *valueLength = (size > 0) ? (size - 1) : 0;
+    }
+    return value;
+}
 
-    ParamTrieNode *node = FindTrieNode(&workSpace->paramSpace, name, strlen(name), NULL);
-    if (node != NULL && node->dataIndex != 0) {
-        *handle = node->dataIndex;
+static int CopyParamValue(const WorkSpace *space, const ParamNode *entry, char *value, uint32_t *length)
+{
+    if (value == NULL) {
+        *length = entry->valueLength + 1;
         return 0;
     }
-    return PARAM_CODE_NOT_FOUND;
+    uint32_t valueLength = 0;
+    const char *paramValue = GetParamValue(space, entry, &valueLength);
+    PARAM_CHECK(*length > valueLength, return PARAM_CODE_INVALID_PARAM,
+        "Invalid value len %u %u", *length, valueLength);
+    int ret = memcpy_s(value, *length, paramValue, valueLength);
+    PARAM_CHECK(ret == EOK, return -1, "Failed to copy value");
+    value[valueLength] = '\0';
+    *length = valueLength;
+    return 0;
 }
 
 int ReadParamValue(const ParamWorkSpace *workSpace, ParamHandle handle, char *value, uint32_t *length)
 {
     PARAM_CHECK(workSpace != NULL && length != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
-    ParamNode *entry = (ParamNode *)GetTrieNode(&workSpace->paramSpace, handle);
+    WorkSpace *space = NULL;
+    ParamNode *entry = GetParamNode(workSpace, handle, &space);
     if (entry == NULL) {
         return -1;
     }
+    if (PARAM_NODE_DELETED(entry)) {
+        return PARAM_CODE_NOT_FOUND;
+    }
     if (value == NULL) {
-        *length = entry->valueLength + 1;
-        return 0;
+        return CopyParamValue(space, entry, value, length);
     }
-    PARAM_CHECK(*length > entry->valueLength, return PARAM_CODE_INVALID_PARAM,
-        "Invalid value len %u %u", *length, entry->valueLength);
+    uint32_t size = *length;
     uint32_t commitId = ReadCommitId(entry);
-    do {
-        int ret = memcpy_s(value, *length, entry->data + entry->keyLength + 1, entry->valueLength);
-        PARAM_CHECK(ret == EOK, return -1, "Failed to copy value");
-        value[entry->valueLength] = '\0';
-        *length = entry->valueLength;
-    } while (commitId != ReadCommitId(entry));
-    return 0;
+    while ((commitId & PARAM_FLAGS_DELETED) == 0) {
+        *length = size;
+        int ret = CopyParamValue(space, entry, value, length);
+        PARAM_CHECK(ret == 0, return ret, "Failed to read value");
+        // copy again from the latest commit, the value may be moved to another slot meanwhile
+        atomic_thread_fence(memory_order_acquire);
+        uint32_t current = ReadCommitId(entry);
+        if (current == commitId) {
+            return 0;
+        }
+        commitId = current;
+    }
+    return PARAM_CODE_NOT_FOUND;
+}
+
+#define PARAM_WAIT_SLICE_MAX 999 // ms, the futex timeout must be less than 1s
+
+static int IsParamValueMatch(const WorkSpace *space, const ParamNode *entry, const char *value)
+{
+    uint32_t valueLength = 0;
+    const char *paramValue = GetParamValue(space, entry, &valueLength);
+    if (strncmp(value, "*", 1) == 0) {
+        return 1;
+    }
+    // compare in the shared memory, bounded by the length as the value may be changed meanwhile
+    const char *tmp = strstr(value, "*");
+    if (tmp != NULL) {
+        return ((uint32_t)(tmp - value) <= valueLength && strncmp(paramValue, value, tmp - value) == 0) ? 1 : 0;
+    }
+    return (strlen(value) == valueLength && memcmp(paramValue, value, valueLength) == 0) ? 1 : 0;
+}
+
+static int64_t GetWaitRemain(const struct timespec *deadline)
+{
+    struct timespec now = {};
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    const int64_t msPerSecond = 1000;
+    const int64_t nsPerMs = 1000 * 1000;
+    return (deadline->tv_sec - now.tv_sec) * msPerSecond + (deadline->tv_nsec - now.tv_nsec) / nsPerMs;
+}
+
+int WaitParamValue(const ParamWorkSpace *workSpace, const char *name, const char *value, uint32_t timeout)
+{
+    PARAM_CHECK(workSpace != NULL && name != NULL && value != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
+    uint32_t index = GetWorkSpaceIndex(name);
+    struct timespec deadline = {};
+    (void)clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout;
+    while (1) {
+        // the area may be compacted while waiting, its waiters are woken up to map the new one
+        WorkSpace *space = GetWorkSpaceByIndex(workSpace, index);
+        PARAM_CHECK(space != NULL && space->area != NULL,
+            return PARAM_CODE_NOT_FOUND, "Invalid workspace for %s", name);
+        // load the futex word before the check, any change after it makes the wait return at once
+        atomic_uint *futex = &space->area->serial;
+        uint32_t expect = atomic_load_explicit(futex, memory_order_acquire);
+        uint32_t dataIndex = 0;
+        uint32_t labelIndex = 0;
+        FindParamEntry(space, name, &dataIndex, &labelIndex);
+        ParamNode *entry = (ParamNode *)GetTrieNode(space, dataIndex);
+        if (entry != NULL) {
+            // a deleted parameter is waited on its commit id, it is woken up when added again
+            futex = &entry->commitId;
+            expect = atomic_load_explicit(futex, memory_order_acquire);
+            if ((expect & (PARAM_FLAGS_MODIFY | PARAM_FLAGS_DELETED)) == 0 && IsParamValueMatch(space, entry, value)) {
+                // the match counts only when no update ran across the compare
+                atomic_thread_fence(memory_order_acquire);
+                if (atomic_load_explicit(futex, memory_order_relaxed) == expect) {
+                    return 0;
+                }
+                continue;
+            }
+        }
+        int64_t remain = GetWaitRemain(&deadline);
+        if (remain <= 0) {
+            return PARAM_CODE_TIMEOUT;
+        }
+        futex_wait_timeout(futex, expect, (remain < PARAM_WAIT_SLICE_MAX) ? remain : PARAM_WAIT_SLICE_MAX);
+    }
+}
+
+atomic_uint *GetParamChangeSerial(const ParamWorkSpace *workSpace, const char *name)
+{
+    PARAM_CHECK(workSpace != NULL, return NULL, "Invalid workSpace");
+    WorkSpace *space = GetWorkSpaceByIndex(workSpace, PARAM_AREA_DEFAULT);
+    ParamTrieHeader *area = (space != NULL) ? space->area : NULL;
+    if (area == NULL) {
+        return NULL;
+    }
+    size_t prefixLen = (name != NULL) ? strcspn(name, ".") : 0;
+    if (prefixLen == 0) {
+        return &area->changeSerial;
+    }
+    return &area->prefixSerial[GetTrieKeyHash(name, prefixLen) % PARAM_PREFIX_SERIAL_MAX];
+}
+
+int WaitParamChange(const ParamWorkSpace *workSpace, const char *name, uint32_t *serial, uint32_t timeout)
+{
+    PARAM_CHECK(serial != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid serial");
+    atomic_uint *futex = GetParamChangeSerial(workSpace, name);
+    PARAM_CHECK(futex != NULL, return PARAM_CODE_NOT_INIT, "Invalid workspace");
+    struct timespec deadline = {};
+    (void)clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout;
+    uint32_t expect = *serial;
+    while (1) {
+        *serial = atomic_load_explicit(futex, memory_order_acquire);
+        if (*serial != expect) {
+            return 0;
+        }
+        int64_t remain = GetWaitRemain(&deadline);
+        if (remain <= 0) {
+            return PARAM_CODE_TIMEOUT;
+        }
+        futex_wait_timeout(futex, expect, (remain < PARAM_WAIT_SLICE_MAX) ? remain : PARAM_WAIT_SLICE_MAX);
+    }
+}
+
+int ReadParamValues(const ParamWorkSpace *workSpace,
+    const ParamHandle handles[], char *values[], uint32_t lengths[], uint32_t count)
+{
+    PARAM_CHECK(workSpace != NULL && handles != NULL && values != NULL && lengths != NULL,
+        return PARAM_CODE_INVALID_PARAM, "Invalid param");
+    PARAM_CHECK(count <= PARAM_BATCH_MAX, return PARAM_CODE_INVALID_PARAM, "Invalid count %u", count);
+    ParamNode *entries[PARAM_BATCH_MAX] = { NULL };
+    WorkSpace *spaces[PARAM_BATCH_MAX] = { NULL };
+    uint32_t commitIds[PARAM_BATCH_MAX] = { 0 };
+    uint32_t sizes[PARAM_BATCH_MAX] = { 0 };
+    for (uint32_t i = 0; i < count; i++) {
+        entries[i] = GetParamNode(workSpace, handles[i], &spaces[i]);
+        sizes[i] = lengths[i];
+    }
+    int result = 0;
+    // all values are copied from the same commits, or copied again
+    for (uint32_t retry = 0; retry < PARAM_SNAPSHOT_RETRY; retry++) {
+        for (uint32_t i = 0; i < count; i++) {
+            commitIds[i] = (entries[i] != NULL) ? ReadCommitId(entries[i]) : 0;
+        }
+        int ret = 0;
+        result = 0;
+        for (uint32_t i = 0; i < count && ret == 0; i++) {
+            lengths[i] = sizes[i];
+            if (entries[i] == NULL) {
+                lengths[i] = 0;
+                continue;
+            }
+            // deleted after the handle was resolved
+            if (commitIds[i] & PARAM_FLAGS_DELETED) {
+                lengths[i] = 0;
+                result = PARAM_CODE_NOT_FOUND;
+                continue;
+            }
+            ret = CopyParamValue(spaces[i], entries[i], values[i], &lengths[i]);
+        }
+        PARAM_CHECK(ret == 0, return ret, "Failed to read parameter values");
+        uint32_t i = 0;
+        while (i < count && (entries[i] == NULL || commitIds[i] == ReadCommitId(entries[i]))) {
+            i++;
+        }
+        if (i == count) {
+            return result;
+        }
+    }
+    PARAM_LOGE("Parameters are changing, failed to read a snapshot of %u parameters", count);
+    return PARAM_CODE_TIMEOUT;
 }
 
 int ReadParamName(const ParamWorkSpace *workSpace, ParamHandle handle, char *name, uint32_t length)
 {
     PARAM_CHECK(workSpace != NULL && name != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
-    ParamNode *entry = (ParamNode *)GetTrieNode(&workSpace->paramSpace, handle);
-    if (entry == NULL) {
+    ParamNode *entry = GetParamNode(workSpace, handle, NULL);
+    if (entry == NULL || PARAM_NODE_DELETED(entry)) {
         return -1;
     }
     PARAM_CHECK(length > entry->keyLength, return -1, "Invalid param size %u %u", entry->keyLength, length);
@@ -193,28 +679,98 @@ int CheckParamName(const char *name, int info)
     return 0;
 }
 
-static int ProcessParamTraversal(const WorkSpace *workSpace, const ParamTrieNode *node, void *cookie)
+static int ParamCursorNextArea(ParamCursor *cursor)
 {
-    UNUSED(workSpace);
-    ParamTraversalContext *context = (ParamTraversalContext *)cookie;
-    ParamTrieNode *current = (ParamTrieNode *)node;
-    if (current == NULL) {
-        return 0;
+    const char *prefix = cursor->prefix;
+    for (; cursor->areaIndex < PARAM_AREA_MAX; cursor->areaIndex++) {
+        if (prefix[0] != '#' && !CheckLabelInWorkSpace(cursor->areaIndex, prefix)) {
+            continue;
+        }
+        WorkSpace *space = GetWorkSpaceByIndex(cursor->workSpace, cursor->areaIndex);
+        if (space == NULL) {
+            continue;
+        }
+        ParamTrieNode *root = NULL;
+        if (prefix[0] != '#') {
+            root = FindTrieNode(space, prefix, strlen(prefix), NULL);
+            if (root == NULL) {
+                continue;
+            }
+        }
+        return TrieCursorBegin(&cursor->trieCursor, space, root);
     }
-    if (current->dataIndex == 0) {
-        return 0;
+    return PARAM_CODE_NOT_FOUND;
+}
+
+int ParamCursorBegin(ParamCursor *cursor, const ParamWorkSpace *workSpace, const char *prefix)
+{
+    PARAM_CHECK(cursor != NULL && workSpace != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
+    if (prefix == NULL || prefix[0] == '\0') {
+        prefix = "#";
     }
-    context->traversalParamPtr(current->dataIndex, context->context);
+    size_t prefixLen = strlen(prefix);
+    PARAM_CHECK(prefixLen < PARAM_NAME_LEN_MAX, return PARAM_CODE_INVALID_NAME, "Invalid prefix %s", prefix);
+    int ret = memcpy_s(cursor->prefix, sizeof(cursor->prefix), prefix, prefixLen);
+    PARAM_CHECK(ret == EOK, return PARAM_CODE_INVALID_NAME, "Failed to copy prefix %s", prefix);
+    if (prefixLen > 1 && cursor->prefix[prefixLen - 1] == '.') {
+        prefixLen--;
+    }
+    cursor->prefix[prefixLen] = '\0';
+    cursor->workSpace = workSpace;
+    cursor->areaIndex = PARAM_AREA_DEFAULT;
+    cursor->trieCursor.workSpace = NULL;
+    cursor->trieCursor.top = 0;
+    cursor->trieCursor.error = 0;
     return 0;
 }
 
+int ParamCursorNext(ParamCursor *cursor, ParamHandle *handle)
+{
+    PARAM_CHECK(cursor != NULL && handle != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
+    while (cursor->areaIndex < PARAM_AREA_MAX) {
+        if (cursor->trieCursor.workSpace == NULL) {
+            int ret = ParamCursorNextArea(cursor);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+        const WorkSpace *space = cursor->trieCursor.workSpace;
+        ParamTrieNode *node = TrieCursorNext(&cursor->trieCursor);
+        while (node != NULL && GetLiveParamNode(space, node->dataIndex) == NULL) {
+            node = TrieCursorNext(&cursor->trieCursor);
+        }
+        if (node != NULL) {
+            *handle = PARAM_HANDLE(cursor->areaIndex,
+                atomic_load_explicit(&cursor->trieCursor.area->epoch, memory_order_relaxed), node->dataIndex);
+            return 0;
+        }
+        int ret = cursor->trieCursor.error;
+        TrieCursorEnd(&cursor->trieCursor);
+        PARAM_CHECK(ret == 0, return ret, "Failed to traversal area %u", cursor->areaIndex);
+        cursor->areaIndex++;
+    }
+    return PARAM_CODE_NOT_FOUND;
+}
+
+void ParamCursorEnd(ParamCursor *cursor)
+{
+    PARAM_CHECK(cursor != NULL, return, "Invalid cursor");
+    TrieCursorEnd(&cursor->trieCursor);
+    cursor->areaIndex = PARAM_AREA_MAX;
+}
+
 int TraversalParam(const ParamWorkSpace *workSpace, TraversalParamPtr walkFunc, void *cookie)
 {
     PARAM_CHECK(workSpace != NULL && walkFunc != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
-    ParamTraversalContext context = {
-        walkFunc, cookie
-    };
-    return TraversalTrieNode(&workSpace->paramSpace, NULL, ProcessParamTraversal, &context);
+    ParamCursor cursor;
+    int ret = ParamCursorBegin(&cursor, workSpace, NULL);
+    PARAM_CHECK(ret == 0, return ret, "Failed to begin traversal");
+    ParamHandle handle = 0;
+    while ((ret = ParamCursorNext(&cursor, &handle)) == 0) {
+        walkFunc(handle, cookie);
+    }
+    ParamCursorEnd(&cursor);
+    return (ret == PARAM_CODE_NOT_FOUND) ? 0 : ret;
 }
 
 int CheckParamPermission(const ParamWorkSpace *workSpace,
@@ -226,21 +782,13 @@ int CheckParamPermission(const ParamWorkSpace *workSpace,
         return 0;
     }
     PARAM_CHECK(name != NULL && srcLabel != NULL, return -1, "Invalid param");
-    if (workSpace->paramSecurityOps.securityCheckParamPermission == NULL) {
-        return DAC_RESULT_FORBIDED;
-    }
+    uint32_t index = GetWorkSpaceIndex(name);
+    WorkSpace *space = GetWorkSpaceByIndex(workSpace, index);
+    PARAM_CHECK(space != NULL, return DAC_RESULT_FORBIDED, "Invalid workspace for %s", name);
+    uint32_t dataIndex = 0;
     uint32_t labelIndex = 0;
-    FindTrieNode(&workSpace->paramSpace, name, strlen(name), &labelIndex);
-    ParamSecruityNode *node = (ParamSecruityNode *)GetTrieNode(&workSpace->paramSpace, labelIndex);
-    PARAM_CHECK(node != NULL, return DAC_RESULT_FORBIDED, "Can not get security label %d", labelIndex);
-
-    ParamAuditData auditData = {};
-    auditData.name = name;
-    auditData.dacData.uid = node->uid;
-    auditData.dacData.gid = node->gid;
-    auditData.dacData.mode = node->mode;
-    auditData.label = node->data;
-    return workSpace->paramSecurityOps.securityCheckParamPermission(srcLabel, &auditData, mode);
+    FindParamIndex(space, name, &dataIndex, &labelIndex);
+    return CheckParamPermissionWithLabel(workSpace, srcLabel, index, name, labelIndex, mode);
 }
 
 static int DumpTrieDataNodeTraversal(const WorkSpace *workSpace, const ParamTrieNode *node, void *cookie)
@@ -256,10 +804,12 @@ static int DumpTrieDataNodeTraversal(const WorkSpace *workSpace, const ParamTrie
             current->dataIndex, current->labelIndex, current->length, current->key);
     }
     if (current->dataIndex != 0) {
-        ParamNode *entry = (ParamNode *)GetTrieNode(workSpace, current->dataIndex);
+        ParamNode *entry = GetLiveParamNode(workSpace, current->dataIndex);
         if (entry != NULL) {
-            printf("\tparameter length info [%d, %d] \n\t  param: %s \n",
-                entry->keyLength, entry->valueLength, (entry != NULL) ? entry->data : "null");
+            uint32_t valueLength = 0;
+            const char *value = GetParamValue(workSpace, entry, &valueLength);
+            printf("\tparameter length info [%d, %d] \n\t  param: %.*s=%.*s \n",
+                entry->keyLength, entry->valueLength, (int)entry->keyLength, entry->data, (int)valueLength, value);
         }
     }
     if (current->labelIndex != 0 && verbose) {
@@ -272,33 +822,43 @@ static int DumpTrieDataNodeTraversal(const WorkSpace *workSpace, const ParamTrie
     return 0;
 }
 
-static void DumpWorkSpace(const ParamWorkSpace *workSpace, int verbose)
+static void DumpWorkSpace(const WorkSpace *space, int verbose)
 {
     printf("workSpace information \n");
-    printf("    map file: %s \n", workSpace->paramSpace.fileName);
-    if (workSpace->paramSpace.area != NULL) {
-        printf("    total size: %d \n", workSpace->paramSpace.area->dataSize);
-        printf("    first offset: %d \n", workSpace->paramSpace.area->firstNode);
-        printf("    current offset: %d \n", workSpace->paramSpace.area->currOffset);
-        printf("    total node: %d \n", workSpace->paramSpace.area->trieNodeCount);
-        printf("    total param node: %d \n", workSpace->paramSpace.area->paramNodeCount);
-        printf("    total security node: %d\n", workSpace->paramSpace.area->securityNodeCount);
+    printf("    map file: %s \n", space->fileName);
+    if (space->area != NULL) {
+        printf("    total size: %d \n", space->area->dataSize);
+        printf("    first offset: %d \n", space->area->firstNode);
+        printf("    current offset: %d \n", space->area->currOffset);
+        printf("    total node: %d \n", space->area->trieNodeCount);
+        printf("    total param node: %d \n", space->area->paramNodeCount);
+        printf("    total security node: %d\n", space->area->securityNodeCount);
+        printf("    deleted size: %u \n", space->area->deletedSize);
     }
     printf("    node info: \n");
-    TraversalTrieNode(&workSpace->paramSpace, NULL, DumpTrieDataNodeTraversal, (void *)&verbose);
+    TraversalTrieNode(space, NULL, DumpTrieDataNodeTraversal, (void *)&verbose);
 }
 
 void DumpParameters(const ParamWorkSpace *workSpace, int verbose)
 {
     PARAM_CHECK(workSpace != NULL && workSpace->securityLabel != NULL, return, "Invalid param");
     printf("Dump all paramters begin ...\n");
-    DumpWorkSpace(workSpace, verbose);
+    for (uint32_t i = PARAM_AREA_DEFAULT; i < PARAM_AREA_MAX; i++) {
+        WorkSpace *space = GetWorkSpaceByIndex(workSpace, i);
+        if (space != NULL) {
+            DumpWorkSpace(space, verbose);
+        }
+    }
     if (verbose) {
         printf("Local sercurity information\n");
         printf("\t pid: %d uid: %d gid: %d \n",
             workSpace->securityLabel->cred.pid,
             workSpace->securityLabel->cred.uid,
             workSpace->securityLabel->cred.gid);
+        uint32_t hit = 0;
+        uint32_t miss = 0;
+        GetParamPermissionCacheStat(workSpace, &hit, &miss);
+        printf("\t permission cache hit: %u miss: %u \n", hit, miss);
     }
     printf("Dump all paramters finish\n");
 }
@@ -17,6 +17,8 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -27,10 +29,12 @@
 #include "param_utils.h"
 #include "sys_param.h"
 
+static void SetTrieNodeOps(WorkSpace *workSpace);
+
 static int InitWorkSpace_(WorkSpace *workSpace, int mode, int prot, uint32_t spaceSize, int readOnly)
 {
     PARAM_CHECK(workSpace != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
-    PARAM_CHECK(spaceSize <= PARAM_WORKSPACE_MAX, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
+    PARAM_CHECK(spaceSize <= workSpace->spaceSizeMax, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
     PARAM_CHECK(workSpace->allocTrieNode != NULL,
         return PARAM_CODE_INVALID_PARAM, "Invalid allocTrieNode %s", workSpace->fileName);
     PARAM_CHECK(workSpace->compareTrieNode != NULL,
@@ -45,25 +49,68 @@ static int InitWorkSpace_(WorkSpace *workSpace, int mode, int prot, uint32_t spa
     if (!readOnly) {
         ftruncate(fd, spaceSize);
     }
-    void *areaAddr = (void *)mmap(NULL, spaceSize, prot, MAP_SHARED, fd, 0);
+    // map the whole reserved range, the file is extended in place when the workspace grows,
+    // so offsets stay valid and readers only need to check the latest dataSize
+    void *areaAddr = (void *)mmap(NULL, workSpace->spaceSizeMax, prot, MAP_SHARED, fd, 0);
     PARAM_CHECK(areaAddr != MAP_FAILED && areaAddr != NULL, close(fd);
         return PARAM_CODE_ERROR_MAP_FILE, "Failed to map memory error %d", errno);
     close(fd);
 
+    ParamTrieHeader *area = (ParamTrieHeader *)areaAddr;
     if (!readOnly) {
-        workSpace->area = (ParamTrieHeader *)areaAddr;
-        workSpace->area->trieNodeCount = 0;
-        workSpace->area->paramNodeCount = 0;
-        workSpace->area->securityNodeCount = 0;
-        workSpace->area->dataSize = spaceSize - sizeof(ParamTrieHeader);
-        workSpace->area->currOffset = 0;
-        uint32_t offset = workSpace->allocTrieNode(workSpace, "#", 1);
-        workSpace->area->firstNode = offset;
+        area->trieNodeCount = 0;
+        area->paramNodeCount = 0;
+        area->securityNodeCount = 0;
+        area->dataSize = spaceSize - sizeof(ParamTrieHeader);
+        area->currOffset = 0;
+        area->trieType = workSpace->trieType;
+        atomic_init(&area->hashIndex, 0);
+        atomic_init(&area->generation, 0);
+        atomic_init(&area->serial, 0);
+        atomic_init(&area->changeSerial, 0);
+        for (uint32_t i = 0; i < PARAM_PREFIX_SERIAL_MAX; i++) {
+            atomic_init(&area->prefixSerial[i], 0);
+        }
+        for (uint32_t i = 0; i < PARAM_VALUE_CLASS_MAX; i++) {
+            area->freeValue[i] = 0;
+        }
+        area->deletedSize = 0;
+        atomic_init(&area->epoch, 0);
+        atomic_init(&area->replaced, 0);
+        area->labelTableIndex = 0;
+        // the root is added before the area is published
+        WorkSpace init = *workSpace;
+        init.area = area;
+        area->firstNode = init.allocTrieNode(&init, "#", 1);
     } else {
-        workSpace->area = (ParamTrieHeader *)areaAddr;
+        workSpace->trieType = area->trieType;
     }
+    SetTrieNodeOps(workSpace);
+    PARAM_PUBLISH_AREA(workSpace, area);
     PARAM_LOGD("InitWorkSpace success, readOnly %d currOffset %u firstNode %u dataSize %u",
-        readOnly, workSpace->area->currOffset, workSpace->area->firstNode, workSpace->area->dataSize);
+        readOnly, area->currOffset, area->firstNode, area->dataSize);
+    return 0;
+}
+
+static int ExtendWorkSpace(WorkSpace *workSpace, uint32_t len)
+{
+    ParamTrieHeader *area = workSpace->area;
+    if ((area->currOffset + len) < area->dataSize) {
+        return 0;
+    }
+    uint32_t spaceSize = area->dataSize + sizeof(ParamTrieHeader);
+    uint32_t newSize = spaceSize + PARAM_WORKSPACE_DEF;
+    while (newSize < (area->currOffset + len + sizeof(ParamTrieHeader) + 1)) {
+        newSize += PARAM_WORKSPACE_DEF;
+    }
+    PARAM_CHECK(newSize <= workSpace->spaceSizeMax, return PARAM_CODE_REACHED_MAX,
+        "Failed to extend %s to %u, max %u", workSpace->fileName, newSize, workSpace->spaceSizeMax);
+    int ret = truncate(workSpace->fileName, newSize);
+    PARAM_CHECK(ret == 0, return PARAM_CODE_REACHED_MAX,
+        "Failed to extend %s to %u error %d", workSpace->fileName, newSize, errno);
+    // publish after the file is extended, readers check offset against dataSize
+    area->dataSize = newSize - sizeof(ParamTrieHeader);
+    PARAM_LOGI("Extend workspace %s size %u -> %u", workSpace->fileName, spaceSize, newSize);
     return 0;
 }
 
@@ -71,7 +118,7 @@ static uint32_t AllocateParamTrieNode(WorkSpace *workSpace, const char *key, uin
 {
     uint32_t len = keyLen + sizeof(ParamTrieNode) + 1;
     len = PARAM_ALIGN(len);
-    PARAM_CHECK((workSpace->area->currOffset + len) < workSpace->area->dataSize, return 0,
+    PARAM_CHECK(ExtendWorkSpace(workSpace, len) == 0, return 0,
         "Failed to allocate currOffset %d, dataSize %d", workSpace->area->currOffset, workSpace->area->dataSize);
     ParamTrieNode *node = (ParamTrieNode*)(workSpace->area->data + workSpace->area->currOffset);
     node->length = keyLen;
@@ -99,37 +146,6 @@ static int CompareParamTrieNode(const ParamTrieNode *node, const char *key, uint
     return strncmp(node->key, key, keyLen);
 }
 
-int InitWorkSpace(const char *fileName, WorkSpace *workSpace, int onlyRead)
-{
-    PARAM_CHECK(fileName != NULL, return PARAM_CODE_INVALID_NAME, "Invalid fileName");
-    PARAM_CHECK(workSpace != NULL, return PARAM_CODE_INVALID_NAME, "Invalid workSpace");
-    if (workSpace->area != NULL) {
-        return 0;
-    }
-    workSpace->compareTrieNode = CompareParamTrieNode;
-    workSpace->allocTrieNode = AllocateParamTrieNode;
-    int ret = strcpy_s(workSpace->fileName, sizeof(workSpace->fileName), fileName);
-    PARAM_CHECK(ret == 0, return ret, "Failed to copy file name %s", fileName);
-    int openMode;
-    int prot = PROT_READ;
-    if (onlyRead) {
-        openMode = O_RDONLY;
-    } else {
-        openMode = O_CREAT | O_RDWR | O_TRUNC;
-        prot = PROT_READ | PROT_WRITE;
-    }
-    ret = InitWorkSpace_(workSpace, openMode, prot, PARAM_WORKSPACE_MAX, onlyRead);
-    PARAM_CHECK(ret == 0, return ret, "Failed to init workspace  %s", workSpace->fileName);
-    return ret;
-}
-
-void CloseWorkSpace(WorkSpace *workSpace)
-{
-    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return, "The workspace is null");
-    munmap((char *)workSpace->area, workSpace->area->dataSize);
-    workSpace->area = NULL;
-}
-
 static ParamTrieNode *GetTrieRoot(const WorkSpace *workSpace)
 {
     PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return NULL, "The workspace is null");
@@ -151,29 +167,176 @@ static ParamTrieNode *AddToSubTrie(WorkSpace *workSpace, ParamTrieNode *current,
     if (current == NULL || workSpace == NULL || key == NULL) {
         return NULL;
     }
-    ParamTrieNode *subTrie = NULL;
-    int ret = workSpace->compareTrieNode(current, key, keyLen);
-    if (ret == 0) {
-        return current;
-    }
-    if (ret < 0) {
-        subTrie = GetTrieNode(workSpace, current->left);
-        if (subTrie == NULL) {
-            uint32_t offset = workSpace->allocTrieNode(workSpace, key, keyLen);
-            PARAM_CHECK(offset != 0, return NULL, "Failed to allocate key %s", key);
-            SaveIndex(&current->left, offset);
-            return GetTrieNode(workSpace, current->left);
+    while (1) {
+        int ret = workSpace->compareTrieNode(current, key, keyLen);
+        if (ret == 0) {
+            return current;
         }
-    } else {
-        subTrie = GetTrieNode(workSpace, current->right);
+        uint32_t *index = (ret < 0) ? &current->left : &current->right;
+        ParamTrieNode *subTrie = GetTrieNode(workSpace, *index);
         if (subTrie == NULL) {
             uint32_t offset = workSpace->allocTrieNode(workSpace, key, keyLen);
             PARAM_CHECK(offset != 0, return NULL, "Failed to allocate key %s", key);
-            SaveIndex(&current->right, offset);
-            return GetTrieNode(workSpace, current->right);
+            SaveIndex(index, offset);
+            return GetTrieNode(workSpace, *index);
         }
+        current = subTrie;
+    }
+}
+
+static ParamTrieNode *AddBstChildNode(WorkSpace *workSpace, ParamTrieNode *parent, const char *key, uint32_t keyLen)
+{
+    if (parent->child != 0) { // 如果child存在，则检查是否匹配
+        return AddToSubTrie(workSpace, GetTrieNode(workSpace, parent->child), key, keyLen);
+    }
+    uint32_t offset = workSpace->allocTrieNode(workSpace, key, keyLen);
+    PARAM_CHECK(offset != 0, return NULL, "Failed to allocate key %s", key);
+    SaveIndex(&parent->child, offset);
+    return GetTrieNode(workSpace, parent->child);
+}
+
+static ParamTrieNode *FindSubTrie(const WorkSpace *workSpace,
+    ParamTrieNode *current, const char *key, uint32_t keyLen)
+{
+    while (current != NULL) {
+        int ret = workSpace->compareTrieNode(current, key, keyLen);
+        if (ret == 0) {
+            return current;
+        }
+        current = GetTrieNode(workSpace, (ret < 0) ? current->left : current->right);
+    }
+    return NULL;
+}
+
+static ParamTrieNode *FindBstChildNode(const WorkSpace *workSpace,
+    const ParamTrieNode *parent, const char *key, uint32_t keyLen)
+{
+    return FindSubTrie(workSpace, GetTrieNode(workSpace, parent->child), key, keyLen);
+}
+
+uint32_t GetTrieKeyHash(const char *key, uint32_t keyLen)
+{
+    uint32_t hash = 2166136261U; // FNV-1a offset basis
+    for (uint32_t i = 0; i < keyLen; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619U; // FNV-1a prime
+    }
+    return hash;
+}
+
+static uint32_t LowerBoundTrieEntry(const ParamTrieEntry *entry, uint32_t count, uint32_t hash)
+{
+    uint32_t low = 0;
+    while (count > 0) {
+        uint32_t half = count >> 1;
+        uint32_t less = (entry[low + half].hash < hash) ? 1 : 0;
+        low += less * (half + 1);
+        count = less ? (count - half - 1) : half;
+    }
+    return low;
+}
+
+static ParamTrieNode *FindArrayChildNode(const WorkSpace *workSpace,
+    const ParamTrieNode *parent, const char *key, uint32_t keyLen)
+{
+    uint32_t hash = GetTrieKeyHash(key, keyLen);
+    while (1) {
+        ParamTrieArray *array = (ParamTrieArray *)GetTrieNode(workSpace, parent->child);
+        if (array == NULL) {
+            return NULL;
+        }
+        uint32_t version = atomic_load_explicit(&array->version, memory_order_acquire);
+        if (version & 0x01) { // writer is inserting
+            continue;
+        }
+        ParamTrieNode *node = NULL;
+        uint32_t count = (array->count < array->capacity) ? array->count : array->capacity;
+        for (uint32_t i = LowerBoundTrieEntry(array->entry, count, hash);
+            i < count && array->entry[i].hash == hash; i++) {
+            ParamTrieNode *tmp = GetTrieNode(workSpace, array->entry[i].offset);
+            if (tmp != NULL && workSpace->compareTrieNode(tmp, key, keyLen) == 0) {
+                node = tmp;
+                break;
+            }
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (version == atomic_load_explicit(&array->version, memory_order_relaxed)) {
+            return node;
+        }
+    }
+}
+
+static uint32_t AllocateTrieArray(WorkSpace *workSpace, const ParamTrieArray *old)
+{
+    uint32_t capacity = (old == NULL) ? PARAM_TRIE_ARRAY_INIT : old->capacity * 2; // 2 double
+    uint32_t len = sizeof(ParamTrieArray) + capacity * sizeof(ParamTrieEntry);
+    PARAM_CHECK(ExtendWorkSpace(workSpace, len) == 0, return 0,
+        "Failed to allocate currOffset %u, dataSize %u", workSpace->area->currOffset, workSpace->area->dataSize);
+    ParamTrieArray *array = (ParamTrieArray *)(workSpace->area->data + workSpace->area->currOffset);
+    atomic_init(&array->version, 0);
+    array->capacity = capacity;
+    array->count = 0;
+    if (old != NULL) {
+        int ret = memcpy_s(array->entry, capacity * sizeof(ParamTrieEntry),
+            old->entry, old->count * sizeof(ParamTrieEntry));
+        PARAM_CHECK(ret == EOK, return 0, "Failed to copy trie array");
+        array->count = old->count;
+    }
+    uint32_t offset = workSpace->area->currOffset;
+    workSpace->area->currOffset += len;
+    return offset;
+}
+
+static void InsertTrieEntry(ParamTrieArray *array, uint32_t hash, uint32_t offset)
+{
+    uint32_t index = LowerBoundTrieEntry(array->entry, array->count, hash);
+    while (index < array->count && array->entry[index].hash == hash) {
+        index++;
+    }
+    for (uint32_t i = array->count; i > index; i--) {
+        array->entry[i] = array->entry[i - 1];
+    }
+    array->entry[index].hash = hash;
+    array->entry[index].offset = offset;
+    array->count++;
+}
+
+static ParamTrieNode *AddArrayChildNode(WorkSpace *workSpace, ParamTrieNode *parent, const char *key, uint32_t keyLen)
+{
+    ParamTrieNode *node = FindArrayChildNode(workSpace, parent, key, keyLen);
+    if (node != NULL) {
+        return node;
+    }
+    uint32_t offset = workSpace->allocTrieNode(workSpace, key, keyLen);
+    PARAM_CHECK(offset != 0, return NULL, "Failed to allocate key %s", key);
+    uint32_t hash = GetTrieKeyHash(key, keyLen);
+    ParamTrieArray *array = (ParamTrieArray *)GetTrieNode(workSpace, parent->child);
+    if (array == NULL || array->count >= array->capacity) {
+        // readers keep using the old array until the new one is published
+        uint32_t arrayOffset = AllocateTrieArray(workSpace, array);
+        PARAM_CHECK(arrayOffset != 0, return NULL, "Failed to allocate array for %s", key);
+        InsertTrieEntry((ParamTrieArray *)GetTrieNode(workSpace, arrayOffset), hash, offset);
+        SaveIndex(&parent->child, arrayOffset);
+    } else {
+        uint32_t version = atomic_load_explicit(&array->version, memory_order_relaxed);
+        atomic_store_explicit(&array->version, version + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        InsertTrieEntry(array, hash, offset);
+        atomic_store_explicit(&array->version, version + 2, memory_order_release); // 2 next even version
+    }
+    return GetTrieNode(workSpace, offset);
+}
+
+static void SetTrieNodeOps(WorkSpace *workSpace)
+{
+    // readers follow the node format the area was built with
+    if (workSpace->trieType == PARAM_TRIE_ARRAY) {
+        workSpace->findChildNode = FindArrayChildNode;
+        workSpace->addChildNode = AddArrayChildNode;
+    } else {
+        workSpace->findChildNode = FindBstChildNode;
+        workSpace->addChildNode = AddBstChildNode;
     }
-    return AddToSubTrie(workSpace, subTrie, key, keyLen);
 }
 
 ParamTrieNode *AddTrieNode(WorkSpace *workSpace, const char *key, uint32_t keyLen)
@@ -181,7 +344,7 @@ ParamTrieNode *AddTrieNode(WorkSpace *workSpace, const char *key, uint32_t keyLe
     PARAM_CHECK(key != NULL && keyLen > 0, return NULL, "Invalid param ");
     PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return 0, "Invalid workSpace %s", key);
     PARAM_CHECK(workSpace->allocTrieNode != NULL, return NULL, "Invalid param %s", key);
-    PARAM_CHECK(workSpace->compareTrieNode != NULL, return NULL, "Invalid param %s", key);
+    PARAM_CHECK(workSpace->addChildNode != NULL, return NULL, "Invalid param %s", key);
     const char *remainingKey = key;
     ParamTrieNode *current = GetTrieRoot(workSpace);
     PARAM_CHECK(current != NULL, return NULL, "Invalid current param %s", key);
@@ -192,15 +355,7 @@ ParamTrieNode *AddTrieNode(WorkSpace *workSpace, const char *key, uint32_t keyLe
         if (!subKeyLen) {
             return NULL;
         }
-        if (current->child != 0) { // 如果child存在，则检查是否匹配
-            ParamTrieNode *next = GetTrieNode(workSpace, current->child);
-            current = AddToSubTrie(workSpace, next, remainingKey, subKeyLen);
-        } else {
-            uint32_t dataOffset = workSpace->allocTrieNode(workSpace, remainingKey, subKeyLen);
-            PARAM_CHECK(dataOffset != 0, return NULL, "Failed to allocate key %s", key);
-            SaveIndex(&current->child, dataOffset);
-            current = (ParamTrieNode *)GetTrieNode(workSpace, current->child);
-        }
+        current = workSpace->addChildNode(workSpace, current, remainingKey, subKeyLen);
         if (current == NULL) {
             return NULL;
         }
@@ -212,40 +367,23 @@ ParamTrieNode *AddTrieNode(WorkSpace *workSpace, const char *key, uint32_t keyLe
     return current;
 }
 
-static ParamTrieNode *FindSubTrie(const WorkSpace *workSpace,
-    ParamTrieNode *current, const char *key, uint32_t keyLen, uint32_t *matchLabel)
+ParamTrieNode *AddTrieChildNode(WorkSpace *workSpace, ParamTrieNode *parent, const char *key, uint32_t keyLen)
 {
-    if (current == NULL) {
-        return NULL;
-    }
-
-    ParamTrieNode *subTrie = NULL;
-    int ret = workSpace->compareTrieNode(current, key, keyLen);
-    if (ret == 0) {
-        if (matchLabel != NULL && current->labelIndex != 0) { // 有效前缀
-            *matchLabel = current->labelIndex;
-        }
-        return current;
-    }
-    if (ret < 0) {
-        subTrie = (ParamTrieNode *)GetTrieNode(workSpace, current->left);
-        if (subTrie == NULL) {
-            return NULL;
-        }
-    } else {
-        subTrie = (ParamTrieNode *)GetTrieNode(workSpace, current->right);
-        if (subTrie == NULL) {
-            return NULL;
-        }
+    PARAM_CHECK(key != NULL && keyLen > 0, return NULL, "Invalid param ");
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return NULL, "Invalid workSpace %s", key);
+    PARAM_CHECK(workSpace->addChildNode != NULL, return NULL, "Invalid param %s", key);
+    if (parent == NULL) {
+        parent = GetTrieRoot(workSpace);
+        PARAM_CHECK(parent != NULL, return NULL, "Invalid current param %s", key);
     }
-    return FindSubTrie(workSpace, subTrie, key, keyLen, matchLabel);
+    return workSpace->addChildNode(workSpace, parent, key, keyLen);
 }
 
 ParamTrieNode *FindTrieNode(const WorkSpace *workSpace, const char *key, uint32_t keyLen, uint32_t *matchLabel)
 {
     PARAM_CHECK(key != NULL && keyLen > 0, return NULL, "Invalid key ");
     PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return 0, "Invalid workSpace %s", key);
-    PARAM_CHECK(workSpace->allocTrieNode != NULL, return NULL, "Invalid alloc function %s", key);
+    PARAM_CHECK(workSpace->findChildNode != NULL, return NULL, "Invalid find function %s", key);
     PARAM_CHECK(workSpace->compareTrieNode != NULL, return NULL, "Invalid compare function %s", key);
     const char *remainingKey = key;
     ParamTrieNode *current = GetTrieRoot(workSpace);
@@ -264,12 +402,7 @@ ParamTrieNode *FindTrieNode(const WorkSpace *workSpace, const char *key, uint32_
         if (!subKeyLen) {
             return NULL;
         }
-        if (current->child != 0) {
-            ParamTrieNode *next = GetTrieNode(workSpace, current->child);
-            current = FindSubTrie(workSpace, next, remainingKey, subKeyLen, matchLabel);
-        } else {
-            current = FindSubTrie(workSpace, current, remainingKey, subKeyLen, matchLabel);
-        }
+        current = workSpace->findChildNode(workSpace, current, remainingKey, subKeyLen);
         if (current == NULL) {
             return NULL;
         } else if (matchLabel != NULL && current->labelIndex != 0) {
@@ -283,36 +416,439 @@ ParamTrieNode *FindTrieNode(const WorkSpace *workSpace, const char *key, uint32_
     return current;
 }
 
-static int TraversalSubTrieNode(const WorkSpace *workSpace,
-    const ParamTrieNode *current, TraversalTrieNodePtr walkFunc, void *cookie)
+static int PushTrieFrame(ParamTrieCursor *cursor, uint32_t offset, uint32_t index)
 {
-    if (current == NULL) {
+    if (offset == 0) {
         return 0;
     }
-    walkFunc(workSpace, (ParamTrieNode *)current, cookie);
-    TraversalSubTrieNode(workSpace, GetTrieNode(workSpace, current->child), walkFunc, cookie);
-    TraversalSubTrieNode(workSpace, GetTrieNode(workSpace, current->left), walkFunc, cookie);
-    TraversalSubTrieNode(workSpace, GetTrieNode(workSpace, current->right), walkFunc, cookie);
+    PARAM_CHECK(cursor->top < PARAM_TRIE_STACK_MAX, cursor->error = PARAM_CODE_REACHED_MAX;
+        return cursor->error, "Trie is too deep to traversal %s", cursor->workSpace->fileName);
+    cursor->frame[cursor->top].offset = offset;
+    cursor->frame[cursor->top].index = index;
+    cursor->top++;
+    return 0;
+}
+
+int TrieCursorBegin(ParamTrieCursor *cursor, const WorkSpace *workSpace, const ParamTrieNode *root)
+{
+    PARAM_CHECK(cursor != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid cursor");
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
+    cursor->workSpace = workSpace;
+    cursor->area = workSpace->area;
+    cursor->top = 0;
+    cursor->error = 0;
+    if (root == NULL) {
+        root = GetTrieRoot(workSpace);
+    }
+    PARAM_CHECK(root != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid root");
+    // siblings of the root do not belong to the sub trie, and the trie root may live at offset 0
+    cursor->frame[0].offset = (uint32_t)((char *)root - workSpace->area->data);
+    cursor->frame[0].index = PARAM_TRIE_FRAME_ROOT;
+    cursor->top = 1;
     return 0;
 }
 
+ParamTrieNode *TrieCursorNext(ParamTrieCursor *cursor)
+{
+    PARAM_CHECK(cursor != NULL && cursor->workSpace != NULL, return NULL, "Invalid cursor");
+    const WorkSpace *workSpace = cursor->workSpace;
+    PARAM_CHECK(workSpace->area == cursor->area, cursor->error = PARAM_CODE_INVALID_PARAM;
+        return NULL, "Area %s is compacted in traversal", workSpace->fileName);
+    while (cursor->top > 0 && cursor->error == 0) {
+        ParamTrieFrame *frame = &cursor->frame[cursor->top - 1];
+        ParamTrieNode *node = NULL;
+        if (frame->index == PARAM_TRIE_FRAME_NODE || frame->index == PARAM_TRIE_FRAME_ROOT) {
+            cursor->top--;
+            if (frame->index == PARAM_TRIE_FRAME_ROOT) {
+                node = (ParamTrieNode *)(workSpace->area->data + frame->offset);
+            } else {
+                node = GetTrieNode(workSpace, frame->offset);
+            }
+            if (node == NULL) {
+                continue;
+            }
+            if (frame->index == PARAM_TRIE_FRAME_NODE) {
+                PushTrieFrame(cursor, node->right, PARAM_TRIE_FRAME_NODE);
+                PushTrieFrame(cursor, node->left, PARAM_TRIE_FRAME_NODE);
+            }
+        } else {
+            ParamTrieArray *array = (ParamTrieArray *)GetTrieNode(workSpace, frame->offset);
+            if (array == NULL || frame->index >= array->count) {
+                cursor->top--;
+                continue;
+            }
+            node = GetTrieNode(workSpace, array->entry[frame->index++].offset);
+            if (node == NULL) {
+                continue;
+            }
+        }
+        PushTrieFrame(cursor, node->child, (workSpace->trieType == PARAM_TRIE_ARRAY) ? 0 : PARAM_TRIE_FRAME_NODE);
+        return node;
+    }
+    return NULL;
+}
+
+void TrieCursorSkipChild(ParamTrieCursor *cursor, const ParamTrieNode *node)
+{
+    PARAM_CHECK(cursor != NULL && node != NULL, return, "Invalid cursor");
+    // the child of the node returned last is on the top
+    if (node->child != 0 && cursor->top > 0 && cursor->frame[cursor->top - 1].offset == node->child) {
+        cursor->top--;
+    }
+}
+
+void TrieCursorEnd(ParamTrieCursor *cursor)
+{
+    PARAM_CHECK(cursor != NULL, return, "Invalid cursor");
+    cursor->workSpace = NULL;
+    cursor->top = 0;
+}
+
 int TraversalTrieNode(const WorkSpace *workSpace,
     const ParamTrieNode *root, TraversalTrieNodePtr walkFunc, void *cookie)
 {
     PARAM_CHECK(walkFunc != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
     PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return 0, "Invalid workSpace");
-    ParamTrieNode *current = (ParamTrieNode *)root;
-    if (root == NULL) {
-        current = GetTrieRoot(workSpace);
+    ParamTrieCursor cursor;
+    int ret = TrieCursorBegin(&cursor, workSpace, root);
+    PARAM_CHECK(ret == 0, return ret, "Failed to traversal %s", workSpace->fileName);
+    ParamTrieNode *node = TrieCursorNext(&cursor);
+    while (node != NULL) {
+        walkFunc(workSpace, node, cookie);
+        node = TrieCursorNext(&cursor);
     }
-    if (current == NULL) {
+    ret = cursor.error;
+    TrieCursorEnd(&cursor);
+    return ret;
+}
+
+int InitWorkSpace(const char *fileName, WorkSpace *workSpace, int onlyRead)
+{
+    PARAM_CHECK(fileName != NULL, return PARAM_CODE_INVALID_NAME, "Invalid fileName");
+    PARAM_CHECK(workSpace != NULL, return PARAM_CODE_INVALID_NAME, "Invalid workSpace");
+    if (PARAM_LOAD_AREA(workSpace) != NULL) {
         return 0;
     }
-    walkFunc(workSpace, (ParamTrieNode *)current, cookie);
-    TraversalSubTrieNode(workSpace, GetTrieNode(workSpace, current->child), walkFunc, cookie);
-    if (root == NULL) {
-        TraversalSubTrieNode(workSpace, GetTrieNode(workSpace, current->left), walkFunc, cookie);
-        TraversalSubTrieNode(workSpace, GetTrieNode(workSpace, current->right), walkFunc, cookie);
+    workSpace->compareTrieNode = CompareParamTrieNode;
+    workSpace->allocTrieNode = AllocateParamTrieNode;
+    workSpace->spaceSizeMax = PARAM_WORKSPACE_MAX;
+    if (workSpace->trieType == PARAM_TRIE_DEFAULT) {
+        workSpace->trieType = PARAM_TRIE_TYPE_DEF;
+    }
+    int ret = strcpy_s(workSpace->fileName, sizeof(workSpace->fileName), fileName);
+    PARAM_CHECK(ret == 0, return ret, "Failed to copy file name %s", fileName);
+    int openMode;
+    int prot = PROT_READ;
+    if (onlyRead) {
+        openMode = O_RDONLY;
+    } else {
+        openMode = O_CREAT | O_RDWR | O_TRUNC;
+        prot = PROT_READ | PROT_WRITE;
+    }
+    ret = InitWorkSpace_(workSpace, openMode, prot, PARAM_WORKSPACE_DEF, onlyRead);
+    PARAM_CHECK(ret == 0, return ret, "Failed to init workspace  %s", workSpace->fileName);
+    return ret;
+}
+
+void CloseWorkSpace(WorkSpace *workSpace)
+{
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return, "The workspace is null");
+    munmap((char *)workSpace->area, workSpace->spaceSizeMax);
+    workSpace->area = NULL;
+    while (workSpace->retired != NULL) {
+        ParamRetiredArea *retired = workSpace->retired;
+        workSpace->retired = retired->next;
+        munmap((char *)retired->area, workSpace->spaceSizeMax);
+        free(retired);
+    }
+}
+
+static void RetireWorkSpaceArea(WorkSpace *workSpace)
+{
+    // nothing tells when the readers leave the area, it is kept mapped until the workspace is closed
+    ParamRetiredArea *retired = (ParamRetiredArea *)malloc(sizeof(ParamRetiredArea));
+    PARAM_CHECK(retired != NULL, return, "Failed to keep the area of %s, it is left mapped", workSpace->fileName);
+    retired->area = workSpace->area;
+    retired->next = workSpace->retired;
+    workSpace->retired = retired;
+}
+
+int RemapWorkSpace(WorkSpace *workSpace)
+{
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
+    int fd = open(workSpace->fileName, O_RDONLY | O_CLOEXEC);
+    PARAM_CHECK(fd >= 0, return PARAM_CODE_INVALID_NAME, "Open file %s fail error %d", workSpace->fileName, errno);
+    void *areaAddr = (void *)mmap(NULL, workSpace->spaceSizeMax, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    PARAM_CHECK(areaAddr != MAP_FAILED && areaAddr != NULL,
+        return PARAM_CODE_ERROR_MAP_FILE, "Failed to map memory error %d", errno);
+    RetireWorkSpaceArea(workSpace);
+    workSpace->trieType = ((ParamTrieHeader *)areaAddr)->trieType;
+    SetTrieNodeOps(workSpace);
+    PARAM_PUBLISH_AREA(workSpace, (ParamTrieHeader *)areaAddr);
+    PARAM_LOGI("Remap workspace %s epoch %u", workSpace->fileName,
+        atomic_load_explicit(&workSpace->area->epoch, memory_order_relaxed));
+    return 0;
+}
+
+int LoadWorkSpaceImage(WorkSpace *workSpace, const char *image, uint32_t size)
+{
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
+    PARAM_CHECK(image != NULL && size >= sizeof(ParamTrieHeader), return PARAM_CODE_INVALID_PARAM, "Invalid image");
+    const ParamTrieHeader *header = (const ParamTrieHeader *)image;
+    PARAM_CHECK(header->currOffset == size - sizeof(ParamTrieHeader) && header->trieType == workSpace->trieType,
+        return PARAM_CODE_INVALID_PARAM, "Invalid image for %s", workSpace->fileName);
+    uint32_t spaceSize = workSpace->area->dataSize + sizeof(ParamTrieHeader);
+    while (spaceSize < (size + 1)) {
+        spaceSize += PARAM_WORKSPACE_DEF;
+    }
+    PARAM_CHECK(spaceSize <= workSpace->spaceSizeMax, return PARAM_CODE_REACHED_MAX,
+        "Failed to load image of %u to %s, max %u", size, workSpace->fileName, workSpace->spaceSizeMax);
+    if (spaceSize > (workSpace->area->dataSize + sizeof(ParamTrieHeader))) {
+        int ret = truncate(workSpace->fileName, spaceSize);
+        PARAM_CHECK(ret == 0, return PARAM_CODE_REACHED_MAX,
+            "Failed to extend %s to %u error %d", workSpace->fileName, spaceSize, errno);
+    }
+    uint32_t generation = atomic_load_explicit(&workSpace->area->generation, memory_order_relaxed);
+    uint32_t epoch = atomic_load_explicit(&workSpace->area->epoch, memory_order_relaxed);
+    int ret = memcpy_s(workSpace->area, spaceSize, image, size);
+    PARAM_CHECK(ret == EOK, return PARAM_CODE_INVALID_PARAM, "Failed to copy image to %s", workSpace->fileName);
+    workSpace->area->dataSize = spaceSize - sizeof(ParamTrieHeader);
+    atomic_store_explicit(&workSpace->area->replaced, 0, memory_order_relaxed);
+    // nothing resolved in the old area is valid any more
+    atomic_store_explicit(&workSpace->area->epoch, epoch + 1, memory_order_relaxed);
+    atomic_store_explicit(&workSpace->area->generation, generation + 1, memory_order_release);
+    return 0;
+}
+
+static ParamHashTable *GetParamHashTable(const WorkSpace *workSpace)
+{
+    uint32_t offset = atomic_load_explicit(&workSpace->area->hashIndex, memory_order_acquire);
+    return (ParamHashTable *)GetTrieNode(workSpace, offset);
+}
+
+static uint32_t GetParamHash(const char *key, uint32_t keyLen)
+{
+    uint32_t hash = GetTrieKeyHash(key, keyLen);
+    return (hash == 0) ? 1 : hash; // 0 marks an empty slot
+}
+
+static void InsertParamHashEntry(ParamHashTable *table, uint32_t hash, uint32_t dataIndex, uint32_t labelIndex)
+{
+    uint32_t mask = table->capacity - 1;
+    uint32_t index = hash & mask;
+    while (atomic_load_explicit(&table->entry[index].hash, memory_order_relaxed) != 0) {
+        index = (index + 1) & mask;
+    }
+    table->entry[index].dataIndex = dataIndex;
+    atomic_store_explicit(&table->entry[index].labelIndex, labelIndex, memory_order_relaxed);
+    atomic_store_explicit(&table->entry[index].hash, hash, memory_order_release);
+    table->count++;
+}
+
+static uint32_t AllocateParamHashTable(WorkSpace *workSpace, const ParamHashTable *old, uint32_t capacity)
+{
+    uint32_t len = sizeof(ParamHashTable) + capacity * sizeof(ParamHashEntry);
+    PARAM_CHECK(ExtendWorkSpace(workSpace, len) == 0, return 0,
+        "Failed to allocate currOffset %u, dataSize %u", workSpace->area->currOffset, workSpace->area->dataSize);
+    ParamHashTable *table = (ParamHashTable *)(workSpace->area->data + workSpace->area->currOffset);
+    PARAM_CHECK(memset_s(table, len, 0, len) == EOK, return 0, "Failed to clear hash table");
+    table->capacity = capacity;
+    for (uint32_t i = 0; old != NULL && i < old->capacity; i++) {
+        uint32_t hash = atomic_load_explicit(&old->entry[i].hash, memory_order_relaxed);
+        if (hash != 0) {
+            InsertParamHashEntry(table, hash, old->entry[i].dataIndex,
+                atomic_load_explicit(&old->entry[i].labelIndex, memory_order_relaxed));
+        }
+    }
+    uint32_t offset = workSpace->area->currOffset;
+    workSpace->area->currOffset += len;
+    return offset;
+}
+
+int AddParamHashEntry(WorkSpace *workSpace, const char *key, uint32_t keyLen, uint32_t dataIndex)
+{
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
+    PARAM_CHECK(key != NULL && keyLen > 0 && dataIndex != 0, return PARAM_CODE_INVALID_PARAM, "Invalid param");
+    ParamHashTable *table = GetParamHashTable(workSpace);
+    if (table == NULL || (table->count + 1) * 2 > table->capacity) { // 2 keep probe chains short
+        uint32_t capacity = (table == NULL) ? PARAM_HASH_INIT : table->capacity * 2; // 2 double
+        uint32_t offset = AllocateParamHashTable(workSpace, table, capacity);
+        PARAM_CHECK(offset != 0, return PARAM_CODE_REACHED_MAX, "Failed to allocate hash table for %s", key);
+        // readers still probing the old table see a complete copy of it
+        atomic_store_explicit(&workSpace->area->hashIndex, offset, memory_order_release);
+        table = GetParamHashTable(workSpace);
+    }
+    uint32_t labelIndex = 0;
+    FindTrieNode(workSpace, key, keyLen, &labelIndex);
+    InsertParamHashEntry(table, GetParamHash(key, keyLen), dataIndex, labelIndex);
+    return 0;
+}
+
+static ParamHashEntry *FindParamHashSlot(const WorkSpace *workSpace, const char *key, uint32_t keyLen)
+{
+    ParamHashTable *table = GetParamHashTable(workSpace);
+    if (table == NULL) {
+        return NULL;
+    }
+    uint32_t hash = GetParamHash(key, keyLen);
+    uint32_t mask = table->capacity - 1;
+    for (uint32_t i = 0, index = hash & mask; i < table->capacity; i++, index = (index + 1) & mask) {
+        uint32_t current = atomic_load_explicit(&table->entry[index].hash, memory_order_acquire);
+        if (current == 0) {
+            return NULL;
+        }
+        if (current != hash) {
+            continue;
+        }
+        ParamNode *entry = (ParamNode *)GetTrieNode(workSpace, table->entry[index].dataIndex);
+        if (entry != NULL && entry->keyLength == keyLen && strncmp(entry->data, key, keyLen) == 0) {
+            return &table->entry[index];
+        }
+    }
+    return NULL;
+}
+
+int FindParamHashEntry(const WorkSpace *workSpace,
+    const char *key, uint32_t keyLen, uint32_t *dataIndex, uint32_t *labelIndex)
+{
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
+    PARAM_CHECK(key != NULL && dataIndex != NULL && labelIndex != NULL,
+        return PARAM_CODE_INVALID_PARAM, "Invalid param");
+    ParamHashEntry *slot = FindParamHashSlot(workSpace, key, keyLen);
+    if (slot == NULL) {
+        return PARAM_CODE_NOT_FOUND;
+    }
+    *dataIndex = slot->dataIndex;
+    *labelIndex = atomic_load_explicit(&slot->labelIndex, memory_order_relaxed);
+    return 0;
+}
+
+int CheckParamNodeIndex(const WorkSpace *workSpace, uint32_t dataIndex)
+{
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
+    // an offset from an older layout of the area may point into the middle of a node
+    uint32_t currOffset = workSpace->area->currOffset;
+    if (dataIndex == 0 || dataIndex >= currOffset || (currOffset - dataIndex) < sizeof(ParamNode)) {
+        return PARAM_CODE_INVALID_PARAM;
+    }
+    ParamNode *entry = (ParamNode *)GetTrieNode(workSpace, dataIndex);
+    if (entry == NULL || entry->keyLength == 0 || entry->keyLength >= PARAM_NAME_LEN_MAX ||
+        (currOffset - dataIndex - sizeof(ParamNode)) < entry->keyLength) {
+        return PARAM_CODE_INVALID_PARAM;
+    }
+    uint32_t index = 0;
+    uint32_t labelIndex = 0;
+    if (FindParamHashEntry(workSpace, entry->data, entry->keyLength, &index, &labelIndex) != 0) {
+        // not indexed when the hash table could not grow
+        char name[PARAM_NAME_LEN_MAX] = { 0 };
+        PARAM_CHECK(memcpy_s(name, sizeof(name) - 1, entry->data, entry->keyLength) == EOK,
+            return PARAM_CODE_INVALID_PARAM, "Failed to copy name");
+        ParamTrieNode *node = FindTrieNode(workSpace, name, entry->keyLength, &labelIndex);
+        index = (node == NULL) ? 0 : node->dataIndex;
+    }
+    return (index == dataIndex) ? 0 : PARAM_CODE_NOT_FOUND;
+}
+
+int UpdateParamHashLabel(WorkSpace *workSpace, const ParamTrieNode *root, uint32_t labelIndex)
+{
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
+    PARAM_CHECK(root != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid root");
+    if (GetParamHashTable(workSpace) == NULL) {
+        return 0;
+    }
+    ParamTrieCursor cursor;
+    int ret = TrieCursorBegin(&cursor, workSpace, root);
+    PARAM_CHECK(ret == 0, return ret, "Failed to traversal %s", workSpace->fileName);
+    ParamTrieNode *current = TrieCursorNext(&cursor);
+    while (current != NULL) {
+        if (current != root && current->labelIndex != 0) {
+            // a nearer label keeps the parameters below it
+            TrieCursorSkipChild(&cursor, current);
+        } else if (current->dataIndex != 0) {
+            ParamNode *entry = (ParamNode *)GetTrieNode(workSpace, current->dataIndex);
+            ParamHashEntry *slot = (entry == NULL) ? NULL : FindParamHashSlot(workSpace, entry->data, entry->keyLength);
+            if (slot != NULL) {
+                atomic_store_explicit(&slot->labelIndex, labelIndex, memory_order_relaxed);
+            }
+        }
+        current = TrieCursorNext(&cursor);
+    }
+    ret = cursor.error;
+    TrieCursorEnd(&cursor);
+    return ret;
+}
+
+static uint32_t GetParamLabelHash(uid_t uid, gid_t gid, uint16_t mode, const char *label, uint32_t labelLen)
+{
+    uint32_t dac[] = { (uint32_t)uid, (uint32_t)gid, mode };
+    uint32_t hash = GetTrieKeyHash((const char *)dac, sizeof(dac));
+    if (labelLen != 0) {
+        hash = hash * 31 + GetTrieKeyHash(label, labelLen); // 31 mix the label in
+    }
+    return hash;
+}
+
+static ParamLabelTable *GetParamLabelTable(const WorkSpace *workSpace)
+{
+    return (ParamLabelTable *)GetTrieNode(workSpace, workSpace->area->labelTableIndex);
+}
+
+static void InsertParamLabelEntry(ParamLabelTable *table, uint32_t hash, uint32_t offset)
+{
+    uint32_t mask = table->capacity - 1;
+    uint32_t index = hash & mask;
+    while (table->offset[index] != 0) {
+        index = (index + 1) & mask;
+    }
+    table->offset[index] = offset;
+    table->count++;
+}
+
+static int GrowParamLabelTable(WorkSpace *workSpace)
+{
+    const ParamLabelTable *old = GetParamLabelTable(workSpace);
+    if (old != NULL && (old->count + 1) * 2 <= old->capacity) { // 2 keep probe chains short
+        return 0;
+    }
+    uint32_t capacity = (old == NULL) ? PARAM_LABEL_TABLE_INIT : old->capacity * 2; // 2 double
+    uint32_t len = sizeof(ParamLabelTable) + capacity * sizeof(uint32_t);
+    PARAM_CHECK(ExtendWorkSpace(workSpace, len) == 0, return PARAM_CODE_REACHED_MAX,
+        "Failed to allocate currOffset %u, dataSize %u", workSpace->area->currOffset, workSpace->area->dataSize);
+    ParamLabelTable *table = (ParamLabelTable *)(workSpace->area->data + workSpace->area->currOffset);
+    PARAM_CHECK(memset_s(table, len, 0, len) == EOK, return PARAM_CODE_ERROR, "Failed to clear label table");
+    table->capacity = capacity;
+    for (uint32_t i = 0; old != NULL && i < old->capacity; i++) {
+        const ParamSecruityNode *node = (const ParamSecruityNode *)GetTrieNode(workSpace, old->offset[i]);
+        if (node != NULL) {
+            InsertParamLabelEntry(table,
+                GetParamLabelHash(node->uid, node->gid, node->mode, node->data, node->length), old->offset[i]);
+        }
+    }
+    // only the server adds labels, the old table is left as it is
+    workSpace->area->labelTableIndex = workSpace->area->currOffset;
+    workSpace->area->currOffset += len;
+    return 0;
+}
+
+static uint32_t FindParamLabel(const WorkSpace *workSpace, const ParamAuditData *auditData,
+    uint32_t labelLen, uint32_t hash)
+{
+    const ParamLabelTable *table = GetParamLabelTable(workSpace);
+    if (table == NULL) {
+        return 0;
+    }
+    uint32_t mask = table->capacity - 1;
+    for (uint32_t i = 0, index = hash & mask; i < table->capacity; i++, index = (index + 1) & mask) {
+        const ParamSecruityNode *node = (const ParamSecruityNode *)GetTrieNode(workSpace, table->offset[index]);
+        if (node == NULL) {
+            return 0;
+        }
+        if (node->uid == auditData->dacData.uid && node->gid == auditData->dacData.gid &&
+            node->mode == auditData->dacData.mode && node->length == labelLen &&
+            (labelLen == 0 || memcmp(node->data, auditData->label, labelLen) == 0)) {
+            return table->offset[index];
+        }
     }
     return 0;
 }
@@ -322,8 +858,15 @@ uint32_t AddParamSecruityNode(WorkSpace *workSpace, const ParamAuditData *auditD
     PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return 0, "Invalid param");
     PARAM_CHECK(auditData != NULL && auditData->name != NULL, return 0, "Invalid auditData");
     const uint32_t labelLen = (auditData->label == NULL) ? 0 : strlen(auditData->label);
+    uint32_t hash = GetParamLabelHash(auditData->dacData.uid,
+        auditData->dacData.gid, auditData->dacData.mode, auditData->label, labelLen);
+    uint32_t offset = FindParamLabel(workSpace, auditData, labelLen, hash);
+    if (offset != 0) {
+        return offset;
+    }
+    PARAM_CHECK(GrowParamLabelTable(workSpace) == 0, return 0, "Failed to grow label table");
     uint32_t realLen = sizeof(ParamSecruityNode) + PARAM_ALIGN(labelLen + 1);
-    PARAM_CHECK((workSpace->area->currOffset + realLen) < workSpace->area->dataSize, return 0,
+    PARAM_CHECK(ExtendWorkSpace(workSpace, realLen) == 0, return 0,
         "Failed to allocate currOffset %u, dataSize %u datalen %u",
         workSpace->area->currOffset, workSpace->area->dataSize, realLen);
 
@@ -338,34 +881,51 @@ uint32_t AddParamSecruityNode(WorkSpace *workSpace, const ParamAuditData *auditD
         node->data[labelLen] = '\0';
         node->length = labelLen;
     }
-    uint32_t offset = workSpace->area->currOffset;
+    offset = workSpace->area->currOffset;
     workSpace->area->currOffset += realLen;
     workSpace->area->securityNodeCount++;
+    InsertParamLabelEntry(GetParamLabelTable(workSpace), hash, offset);
     return offset;
 }
 
+static uint32_t GetParamValueClassSize(uint32_t sizeClass)
+{
+    uint32_t size = PARAM_VALUE_SIZE_MIN << sizeClass;
+    return (size < PARAM_VALUE_LEN_MAX) ? size : PARAM_VALUE_LEN_MAX;
+}
+
+static uint32_t GetParamValueClass(uint32_t size)
+{
+    uint32_t sizeClass = 0;
+    while ((sizeClass + 1) < PARAM_VALUE_CLASS_MAX && GetParamValueClassSize(sizeClass) < size) {
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
 uint32_t AddParamNode(WorkSpace *workSpace, const char *key, uint32_t keyLen, const char *value, uint32_t valueLen)
 {
     PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return 0, "Invalid param");
     PARAM_CHECK(key != NULL && value != NULL, return 0, "Invalid param");
 
-    uint32_t realLen = sizeof(ParamNode) + 1 + 1;
-    if (valueLen > PARAM_VALUE_LEN_MAX) {
-        realLen += keyLen + valueLen;
-    } else {
-        realLen += keyLen + PARAM_VALUE_LEN_MAX;
+    // reserve the size class of the value only, a longer value is moved to a value slot
+    uint32_t valueSize = valueLen + 1;
+    if (valueLen < PARAM_VALUE_LEN_MAX) {
+        valueSize = GetParamValueClassSize(GetParamValueClass(valueSize));
     }
-    realLen = PARAM_ALIGN(realLen);
-    PARAM_CHECK((workSpace->area->currOffset + realLen) < workSpace->area->dataSize, return 0,
+    uint32_t realLen = PARAM_ALIGN(sizeof(ParamNode) + keyLen + 1 + valueSize);
+    PARAM_CHECK(ExtendWorkSpace(workSpace, realLen) == 0, return 0,
         "Failed to allocate currOffset %u, dataSize %u datalen %u",
         workSpace->area->currOffset, workSpace->area->dataSize, realLen);
 
     ParamNode *node = (ParamNode *)(workSpace->area->data + workSpace->area->currOffset);
     atomic_init(&node->commitId, 0);
-
+    atomic_init(&node->valueIndex, 0);
     node->keyLength = keyLen;
     node->valueLength = valueLen;
-    int ret = sprintf_s(node->data, realLen - 1, "%s=%s", key, value);
+    node->valueSize = realLen - sizeof(ParamNode) - keyLen - 1; // with the padding
+    node->reserved = 0;
+    int ret = sprintf_s(node->data, realLen - sizeof(ParamNode), "%s=%s", key, value);
     PARAM_CHECK(ret > EOK, return 0, "Failed to sprint key and value");
     uint32_t offset = workSpace->area->currOffset;
     workSpace->area->currOffset += realLen;
@@ -373,6 +933,65 @@ uint32_t AddParamNode(WorkSpace *workSpace, const char *key, uint32_t keyLen, co
     return offset;
 }
 
+uint32_t GetParamNodeSize(const WorkSpace *workSpace, const ParamNode *entry)
+{
+    PARAM_CHECK(entry != NULL, return 0, "Invalid param");
+    uint32_t size = PARAM_ALIGN(sizeof(ParamNode) + entry->keyLength + 1 + entry->valueSize);
+    ParamValueNode *node = (ParamValueNode *)GetTrieNode(workSpace,
+        atomic_load_explicit(&entry->valueIndex, memory_order_relaxed));
+    if (node != NULL) {
+        size += PARAM_ALIGN(sizeof(ParamValueNode) + node->size);
+    }
+    return size;
+}
+
+char *GetParamNodeValue(const WorkSpace *workSpace, const ParamNode *entry, uint32_t *size)
+{
+    PARAM_CHECK(entry != NULL && size != NULL, return NULL, "Invalid param");
+    uint32_t valueIndex = atomic_load_explicit(&entry->valueIndex, memory_order_acquire);
+    ParamValueNode *node = (ParamValueNode *)GetTrieNode(workSpace, valueIndex);
+    if (node != NULL) {
+        *size = node->size;
+        return node->data;
+    }
+    *size = entry->valueSize;
+    return (char *)entry->data + entry->keyLength + 1;
+}
+
+uint32_t AllocateParamValue(WorkSpace *workSpace, uint32_t size)
+{
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return 0, "Invalid param");
+    PARAM_CHECK(size <= PARAM_VALUE_LEN_MAX, return 0, "Invalid value size %u", size);
+    uint32_t sizeClass = GetParamValueClass(size);
+    ParamValueNode *node = (ParamValueNode *)GetTrieNode(workSpace, workSpace->area->freeValue[sizeClass]);
+    if (node != NULL) {
+        uint32_t offset = workSpace->area->freeValue[sizeClass];
+        workSpace->area->freeValue[sizeClass] = node->next;
+        node->next = 0;
+        return offset;
+    }
+    uint32_t realLen = PARAM_ALIGN(sizeof(ParamValueNode) + GetParamValueClassSize(sizeClass));
+    PARAM_CHECK(ExtendWorkSpace(workSpace, realLen) == 0, return 0,
+        "Failed to allocate currOffset %u, dataSize %u datalen %u",
+        workSpace->area->currOffset, workSpace->area->dataSize, realLen);
+    node = (ParamValueNode *)(workSpace->area->data + workSpace->area->currOffset);
+    node->next = 0;
+    node->size = GetParamValueClassSize(sizeClass);
+    node->sizeClass = sizeClass;
+    uint32_t offset = workSpace->area->currOffset;
+    workSpace->area->currOffset += realLen;
+    return offset;
+}
+
+void FreeParamValue(WorkSpace *workSpace, uint32_t offset)
+{
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return, "Invalid param");
+    ParamValueNode *node = (ParamValueNode *)GetTrieNode(workSpace, offset);
+    PARAM_CHECK(node != NULL && node->sizeClass < PARAM_VALUE_CLASS_MAX, return, "Invalid value slot %u", offset);
+    node->next = workSpace->area->freeValue[node->sizeClass];
+    workSpace->area->freeValue[node->sizeClass] = offset;
+}
+
 ParamTrieNode *GetTrieNode(const WorkSpace *workSpace, uint32_t offset)
 {
     PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return NULL, "Invalid param");
@@ -387,3 +1006,271 @@ void SaveIndex(uint32_t *index, uint32_t offset)
     PARAM_CHECK(index != NULL, return, "Invalid index");
     *index = offset;
 }
+
+#define PARAM_COMPACT_LEVEL_MAX (PARAM_NAME_LEN_MAX / 2) // 2 a segment and a '.' at least
+#define PARAM_COMPACT_SIBLING_INIT 16
+typedef struct {
+    const WorkSpace *src;
+    WorkSpace dst;
+    char name[PARAM_NAME_LEN_MAX + 1];
+    // the segments of the current name, only the ones with a label or a parameter below are copied
+    uint32_t copied;
+    const ParamTrieNode *path[PARAM_COMPACT_LEVEL_MAX];
+    ParamTrieNode *copy[PARAM_COMPACT_LEVEL_MAX];
+} ParamCompactContext;
+
+static int CopyTriePath(ParamCompactContext *context, uint32_t level)
+{
+    for (uint32_t i = context->copied; i <= level; i++) {
+        context->copy[i] = AddTrieChildNode(&context->dst, context->copy[i - 1],
+            context->path[i]->key, context->path[i]->length);
+        PARAM_CHECK(context->copy[i] != NULL, return PARAM_CODE_REACHED_MAX,
+            "Failed to copy node %s", context->path[i]->key);
+    }
+    context->copied = level + 1;
+    return 0;
+}
+
+static int CopyParamLabel(ParamCompactContext *context, const ParamTrieNode *node, ParamTrieNode *copy)
+{
+    const ParamSecruityNode *label = (const ParamSecruityNode *)GetTrieNode(context->src, node->labelIndex);
+    if (label == NULL) {
+        return 0;
+    }
+    ParamAuditData auditData = {};
+    auditData.name = copy->key;
+    auditData.label = (label->length == 0) ? NULL : label->data;
+    auditData.dacData.uid = label->uid;
+    auditData.dacData.gid = label->gid;
+    auditData.dacData.mode = label->mode;
+    uint32_t offset = AddParamSecruityNode(&context->dst, &auditData);
+    PARAM_CHECK(offset != 0, return PARAM_CODE_REACHED_MAX, "Failed to copy label of %s", copy->key);
+    SaveIndex(&copy->labelIndex, offset);
+    return 0;
+}
+
+static int CopyParamData(ParamCompactContext *context, const ParamNode *entry, ParamTrieNode *copy)
+{
+    PARAM_CHECK(entry->keyLength < sizeof(context->name) &&
+        memcpy_s(context->name, sizeof(context->name), entry->data, entry->keyLength) == EOK,
+        return PARAM_CODE_INVALID_NAME, "Failed to copy name");
+    context->name[entry->keyLength] = '\0';
+    uint32_t size = 0;
+    const char *value = GetParamNodeValue(context->src, entry, &size);
+    uint32_t offset = AddParamNode(&context->dst, context->name, entry->keyLength, value, entry->valueLength);
+    PARAM_CHECK(offset != 0, return PARAM_CODE_REACHED_MAX, "Failed to copy param %s", context->name);
+    // the commit id goes on, so a reader moving to the new area does not see a change
+    ParamNode *node = (ParamNode *)GetTrieNode(&context->dst, offset);
+    uint32_t commitId = atomic_load_explicit(&entry->commitId, memory_order_relaxed);
+    atomic_init(&node->commitId, commitId & ~PARAM_FLAGS_MODIFY);
+    SaveIndex(&copy->dataIndex, offset);
+    return AddParamHashEntry(&context->dst, context->name, entry->keyLength, offset);
+}
+
+static int CopyTrieChildren(ParamCompactContext *context, const ParamTrieNode *parent, uint32_t level);
+
+static int CopyTrieNode(ParamCompactContext *context, const ParamTrieNode *node, uint32_t level)
+{
+    PARAM_CHECK(level < PARAM_COMPACT_LEVEL_MAX, return PARAM_CODE_INVALID_NAME,
+        "Trie is too deep to compact %s", context->src->fileName);
+    context->path[level] = node;
+    context->copied = (context->copied > level) ? level : context->copied;
+    const ParamNode *entry = (const ParamNode *)GetTrieNode(context->src, node->dataIndex);
+    if (entry != NULL && PARAM_NODE_DELETED(entry)) {
+        entry = NULL;
+    }
+    int ret = 0;
+    if (node->labelIndex != 0 || entry != NULL) {
+        ret = CopyTriePath(context, level);
+    }
+    if (ret == 0 && node->labelIndex != 0) {
+        ret = CopyParamLabel(context, node, context->copy[level]);
+    }
+    if (ret == 0 && entry != NULL) {
+        ret = CopyParamData(context, entry, context->copy[level]);
+    }
+    return (ret == 0) ? CopyTrieChildren(context, node, level + 1) : ret;
+}
+
+static int CompareTrieSibling(const void *first, const void *second)
+{
+    const ParamTrieNode *node = *(const ParamTrieNode **)first;
+    const ParamTrieNode *other = *(const ParamTrieNode **)second;
+    return -CompareParamTrieNode(node, other->key, other->length);
+}
+
+static int CopyTrieRange(ParamCompactContext *context, const ParamTrieNode **nodes,
+    uint32_t start, uint32_t end, uint32_t level)
+{
+    if (start >= end) {
+        return 0;
+    }
+    // the middle one first, the siblings come out as a balanced tree
+    uint32_t middle = start + (end - start) / 2; // 2 half
+    int ret = CopyTrieNode(context, nodes[middle], level);
+    PARAM_CHECK(ret == 0, return ret, "Failed to copy node %s", nodes[middle]->key);
+    ret = CopyTrieRange(context, nodes, start, middle, level);
+    return (ret == 0) ? CopyTrieRange(context, nodes, middle + 1, end, level) : ret;
+}
+
+static int CopyTrieSiblings(ParamCompactContext *context, const ParamTrieNode *first, uint32_t level)
+{
+    if (first == NULL) {
+        return 0;
+    }
+    uint32_t capacity = PARAM_COMPACT_SIBLING_INIT;
+    const ParamTrieNode **nodes = (const ParamTrieNode **)malloc(capacity * sizeof(ParamTrieNode *));
+    PARAM_CHECK(nodes != NULL, return PARAM_CODE_ERROR, "Failed to alloc memory for siblings");
+    nodes[0] = first;
+    uint32_t count = 1;
+    // breadth first, the siblings added in order are a long list on one side
+    int ret = 0;
+    for (uint32_t i = 0; ret == 0 && i < count; i++) {
+        const ParamTrieNode *next[] = {
+            GetTrieNode(context->src, nodes[i]->left), GetTrieNode(context->src, nodes[i]->right)
+        };
+        for (size_t j = 0; ret == 0 && j < sizeof(next) / sizeof(next[0]); j++) {
+            if (next[j] == NULL) {
+                continue;
+            }
+            if (count == capacity) {
+                PARAM_CHECK(capacity < context->src->area->trieNodeCount, ret = PARAM_CODE_INVALID_PARAM;
+                    break, "Invalid trie to compact %s", context->src->fileName);
+                capacity *= 2; // 2 double
+                const ParamTrieNode **tmp = (const ParamTrieNode **)realloc(nodes, capacity * sizeof(ParamTrieNode *));
+                PARAM_CHECK(tmp != NULL, ret = PARAM_CODE_ERROR;
+                    break, "Failed to alloc memory for siblings");
+                nodes = tmp;
+            }
+            nodes[count++] = next[j];
+        }
+    }
+    if (ret == 0) {
+        qsort(nodes, count, sizeof(ParamTrieNode *), CompareTrieSibling);
+        ret = CopyTrieRange(context, nodes, 0, count, level);
+    }
+    free(nodes);
+    return ret;
+}
+
+static int CopyTrieChildren(ParamCompactContext *context, const ParamTrieNode *parent, uint32_t level)
+{
+    if (context->src->trieType != PARAM_TRIE_ARRAY) {
+        return CopyTrieSiblings(context, GetTrieNode(context->src, parent->child), level);
+    }
+    const ParamTrieArray *array = (const ParamTrieArray *)GetTrieNode(context->src, parent->child);
+    for (uint32_t i = 0; array != NULL && i < array->count; i++) {
+        const ParamTrieNode *node = GetTrieNode(context->src, array->entry[i].offset);
+        int ret = (node == NULL) ? 0 : CopyTrieNode(context, node, level);
+        PARAM_CHECK(ret == 0, return ret, "Failed to copy node %s", node->key);
+    }
+    return 0;
+}
+
+static int CopyWorkSpace(ParamCompactContext *context)
+{
+    const ParamTrieHeader *area = context->src->area;
+    ParamTrieHeader *copy = context->dst.area;
+    if (area->paramNodeCount > 0) {
+        uint32_t capacity = PARAM_HASH_INIT;
+        while (capacity < (area->paramNodeCount + 1) * 2) { // 2 at most half used
+            capacity *= 2; // 2 double
+        }
+        uint32_t offset = AllocateParamHashTable(&context->dst, NULL, capacity);
+        PARAM_CHECK(offset != 0, return PARAM_CODE_REACHED_MAX, "Failed to allocate hash table");
+        atomic_store_explicit(&copy->hashIndex, offset, memory_order_relaxed);
+    }
+    const ParamTrieNode *root = GetTrieRoot(context->src);
+    PARAM_CHECK(root != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid root");
+    context->path[0] = root;
+    context->copy[0] = GetTrieRoot(&context->dst);
+    context->copied = 1;
+    int ret = CopyParamLabel(context, root, context->copy[0]);
+    PARAM_CHECK(ret == 0, return ret, "Failed to copy root label");
+    ret = CopyTrieChildren(context, root, 1);
+    PARAM_CHECK(ret == 0, return ret, "Failed to copy trie");
+
+    // a client caches results with the generation of the old area, it is 1 more when the old one is released
+    atomic_store_explicit(&copy->generation,
+        atomic_load_explicit(&area->generation, memory_order_relaxed) + 2, memory_order_relaxed); // 2 skip
+    atomic_store_explicit(&copy->epoch, atomic_load_explicit(&area->epoch, memory_order_relaxed) + 1,
+        memory_order_relaxed);
+    atomic_store_explicit(&copy->serial, atomic_load_explicit(&area->serial, memory_order_relaxed) + 1,
+        memory_order_relaxed);
+    atomic_store_explicit(&copy->changeSerial, atomic_load_explicit(&area->changeSerial, memory_order_relaxed) + 1,
+        memory_order_relaxed);
+    for (uint32_t i = 0; i < PARAM_PREFIX_SERIAL_MAX; i++) {
+        atomic_store_explicit(&copy->prefixSerial[i],
+            atomic_load_explicit(&area->prefixSerial[i], memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+    return 0;
+}
+
+static int WakeParamNode(const WorkSpace *workSpace, const ParamTrieNode *node, void *cookie)
+{
+    UNUSED(cookie);
+    ParamNode *entry = (ParamNode *)GetTrieNode(workSpace, node->dataIndex);
+    if (entry != NULL) {
+        uint32_t commitId = atomic_load_explicit(&entry->commitId, memory_order_relaxed);
+        uint32_t flags = commitId & ~PARAM_FLAGS_COMMITID;
+        atomic_store_explicit(&entry->commitId, ((commitId + 1) & PARAM_FLAGS_COMMITID) | flags, memory_order_release);
+        futex_wake(&entry->commitId, INT_MAX);
+    }
+    return 0;
+}
+
+static void ReleaseWorkSpaceArea(WorkSpace *workSpace)
+{
+    ParamTrieHeader *area = workSpace->area;
+    // clients map the file again when they see it, nothing resolved in the old area matches the new one
+    atomic_store_explicit(&area->replaced, 1, memory_order_release);
+    atomic_fetch_add_explicit(&area->generation, 1, memory_order_release);
+    atomic_uint *serials[PARAM_PREFIX_SERIAL_MAX + 2] = { &area->serial, &area->changeSerial }; // 2 serials
+    for (uint32_t i = 0; i < PARAM_PREFIX_SERIAL_MAX; i++) {
+        serials[i + 2] = &area->prefixSerial[i]; // 2 after serials
+    }
+    for (uint32_t i = 0; i < PARAM_PREFIX_SERIAL_MAX + 2; i++) { // 2 serials
+        atomic_fetch_add_explicit(serials[i], 1, memory_order_release);
+        futex_wake(serials[i], INT_MAX);
+    }
+    (void)TraversalTrieNode(workSpace, NULL, WakeParamNode, NULL);
+}
+
+int CompactWorkSpace(WorkSpace *workSpace)
+{
+    PARAM_CHECK(workSpace != NULL && workSpace->area != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
+    ParamCompactContext *context = (ParamCompactContext *)calloc(1, sizeof(ParamCompactContext));
+    PARAM_CHECK(context != NULL, return PARAM_CODE_ERROR, "Failed to alloc memory for compact");
+    char fileName[FILENAME_LEN_MAX + 1] = { 0 };
+    int ret = sprintf_s(fileName, sizeof(fileName), "%s.tmp", workSpace->fileName);
+    PARAM_CHECK(ret > 0, free(context);
+        return PARAM_CODE_INVALID_NAME, "Failed to format file name %s", workSpace->fileName);
+    context->src = workSpace;
+    context->dst.trieType = workSpace->trieType;
+    ret = InitWorkSpace(fileName, &context->dst, 0);
+    if (ret == 0) {
+        ret = CopyWorkSpace(context);
+    }
+    // the old file keeps its inode for the clients which have not moved yet
+    if (ret == 0 && rename(fileName, workSpace->fileName) != 0) {
+        PARAM_LOGE("Failed to rename %s error %d", fileName, errno);
+        ret = PARAM_CODE_ERROR;
+    }
+    if (ret != 0) {
+        if (context->dst.area != NULL) {
+            CloseWorkSpace(&context->dst);
+        }
+        unlink(fileName);
+        free(context);
+        PARAM_LOGE("Failed to compact workspace %s", workSpace->fileName);
+        return ret;
+    }
+    uint32_t size = workSpace->area->currOffset;
+    ReleaseWorkSpaceArea(workSpace);
+    RetireWorkSpaceArea(workSpace);
+    PARAM_PUBLISH_AREA(workSpace, context->dst.area);
+    free(context);
+    PARAM_LOGI("Compact workspace %s size %u -> %u epoch %u", workSpace->fileName, size, workSpace->area->currOffset,
+        atomic_load_explicit(&workSpace->area->epoch, memory_order_relaxed));
+    return 0;
+}
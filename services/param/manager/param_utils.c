@@ -19,13 +19,40 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <pwd.h>
+#include <stdatomic.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "init_utils.h"
+
+#define PARAM_FILE_COUNT_INIT 8
+#define SEC_TO_US 1000000
+#define NS_TO_US 1000
+
+typedef struct {
+    char *fileName;
+    char *data;
+    uint32_t dataSize;
+    uint32_t mapSize;
+    ParamFileLine *lines;
+    uint32_t lineCount;
+    long cost;
+} ParamFileData;
+
+typedef struct {
+    const ParamFileLoader *loader;
+    ParamFileData *files;
+    uint32_t fileCount;
+    uint32_t fileSize;
+    atomic_uint next;
+} ParamFileTask;
+
 void CheckAndCreateDir(const char *fileName)
 {
     if (fileName == NULL || *fileName == '\0') {
@@ -98,4 +125,223 @@ int GetSubStringInfo(const char *buff, uint32_t buffLen, char delimiter, SubStri
         curr++;
     }
     return curr;
+}
+
+static long GetElapsedTime(const struct timespec *start)
+{
+    struct timespec end = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * SEC_TO_US + (end.tv_nsec - start->tv_nsec) / NS_TO_US;
+}
+
+static int MapParamFile(ParamFileData *file)
+{
+    int fd = open(file->fileName, O_RDONLY | O_CLOEXEC);
+    PARAM_CHECK(fd >= 0, return -1, "Open file %s fail", file->fileName);
+    struct stat st = {};
+    uint32_t pageSize = (uint32_t)sysconf(_SC_PAGESIZE);
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size >= (off_t)(UINT32_MAX - pageSize)) {
+        close(fd);
+        return -1;
+    }
+    // a page without the file follows, so the last line is terminated in place like the others
+    uint32_t mapSize = (uint32_t)st.st_size + pageSize;
+    char *data = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data != MAP_FAILED &&
+        mmap(data, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(data, mapSize);
+        data = MAP_FAILED;
+    }
+    close(fd);
+    PARAM_CHECK(data != MAP_FAILED, return -1, "Failed to map %s error %d", file->fileName, errno);
+    file->data = data;
+    file->dataSize = (uint32_t)st.st_size;
+    file->mapSize = mapSize;
+    return 0;
+}
+
+// split like GetSubStringInfo, but the fields are terminated in the line instead of copied
+static uint32_t SplitParamFileLine(char *line, const char *end, char delimiter, char *fields[], uint32_t count)
+{
+    uint32_t fieldCount = 0;
+    char *curr = line;
+    while (fieldCount < count) {
+        while (curr < end && isspace((unsigned char)*curr)) {
+            curr++;
+        }
+        if (curr >= end || (fieldCount == 0 && *curr == '#')) {
+            break;
+        }
+        char *start = curr++;
+        while (curr < end && *curr != delimiter) {
+            curr++;
+        }
+        char *tail = curr;
+        while (tail > start && isspace((unsigned char)*(tail - 1))) {
+            tail--;
+        }
+        curr = (curr < end) ? (curr + 1) : curr;
+        *tail = '\0';
+        fields[fieldCount++] = start;
+    }
+    return fieldCount;
+}
+
+static void ParseParamFile(const ParamFileLoader *loader, ParamFileData *file, uint32_t fileIndex)
+{
+    struct timespec start = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (MapParamFile(file) != 0) {
+        return;
+    }
+    char *fileEnd = file->data + file->dataSize;
+    uint32_t maxLines = 1;
+    for (char *curr = memchr(file->data, '\n', file->dataSize); curr != NULL;
+        curr = memchr(curr + 1, '\n', fileEnd - curr - 1)) {
+        maxLines++;
+    }
+    file->lines = (ParamFileLine *)calloc(maxLines, sizeof(ParamFileLine));
+    PARAM_CHECK(file->lines != NULL, return, "Failed to alloc memory for %s", file->fileName);
+
+    char *line = file->data;
+    for (uint32_t lineIndex = 0; line < fileEnd; lineIndex++) {
+        char *lineEnd = memchr(line, '\n', fileEnd - line);
+        lineEnd = (lineEnd == NULL) ? fileEnd : lineEnd;
+        ParamFileLine *curr = &file->lines[file->lineCount];
+        if (SplitParamFileLine(line, lineEnd, loader->delimiter, curr->fields, loader->fieldCount) ==
+            loader->fieldCount) {
+            curr->fileIndex = fileIndex;
+            curr->lineIndex = lineIndex;
+            if (loader->checkLine == NULL || loader->checkLine(curr, loader->context) == 0) {
+                file->lineCount++;
+            }
+        }
+        line = lineEnd + 1;
+    }
+    file->cost = GetElapsedTime(&start);
+}
+
+static void *ParamFileWorker(void *context)
+{
+    ParamFileTask *task = (ParamFileTask *)context;
+    uint32_t index = atomic_fetch_add(&task->next, 1);
+    while (index < task->fileCount) {
+        ParseParamFile(task->loader, &task->files[index], index);
+        index = atomic_fetch_add(&task->next, 1);
+    }
+    return NULL;
+}
+
+static void RunParamFileWorkers(ParamFileTask *task)
+{
+    pthread_t workers[PARAM_LOAD_WORKER_MAX - 1];
+    uint32_t count = 0;
+    // the caller parses files too, so no thread is created for a single file
+    while (count < (PARAM_LOAD_WORKER_MAX - 1) && (count + 1) < task->fileCount) {
+        if (pthread_create(&workers[count], NULL, ParamFileWorker, task) != 0) {
+            break;
+        }
+        count++;
+    }
+    (void)ParamFileWorker(task);
+    for (uint32_t i = 0; i < count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
+
+static int CompareParamFileLine(const void *first, const void *second)
+{
+    const ParamFileLine *line1 = (const ParamFileLine *)first;
+    const ParamFileLine *line2 = (const ParamFileLine *)second;
+    int ret = strcmp(line1->fields[0], line2->fields[0]);
+    if (ret != 0) {
+        return ret;
+    }
+    if (line1->fileIndex != line2->fileIndex) {
+        return (line1->fileIndex < line2->fileIndex) ? -1 : 1;
+    }
+    if (line1->lineIndex != line2->lineIndex) {
+        return (line1->lineIndex < line2->lineIndex) ? -1 : 1;
+    }
+    return 0;
+}
+
+static int LoadParamFileLines(const ParamFileTask *task)
+{
+    struct timespec start = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < task->fileCount; i++) {
+        PARAM_LOGI("Parse %s lines %u in %ld us", task->files[i].fileName, task->files[i].lineCount,
+            task->files[i].cost);
+        count += task->files[i].lineCount;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    ParamFileLine *lines = (ParamFileLine *)malloc(count * sizeof(ParamFileLine));
+    PARAM_CHECK(lines != NULL, return -1, "Failed to alloc memory for %u lines", count);
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < task->fileCount; i++) {
+        if (task->files[i].lineCount == 0) {
+            continue;
+        }
+        (void)memcpy_s(lines + offset, (count - offset) * sizeof(ParamFileLine),
+            task->files[i].lines, task->files[i].lineCount * sizeof(ParamFileLine));
+        offset += task->files[i].lineCount;
+    }
+    qsort(lines, count, sizeof(ParamFileLine), CompareParamFileLine);
+    int ret = task->loader->loadLines(lines, count, task->loader->context);
+    free(lines);
+    PARAM_LOGI("Load lines %u of %u files in %ld us", count, task->fileCount, GetElapsedTime(&start));
+    return ret;
+}
+
+static int AddParamFileName(const char *fileName, void *context)
+{
+    ParamFileTask *task = (ParamFileTask *)context;
+    if (task->fileCount >= task->fileSize) {
+        uint32_t fileSize = (task->fileSize == 0) ? PARAM_FILE_COUNT_INIT : task->fileSize * 2; // 2 double the size
+        ParamFileData *files = (ParamFileData *)realloc(task->files, fileSize * sizeof(ParamFileData));
+        PARAM_CHECK(files != NULL, return -1, "Failed to alloc memory for %s", fileName);
+        task->files = files;
+        task->fileSize = fileSize;
+    }
+    ParamFileData *file = &task->files[task->fileCount];
+    (void)memset_s(file, sizeof(ParamFileData), 0, sizeof(ParamFileData));
+    file->fileName = strdup(fileName);
+    PARAM_CHECK(file->fileName != NULL, return -1, "Failed to alloc memory for %s", fileName);
+    task->fileCount++;
+    return 0;
+}
+
+int LoadParamFiles(const char *path, const ParamFileLoader *loader)
+{
+    PARAM_CHECK(path != NULL && loader != NULL && loader->loadLines != NULL, return -1, "Invalid param");
+    PARAM_CHECK(loader->fieldCount > 0 && loader->fieldCount <= PARAM_FILE_FIELD_MAX,
+        return -1, "Invalid field count %u", loader->fieldCount);
+    ParamFileTask task = {};
+    task.loader = loader;
+    atomic_init(&task.next, 0);
+    int ret = 0;
+    struct stat st = {};
+    if ((stat(path, &st) == 0) && !S_ISDIR(st.st_mode)) {
+        ret = AddParamFileName(path, &task);
+    } else {
+        ret = ReadFileInDir(path, loader->ext, AddParamFileName, &task);
+    }
+    if (ret == 0 && task.fileCount > 0) {
+        // files are mapped and split in parallel, the lines are loaded by the caller in key order
+        RunParamFileWorkers(&task);
+        ret = LoadParamFileLines(&task);
+    }
+    for (uint32_t i = 0; i < task.fileCount; i++) {
+        if (task.files[i].data != NULL) {
+            munmap(task.files[i].data, task.files[i].mapSize);
+        }
+        free(task.files[i].lines);
+        free(task.files[i].fileName);
+    }
+    free(task.files);
+    return ret;
 }
\ No newline at end of file
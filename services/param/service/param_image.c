@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "init_utils.h"
+#include "param_manager.h"
+#include "param_service.h"
+#include "param_trie.h"
+
+#define PARAM_IMAGE_MAGIC 0x474d4950 // "PIMG"
+#define PARAM_IMAGE_VERSION 4 // changed with the layout of this header, the trie, parameter and label nodes
+#define PARAM_IMAGE_PATH_MAX 1024
+// the labels in the areas are only checked by the backend they are built for
+#ifdef PARAM_SUPPORT_SELINUX
+#define PARAM_IMAGE_SECURITY 2 // selinux
+#else
+#define PARAM_IMAGE_SECURITY 1 // dac
+#endif
+
+// the image file: this header, the loaded paths separated by '\0', then the areas one by one
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t trieType;
+    uint32_t security;
+    uint32_t stamp; // names, sizes and contents of the parameter files, passwd and group
+    uint32_t checksum; // of the paths and the areas
+    uint32_t pathSize;
+    uint32_t areaSize[PARAM_AREA_MAX];
+    char data[0];
+} ParamImageHeader;
+
+static uint32_t GetParamFileStamp(const char *fileName)
+{
+    int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || st.st_size > UINT32_MAX) {
+        close(fd);
+        return 0;
+    }
+    // the contents, an edit keeping the size changes the stamp too
+    uint32_t contents = 0;
+    if (st.st_size > 0) {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            contents = GetTrieKeyHash((const char *)data, (uint32_t)st.st_size);
+            munmap(data, (size_t)st.st_size);
+        }
+    }
+    close(fd);
+    // the files are laid out under another root when the image is built, only the base name is kept
+    const char *baseName = strrchr(fileName, '/');
+    baseName = (baseName == NULL) ? fileName : baseName + 1;
+    return (GetTrieKeyHash(baseName, strlen(baseName)) ^ (uint32_t)st.st_size) * 31 + contents; // 31 mix the contents
+}
+
+static int AddParamFileStamp(const char *fileName, void *context)
+{
+    // only the .para and .para.dac files are loaded, the image may be put in the same directory
+    const char *baseName = strrchr(fileName, '/');
+    if (strstr((baseName == NULL) ? fileName : baseName, ".para") == NULL) {
+        return 0;
+    }
+    // the order of readdir differs between file systems
+    *(uint32_t *)context += GetParamFileStamp(fileName);
+    return 0;
+}
+
+static uint32_t GetParamImageStamp(const char *paths, uint32_t pathSize)
+{
+    uint32_t stamp = GetParamFileStamp(USER_FILE_PATH) + GetParamFileStamp(GROUP_FILE_PATH);
+    for (uint32_t offset = 0; offset < pathSize; offset += strlen(paths + offset) + 1) {
+        const char *path = paths + offset;
+        struct stat st = {};
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            (void)ReadFileInDir(path, NULL, AddParamFileStamp, &stamp);
+        } else {
+            stamp += GetParamFileStamp(path);
+        }
+    }
+    return stamp;
+}
+
+static uint32_t GetParamImageChecksum(const char *paths, uint32_t pathSize, const char *areas[], const uint32_t sizes[])
+{
+    uint32_t checksum = GetTrieKeyHash(paths, pathSize);
+    for (uint32_t i = 0; i < PARAM_AREA_MAX; i++) {
+        checksum = checksum * 31 + GetTrieKeyHash(areas[i], sizes[i]); // 31 mix the areas in order
+    }
+    return checksum;
+}
+
+// the paths under root, or as they are when root is NULL
+static int FormatParamImagePaths(char *data, uint32_t *size, const char *root, const char *paths[], uint32_t count)
+{
+    *size = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        PARAM_CHECK(paths[i] != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid path %u", i);
+        const char *separator = (root != NULL && paths[i][0] != '/') ? "/" : "";
+        int ret = sprintf_s(data + *size, PARAM_IMAGE_PATH_MAX - *size, "%s%s%s",
+            (root == NULL) ? "" : root, separator, paths[i]);
+        PARAM_CHECK(ret > 0 && (*size + ret + 1) < PARAM_IMAGE_PATH_MAX,
+            return PARAM_CODE_INVALID_PARAM, "Failed to add path %s", paths[i]);
+        *size += (uint32_t)ret + 1;
+    }
+    return 0;
+}
+
+static int WriteParamImage(FILE *fp, const ParamWorkSpace *workSpace,
+    const char *root, const char *paths[], uint32_t count, char *data)
+{
+    ParamImageHeader header = {};
+    header.magic = PARAM_IMAGE_MAGIC;
+    header.version = PARAM_IMAGE_VERSION;
+    header.headerSize = sizeof(ParamTrieHeader);
+    header.trieType = workSpace->paramSpace.trieType;
+    header.security = PARAM_IMAGE_SECURITY;
+    // stamp the files where they are read now, and keep the paths on the target
+    int ret = FormatParamImagePaths(data, &header.pathSize, root, paths, count);
+    PARAM_CHECK(ret == 0, return ret, "Failed to format paths");
+    header.stamp = GetParamImageStamp(data, header.pathSize);
+    ret = FormatParamImagePaths(data, &header.pathSize, "", paths, count);
+    PARAM_CHECK(ret == 0, return ret, "Failed to format paths");
+
+    const char *areas[PARAM_AREA_MAX] = { NULL };
+    for (uint32_t i = 0; i < PARAM_AREA_MAX; i++) {
+        WorkSpace *space = GetWorkSpaceByIndex(workSpace, i);
+        PARAM_CHECK(space != NULL && space->area != NULL, return PARAM_CODE_NOT_INIT, "Invalid area %u", i);
+        areas[i] = (const char *)space->area;
+        header.areaSize[i] = sizeof(ParamTrieHeader) + space->area->currOffset;
+    }
+    header.checksum = GetParamImageChecksum(data, header.pathSize, areas, header.areaSize);
+    PARAM_CHECK(fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(data, header.pathSize, 1, fp) == 1,
+        return -1, "Failed to write image header");
+    for (uint32_t i = 0; i < PARAM_AREA_MAX; i++) {
+        PARAM_CHECK(fwrite(areas[i], header.areaSize[i], 1, fp) == 1, return -1, "Failed to write area %u", i);
+    }
+    return 0;
+}
+
+int SaveParamImageAreas(const ParamWorkSpace *workSpace,
+    const char *fileName, const char *root, const char *paths[], uint32_t count)
+{
+    PARAM_CHECK(workSpace != NULL && fileName != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
+    PARAM_CHECK(paths != NULL && count > 0, return PARAM_CODE_INVALID_PARAM, "Invalid paths");
+    char *data = (char *)calloc(1, PARAM_IMAGE_PATH_MAX);
+    PARAM_CHECK(data != NULL, return -1, "Failed to alloc memory for image");
+    FILE *fp = fopen(fileName, "w");
+    PARAM_CHECK(fp != NULL, free(data);
+        return -1, "Failed to open %s error %d", fileName, errno);
+    int ret = WriteParamImage(fp, workSpace, root, paths, count, data);
+    free(data);
+    if (fclose(fp) != 0) {
+        ret = -1;
+    }
+    PARAM_CHECK(ret == 0, unlink(fileName);
+        return -1, "Failed to save parameter image %s", fileName);
+    PARAM_LOGI("Save parameter image %s", fileName);
+    return 0;
+}
+
+static int CheckParamImage(const ParamImageHeader *header, uint32_t size, uint32_t trieType)
+{
+    PARAM_CHECK(size > sizeof(ParamImageHeader) && header->magic == PARAM_IMAGE_MAGIC &&
+        header->version == PARAM_IMAGE_VERSION && header->headerSize == sizeof(ParamTrieHeader) &&
+        header->trieType == trieType && header->security == PARAM_IMAGE_SECURITY,
+        return PARAM_CODE_INVALID_PARAM, "Invalid parameter image");
+    uint32_t dataSize = header->pathSize;
+    for (uint32_t i = 0; i < PARAM_AREA_MAX; i++) {
+        PARAM_CHECK(header->areaSize[i] <= (size - sizeof(ParamImageHeader)),
+            return PARAM_CODE_INVALID_PARAM, "Invalid area size %u", header->areaSize[i]);
+        dataSize += header->areaSize[i];
+    }
+    PARAM_CHECK(header->pathSize > 0 && header->pathSize < PARAM_IMAGE_PATH_MAX &&
+        dataSize == (size - sizeof(ParamImageHeader)) && header->data[header->pathSize - 1] == '\0',
+        return PARAM_CODE_INVALID_PARAM, "Invalid parameter image size %u", size);
+    const char *areas[PARAM_AREA_MAX] = { NULL };
+    uint32_t offset = header->pathSize;
+    for (uint32_t i = 0; i < PARAM_AREA_MAX; i++) {
+        areas[i] = header->data + offset;
+        offset += header->areaSize[i];
+    }
+    PARAM_CHECK(GetParamImageChecksum(header->data, header->pathSize, areas, header->areaSize) == header->checksum,
+        return PARAM_CODE_INVALID_PARAM, "Invalid parameter image checksum");
+    // the parameter files are changed after the image is built
+    PARAM_CHECK(GetParamImageStamp(header->data, header->pathSize) == header->stamp,
+        return PARAM_CODE_NOT_FOUND, "Parameter image is out of date");
+    return 0;
+}
+
+int LoadParamImageAreas(ParamWorkSpace *workSpace, const char *fileName)
+{
+    PARAM_CHECK(workSpace != NULL && fileName != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
+    int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return PARAM_CODE_NOT_FOUND;
+    }
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || st.st_size <= (off_t)sizeof(ParamImageHeader) || st.st_size > UINT32_MAX) {
+        close(fd);
+        return PARAM_CODE_INVALID_PARAM;
+    }
+    uint32_t size = (uint32_t)st.st_size;
+    void *image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    PARAM_CHECK(image != MAP_FAILED, return PARAM_CODE_ERROR_MAP_FILE, "Failed to map %s error %d", fileName, errno);
+
+    const ParamImageHeader *header = (const ParamImageHeader *)image;
+    int ret = CheckParamImage(header, size, workSpace->paramSpace.trieType);
+    uint32_t offset = header->pathSize;
+    for (uint32_t i = 0; ret == 0 && i < PARAM_AREA_MAX; i++) {
+        WorkSpace *space = GetWorkSpaceByIndex(workSpace, i);
+        PARAM_CHECK(space != NULL, ret = PARAM_CODE_NOT_INIT;
+            break, "Invalid area %u", i);
+        ret = LoadWorkSpaceImage(space, header->data + offset, header->areaSize[i]);
+        offset += header->areaSize[i];
+    }
+    munmap(image, size);
+    PARAM_CHECK(ret == 0, return ret, "Failed to load parameter image %s", fileName);
+    PARAM_LOGI("Load parameter image %s", fileName);
+    return 0;
+}
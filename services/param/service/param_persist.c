@@ -24,44 +24,42 @@
 #include "param_trie.h"
 #include "sys_param.h"
 
-static ParamPersistWorkSpace g_persistWorkSpace = { 0, NULL, 0, { NULL, NULL, NULL, NULL, NULL } };
+static ParamPersistWorkSpace g_persistWorkSpace = { 0, NULL, 0, { NULL, NULL, NULL, NULL, NULL, NULL } };
 
 static int AddPersistParam(const char *name, const char *value, void *context)
 {
     PARAM_CHECK(value != NULL && name != NULL && context != NULL,
         return PARAM_CODE_INVALID_PARAM, "Invalid name or context");
-    WorkSpace *workSpace = (WorkSpace *)context;
+    WorkSpace *workSpace = GetWorkSpace((ParamWorkSpace *)context, name);
+    PARAM_CHECK(workSpace != NULL, return PARAM_CODE_NOT_INIT, "Invalid workspace for %s", name);
     uint32_t dataIndex = 0;
     int ret = WriteParam(workSpace, name, value, &dataIndex, 0);
     PARAM_CHECK(ret == 0, return ret, "Failed to write param %d name:%s %s", ret, name, value);
     return 0;
 }
 
-static int SavePersistParam(const WorkSpace *workSpace, const ParamTrieNode *node, void *cookie)
+static int SavePersistParam(const ParamWorkSpace *paramSpace, ParamHandle handle, PERSIST_SAVE_HANDLE saveHandle)
 {
-    ParamTrieNode *current = (ParamTrieNode *)node;
-    if (current == NULL || current->dataIndex == 0) {
-        return 0;
-    }
-    ParamNode *entry = (ParamNode *)GetTrieNode(workSpace, current->dataIndex);
-    if (entry == NULL) {
-        return 0;
-    }
-    if (strncmp(entry->data, PARAM_PERSIST_PREFIX, strlen(PARAM_PERSIST_PREFIX)) != 0) {
+    static char name[PARAM_NAME_LEN_MAX] = { 0 };
+    static char value[PARAM_VALUE_LEN_MAX] = { 0 };
+    int ret = ReadParamName(paramSpace, handle, name, sizeof(name));
+    PARAM_CHECK(ret == 0, return -1, "Failed to read param name %u", handle);
+    if (strncmp(name, PARAM_PERSIST_PREFIX, strlen(PARAM_PERSIST_PREFIX)) != 0) {
         return 0;
     }
-    static char name[PARAM_NAME_LEN_MAX] = { 0 };
-    int ret = memcpy_s(name, PARAM_NAME_LEN_MAX - 1, entry->data, entry->keyLength);
-    PARAM_CHECK(ret == EOK, return -1, "Failed to read param name %s", entry->data);
-    name[entry->keyLength] = '\0';
-    ret = g_persistWorkSpace.persistParamOps.batchSave(cookie, name, entry->data + entry->keyLength + 1);
-    PARAM_CHECK(ret == 0, return -1, "Failed to write param %s", current->key);
+    uint32_t valueLen = sizeof(value);
+    ret = ReadParamValue(paramSpace, handle, value, &valueLen);
+    PARAM_CHECK(ret == 0, return -1, "Failed to read param value %s", name);
+    ret = g_persistWorkSpace.persistParamOps.batchSave(saveHandle, name, value);
+    PARAM_CHECK(ret == 0, return -1, "Failed to write param %s", name);
     return ret;
 }
 
-static int BatchSavePersistParam(const WorkSpace *workSpace)
+static int BatchSavePersistParam(const ParamWorkSpace *paramSpace)
 {
     PARAM_LOGD("BatchSavePersistParam");
+    WorkSpace *workSpace = GetWorkSpace(paramSpace, PARAM_PERSIST_PREFIX);
+    PARAM_CHECK(workSpace != NULL, return PARAM_CODE_NOT_INIT, "Invalid persist workspace");
     if (g_persistWorkSpace.persistParamOps.batchSaveBegin == NULL ||
         g_persistWorkSpace.persistParamOps.batchSave == NULL ||
         g_persistWorkSpace.persistParamOps.batchSaveEnd == NULL) {
@@ -71,9 +69,15 @@ static int BatchSavePersistParam(const WorkSpace *workSpace)
     PERSIST_SAVE_HANDLE handle;
     int ret = g_persistWorkSpace.persistParamOps.batchSaveBegin(&handle);
     PARAM_CHECK(ret == 0, return PARAM_CODE_INVALID_NAME, "Failed to save persist");
-    ParamTrieNode *root = FindTrieNode(workSpace, PARAM_PERSIST_PREFIX, strlen(PARAM_PERSIST_PREFIX), NULL);
-    ret = TraversalTrieNode(workSpace, root, SavePersistParam, handle);
-    g_persistWorkSpace.persistParamOps.batchSaveEnd(handle);
+    ParamCursor cursor;
+    ret = ParamCursorBegin(&cursor, paramSpace, PARAM_PERSIST_PREFIX);
+    ParamHandle paramHandle = 0;
+    while (ret == 0 && (ret = ParamCursorNext(&cursor, &paramHandle)) == 0) {
+        ret = SavePersistParam(paramSpace, paramHandle, handle);
+    }
+    ParamCursorEnd(&cursor);
+    ret = (ret == PARAM_CODE_NOT_FOUND) ? 0 : ret;
+    ret = g_persistWorkSpace.persistParamOps.batchSaveEnd(handle, ret);
     PARAM_CHECK(ret == 0, return PARAM_CODE_INVALID_NAME, "Save persist param fail");
 
     PARAM_CLEAR_FLAG(g_persistWorkSpace.flags, WORKSPACE_FLAGS_UPDATE);
@@ -115,11 +119,11 @@ int LoadPersistParam(ParamWorkSpace *workSpace)
     }
 #endif
     if (g_persistWorkSpace.persistParamOps.load != NULL) {
-        ret = g_persistWorkSpace.persistParamOps.load(AddPersistParam, &workSpace->paramSpace);
+        ret = g_persistWorkSpace.persistParamOps.load(AddPersistParam, workSpace);
         PARAM_SET_FLAG(g_persistWorkSpace.flags, WORKSPACE_FLAGS_LOADED);
     }
     // save new persist param
-    ret = BatchSavePersistParam(&workSpace->paramSpace);
+    ret = BatchSavePersistParam(workSpace);
     PARAM_CHECK(ret == 0, return ret, "Failed to load persist param");
     return 0;
 }
@@ -133,46 +137,86 @@ PARAM_STATIC void TimerCallbackForSave(ParamTaskPtr timer, void *context)
     if (!PARAM_TEST_FLAG(g_persistWorkSpace.flags, WORKSPACE_FLAGS_UPDATE)) {
         return;
     }
-    (void)BatchSavePersistParam((WorkSpace *)context);
+    (void)BatchSavePersistParam((ParamWorkSpace *)context);
 }
 
-int WritePersistParam(ParamWorkSpace *workSpace, const char *name, const char *value)
+static void StartSaveTimer(ParamWorkSpace *workSpace)
 {
-    PARAM_CHECK(workSpace != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
-    PARAM_CHECK(value != NULL && name != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
-    if (strncmp(name, PARAM_PERSIST_PREFIX, strlen(PARAM_PERSIST_PREFIX)) != 0) {
-        return 0;
-    }
-    if (!PARAM_TEST_FLAG(g_persistWorkSpace.flags, WORKSPACE_FLAGS_LOADED)) {
-        PARAM_LOGE("Can not save persist param before load %s ", name);
-        return 0;
+    PARAM_SET_FLAG(g_persistWorkSpace.flags, WORKSPACE_FLAGS_UPDATE);
+    if (g_persistWorkSpace.saveTimer == NULL) {
+        ParamTimerCreate(&g_persistWorkSpace.saveTimer, TimerCallbackForSave, workSpace);
+        ParamTimerStart(g_persistWorkSpace.saveTimer, PARAM_MUST_SAVE_PARAM_DIFF * MS_UNIT, MS_UNIT);
     }
-    PARAM_LOGD("WritePersistParam name %s ", name);
-    if (g_persistWorkSpace.persistParamOps.save != NULL) {
-        g_persistWorkSpace.persistParamOps.save(name, value);
+}
+
+int WritePersistParams(ParamWorkSpace *workSpace, const char *names[], const char *values[], uint32_t count)
+{
+    PARAM_CHECK(workSpace != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
+    PARAM_CHECK(values != NULL && names != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
+    uint32_t persistCount = 0;
+    int saved = 1;
+    for (uint32_t i = 0; i < count; i++) {
+        PARAM_CHECK(values[i] != NULL && names[i] != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
+        if (strncmp(names[i], PARAM_PERSIST_PREFIX, strlen(PARAM_PERSIST_PREFIX)) != 0) {
+            continue;
+        }
+        if (!PARAM_TEST_FLAG(g_persistWorkSpace.flags, WORKSPACE_FLAGS_LOADED)) {
+            PARAM_LOGE("Can not save persist param before load %s ", names[i]);
+            return 0;
+        }
+        PARAM_LOGD("WritePersistParam name %s ", names[i]);
+        if (g_persistWorkSpace.persistParamOps.save == NULL ||
+            g_persistWorkSpace.persistParamOps.save(names[i], values[i]) != 0) {
+            saved = 0;
+        }
+        persistCount++;
     }
 
     // 不需要批量保存
-    if (g_persistWorkSpace.persistParamOps.batchSave == NULL) {
+    if (persistCount == 0 || g_persistWorkSpace.persistParamOps.batchSave == NULL) {
+        return 0;
+    }
+    // kept by save already, compacted by the timer when the saved records grow large
+    if (saved && g_persistWorkSpace.persistParamOps.needBatchSave != NULL) {
+        if (g_persistWorkSpace.persistParamOps.needBatchSave()) {
+            StartSaveTimer(workSpace);
+        }
         return 0;
     }
 
-    // check timer for save all
+    // check timer for save all, once for the whole batch
     time_t currTimer;
     (void)time(&currTimer);
     uint32_t diff = (uint32_t)difftime(currTimer, g_persistWorkSpace.lastSaveTimer);
-    PARAM_LOGD("WritePersistParam name %s  %d ", name, diff);
+    PARAM_LOGD("WritePersistParams count %u  %d ", persistCount, diff);
     if (diff > PARAM_MUST_SAVE_PARAM_DIFF) {
         if (g_persistWorkSpace.saveTimer != NULL) {
             ParamTaskClose(g_persistWorkSpace.saveTimer);
             g_persistWorkSpace.saveTimer = NULL;
         }
-        return BatchSavePersistParam(&workSpace->paramSpace);
-    }
-    PARAM_SET_FLAG(g_persistWorkSpace.flags, WORKSPACE_FLAGS_UPDATE);
-    if (g_persistWorkSpace.saveTimer == NULL) {
-        ParamTimerCreate(&g_persistWorkSpace.saveTimer, TimerCallbackForSave, &workSpace->paramSpace);
-        ParamTimerStart(g_persistWorkSpace.saveTimer, PARAM_MUST_SAVE_PARAM_DIFF * MS_UNIT, MS_UNIT);
+        return BatchSavePersistParam(workSpace);
     }
+    StartSaveTimer(workSpace);
     return 0;
 }
+
+int WritePersistParam(ParamWorkSpace *workSpace, const char *name, const char *value)
+{
+    return WritePersistParams(workSpace, &name, &value, 1);
+}
+
+int DeletePersistParam(ParamWorkSpace *workSpace, const char *name)
+{
+    PARAM_CHECK(workSpace != NULL && name != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid param");
+    if (strncmp(name, PARAM_PERSIST_PREFIX, strlen(PARAM_PERSIST_PREFIX)) != 0 ||
+        !PARAM_TEST_FLAG(g_persistWorkSpace.flags, WORKSPACE_FLAGS_LOADED)) {
+        return 0;
+    }
+    PARAM_LOGD("DeletePersistParam name %s ", name);
+    // the saved records only add and update, the snapshot is written again without the parameter
+    if (g_persistWorkSpace.saveTimer != NULL) {
+        ParamTaskClose(g_persistWorkSpace.saveTimer);
+        g_persistWorkSpace.saveTimer = NULL;
+    }
+    return BatchSavePersistParam(workSpace);
+}
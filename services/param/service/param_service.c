@@ -31,7 +31,25 @@
 #include "param_request.h"
 #include "trigger_manager.h"
 
-static ParamWorkSpace g_paramWorkSpace = { 0, {}, NULL, {}, NULL, NULL };
+static ParamWorkSpace g_paramWorkSpace = { .flags = 0, .securityLabel = NULL, .serverTask = NULL, .timer = NULL };
+
+typedef struct {
+    int result;
+    WorkSpace *workSpace; // NULL for service control parameters
+    uint32_t dataIndex;
+    uint32_t epoch; // of the area when dataIndex was resolved
+    const char *value;
+    char name[PARAM_NAME_LEN_MAX];
+} ParamSetItem;
+
+// trie nodes of the segments of the last loaded name, a sorted name shares them with the next one
+typedef struct {
+    WorkSpace *workSpace;
+    const char *name;
+    uint32_t depth;
+    uint32_t segmentEnd[PARAM_NAME_LEN_MAX / 2]; // 2 a segment and a '.' at least
+    ParamTrieNode *node[PARAM_NAME_LEN_MAX / 2];
+} ParamTriePath;
 
 static void OnClose(ParamTaskPtr client)
 {
@@ -41,41 +59,89 @@ static void OnClose(ParamTaskPtr client)
     ListRemove(&watcher->node);
 }
 
-static int AddParam(WorkSpace *workSpace, const char *name, const char *value, uint32_t *dataIndex)
+static int AddParam(WorkSpace *workSpace, ParamTrieNode *node, const char *name, const char *value, uint32_t *dataIndex)
 {
-    ParamTrieNode *node = AddTrieNode(workSpace, name, strlen(name));
-    PARAM_CHECK(node != NULL, return PARAM_CODE_REACHED_MAX, "Failed to add node");
+    if (node == NULL) {
+        node = AddTrieNode(workSpace, name, strlen(name));
+        PARAM_CHECK(node != NULL, return PARAM_CODE_REACHED_MAX, "Failed to add node");
+    }
     ParamNode *entry = (ParamNode *)GetTrieNode(workSpace, node->dataIndex);
     if (entry == NULL) {
         uint32_t offset = AddParamNode(workSpace, name, strlen(name), value, strlen(value));
         PARAM_CHECK(offset > 0, return PARAM_CODE_REACHED_MAX, "Failed to allocate name %s", name);
         SaveIndex(&node->dataIndex, offset);
+        // the trie still resolves the name when the exact index can not grow
+        if (AddParamHashEntry(workSpace, name, strlen(name), offset) != 0) {
+            PARAM_LOGE("Failed to add hash index for %s", name);
+        }
+        // wake up the clients waiting for a parameter not created yet
+        atomic_fetch_add_explicit(&workSpace->area->serial, 1, memory_order_release);
+        futex_wake(&workSpace->area->serial, INT_MAX);
     }
     *dataIndex = node->dataIndex;
     return 0;
 }
 
-static int UpdateParam(const WorkSpace *workSpace, uint32_t *dataIndex, const char *name, const char *value)
+static int UpdateParam(WorkSpace *workSpace, uint32_t *dataIndex, const char *name, const char *value)
 {
     ParamNode *entry = (ParamNode *)GetTrieNode(workSpace, *dataIndex);
     PARAM_CHECK(entry != NULL, return PARAM_CODE_REACHED_MAX, "Failed to update param value %s %u", name, *dataIndex);
     PARAM_CHECK(entry->keyLength == strlen(name), return PARAM_CODE_INVALID_NAME, "Failed to check name len %s", name);
 
     uint32_t valueLen = strlen(value);
+    if (entry->valueLength >= PARAM_VALUE_LEN_MAX || valueLen >= PARAM_VALUE_LEN_MAX) {
+        return 0;
+    }
+    // back to the inline space when it fits, or to a larger slot when the value grows
+    uint32_t size = 0;
+    char *dest = GetParamNodeValue(workSpace, entry, &size);
+    uint32_t oldIndex = atomic_load_explicit(&entry->valueIndex, memory_order_relaxed);
+    uint32_t newIndex = oldIndex;
+    if (valueLen < entry->valueSize) {
+        newIndex = 0;
+        dest = entry->data + entry->keyLength + 1;
+        size = entry->valueSize;
+    } else if (valueLen >= size) {
+        newIndex = AllocateParamValue(workSpace, valueLen + 1);
+        PARAM_CHECK(newIndex != 0, return PARAM_CODE_REACHED_MAX, "Failed to allocate value for %s", name);
+        ParamValueNode *slot = (ParamValueNode *)GetTrieNode(workSpace, newIndex);
+        dest = slot->data;
+        size = slot->size;
+    }
     uint32_t commitId = atomic_load_explicit(&entry->commitId, memory_order_relaxed);
     atomic_store_explicit(&entry->commitId, commitId | PARAM_FLAGS_MODIFY, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
 
-    if (entry->valueLength < PARAM_VALUE_LEN_MAX && valueLen < PARAM_VALUE_LEN_MAX) {
-        int ret = memcpy_s(entry->data + entry->keyLength + 1, PARAM_VALUE_LEN_MAX, value, valueLen + 1);
-        PARAM_CHECK(ret == EOK, return PARAM_CODE_INVALID_VALUE, "Failed to copy value");
-        entry->valueLength = valueLen;
-    }
-    uint32_t flags = commitId & ~PARAM_FLAGS_COMMITID;
-    atomic_store_explicit(&entry->commitId, (++commitId) | flags, memory_order_release);
+    int ret = memcpy_s(dest, size, value, valueLen + 1);
+    PARAM_CHECK(ret == EOK, return PARAM_CODE_INVALID_VALUE, "Failed to copy value");
+    atomic_store_explicit(&entry->valueIndex, newIndex, memory_order_release);
+    entry->valueLength = valueLen;
+
+    // a deleted parameter is added again in its tombstone
+    uint32_t flags = commitId & ~(PARAM_FLAGS_COMMITID | PARAM_FLAGS_DELETED);
+    atomic_store_explicit(&entry->commitId, ((commitId + 1) & PARAM_FLAGS_COMMITID) | flags, memory_order_release);
     futex_wake(&entry->commitId, INT_MAX);
+    // readers still copying from the old slot see the new commit id and copy again
+    if (oldIndex != 0 && oldIndex != newIndex) {
+        FreeParamValue(workSpace, oldIndex);
+    }
     return 0;
 }
 
+static void UpdateParamChangeSerial(const char *name)
+{
+    // the prefix first, readers of the global serial then find the prefix changed too
+    atomic_uint *serials[] = {
+        GetParamChangeSerial(&g_paramWorkSpace, name), GetParamChangeSerial(&g_paramWorkSpace, NULL)
+    };
+    for (size_t i = 0; i < ARRAY_LENGTH(serials); i++) {
+        if (serials[i] != NULL) {
+            atomic_fetch_add_explicit(serials[i], 1, memory_order_release);
+            futex_wake(serials[i], INT_MAX);
+        }
+    }
+}
+
 static int CheckParamValue(const WorkSpace *workSpace, const ParamTrieNode *node, const char *name, const char *value)
 {
     if (IS_READY_ONLY(name)) {
@@ -93,49 +159,162 @@ static int CheckParamValue(const WorkSpace *workSpace, const ParamTrieNode *node
     return 0;
 }
 
-int WriteParam(const WorkSpace *workSpace, const char *name, const char *value, uint32_t *dataIndex, int onlyAdd)
+static int WriteParamToNode(WorkSpace *workSpace, ParamTrieNode *node,
+    const char *name, const char *value, uint32_t *dataIndex, int onlyAdd)
 {
-    PARAM_CHECK(workSpace != NULL && dataIndex != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
-    PARAM_CHECK(value != NULL && name != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid name or value");
-    ParamTrieNode *node = FindTrieNode(workSpace, name, strlen(name), NULL);
     int ret = CheckParamValue(workSpace, node, name, value);
     PARAM_CHECK(ret == 0, return ret, "Invalid param value param: %s=%s", name, value);
-    if (node != NULL && node->dataIndex != 0) {
+    ParamNode *entry = (node != NULL) ? (ParamNode *)GetTrieNode(workSpace, node->dataIndex) : NULL;
+    if (entry != NULL && PARAM_NODE_DELETED(entry)) {
+        *dataIndex = node->dataIndex;
+        uint32_t size = GetParamNodeSize(workSpace, entry);
+        ret = UpdateParam(workSpace, &node->dataIndex, name, value);
+        if (ret == 0 && !PARAM_NODE_DELETED(entry)) {
+            workSpace->area->deletedSize -= (size < workSpace->area->deletedSize) ? size : workSpace->area->deletedSize;
+            atomic_fetch_add_explicit(&workSpace->area->serial, 1, memory_order_release);
+            futex_wake(&workSpace->area->serial, INT_MAX);
+        }
+    } else if (node != NULL && node->dataIndex != 0) {
         *dataIndex = node->dataIndex;
         if (onlyAdd) {
             return 0;
         }
-        return UpdateParam(workSpace, &node->dataIndex, name, value);
+        ret = UpdateParam(workSpace, &node->dataIndex, name, value);
+    } else {
+        ret = AddParam(workSpace, node, name, value, dataIndex);
     }
-    return AddParam((WorkSpace *)workSpace, name, value, dataIndex);
+    if (ret == 0) {
+        UpdateParamChangeSerial(name);
+    }
+    return ret;
 }
 
-PARAM_STATIC int AddSecurityLabel(const ParamAuditData *auditData, void *context)
+int WriteParam(const WorkSpace *workSpace, const char *name, const char *value, uint32_t *dataIndex, int onlyAdd)
 {
-    PARAM_CHECK(auditData != NULL && auditData->name != NULL, return -1, "Invalid auditData");
-    PARAM_CHECK(context != NULL, return -1, "Invalid context");
-    ParamWorkSpace *workSpace = (ParamWorkSpace *)context;
-    int ret = CheckParamName(auditData->name, 1);
-    PARAM_CHECK(ret == 0, return ret, "Illegal param name %s", auditData->name);
+    PARAM_CHECK(workSpace != NULL && dataIndex != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid workSpace");
+    PARAM_CHECK(value != NULL && name != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid name or value");
+    ParamTrieNode *node = FindTrieNode(workSpace, name, strlen(name), NULL);
+    int ret = WriteParamToNode((WorkSpace *)workSpace, node, name, value, dataIndex, onlyAdd);
+    if (ret == PARAM_CODE_REACHED_MAX && workSpace->area->deletedSize > 0) {
+        // take back the space of the deleted parameters and try once more
+        PARAM_CHECK(CompactWorkSpace((WorkSpace *)workSpace) == 0, return ret, "Failed to compact for %s", name);
+        node = FindTrieNode(workSpace, name, strlen(name), NULL);
+        ret = WriteParamToNode((WorkSpace *)workSpace, node, name, value, dataIndex, onlyAdd);
+    }
+    return ret;
+}
+
+static int DeleteParam(WorkSpace *workSpace, const char *name)
+{
+    ParamTrieNode *node = FindTrieNode(workSpace, name, strlen(name), NULL);
+    ParamNode *entry = (node != NULL) ? (ParamNode *)GetTrieNode(workSpace, node->dataIndex) : NULL;
+    if (entry == NULL || PARAM_NODE_DELETED(entry)) {
+        return PARAM_CODE_NOT_FOUND;
+    }
+    // the node and its value stay until the area is compacted, readers racing with the delete copy a valid value
+    uint32_t commitId = atomic_load_explicit(&entry->commitId, memory_order_relaxed);
+    uint32_t flags = commitId & ~PARAM_FLAGS_COMMITID;
+    atomic_store_explicit(&entry->commitId,
+        ((commitId + 1) & PARAM_FLAGS_COMMITID) | flags | PARAM_FLAGS_DELETED, memory_order_release);
+    futex_wake(&entry->commitId, INT_MAX);
+    workSpace->area->deletedSize += GetParamNodeSize(workSpace, entry);
+    // clients drop the handles they cached for the name
+    atomic_fetch_add_explicit(&workSpace->area->generation, 1, memory_order_release);
+    UpdateParamChangeSerial(name);
+    return 0;
+}
 
-    ParamTrieNode *node = FindTrieNode(&workSpace->paramSpace, auditData->name, strlen(auditData->name), NULL);
+static void CheckAndCompactWorkSpace(WorkSpace *workSpace)
+{
+    const ParamTrieHeader *area = workSpace->area;
+    if (area->deletedSize < PARAM_COMPACT_SIZE_MIN || (area->deletedSize * PARAM_COMPACT_RATIO) < area->currOffset) {
+        return;
+    }
+    int ret = CompactWorkSpace(workSpace);
+    PARAM_CHECK(ret == 0, return, "Failed to compact workspace %s", workSpace->fileName);
+}
+
+static ParamTrieNode *AddParamTriePath(ParamTriePath *path, WorkSpace *workSpace, const char *name)
+{
+    uint32_t depth = 0;
+    if (path->workSpace == workSpace) {
+        uint32_t same = 0;
+        while (name[same] != '\0' && name[same] == path->name[same]) {
+            same++;
+        }
+        while (depth < path->depth && path->segmentEnd[depth] <= same &&
+            (name[path->segmentEnd[depth]] == '.' || name[path->segmentEnd[depth]] == '\0')) {
+            depth++;
+        }
+    }
+    ParamTrieNode *current = (depth == 0) ? NULL : path->node[depth - 1];
+    uint32_t offset = (depth == 0) ? 0 : path->segmentEnd[depth - 1];
+    path->workSpace = NULL;
+    while (name[offset] != '\0' && depth < ARRAY_LENGTH(path->node)) {
+        offset += (depth == 0) ? 0 : 1;
+        const char *segment = name + offset;
+        const char *next = strchr(segment, '.');
+        uint32_t segmentLen = (next == NULL) ? strlen(segment) : (uint32_t)(next - segment);
+        current = AddTrieChildNode(workSpace, current, segment, segmentLen);
+        PARAM_CHECK(current != NULL, return NULL, "Failed to add node %s", name);
+        offset += segmentLen;
+        path->node[depth] = current;
+        path->segmentEnd[depth] = offset;
+        depth++;
+    }
+    PARAM_CHECK(name[offset] == '\0', return NULL, "Invalid name %s", name);
+    path->workSpace = workSpace;
+    path->name = name;
+    path->depth = depth;
+    return current;
+}
+
+static int AddSecurityLabelToArea(WorkSpace *space, const ParamAuditData *auditData)
+{
+    ParamTrieNode *node = FindTrieNode(space, auditData->name, strlen(auditData->name), NULL);
     if (node == NULL) {
-        node = AddTrieNode(&workSpace->paramSpace, auditData->name, strlen(auditData->name));
+        node = AddTrieNode(space, auditData->name, strlen(auditData->name));
     }
     PARAM_CHECK(node != NULL, return PARAM_CODE_REACHED_MAX, "Failed to add node %s", auditData->name);
     if (node->labelIndex == 0) { // can not support update for label
-        uint32_t offset = AddParamSecruityNode(&workSpace->paramSpace, auditData);
+        uint32_t offset = AddParamSecruityNode(space, auditData);
         PARAM_CHECK(offset != 0, return PARAM_CODE_REACHED_MAX, "Failed to add label");
+        // the hash is updated first, so a lookup never gets a less specific label than the trie
+        UpdateParamHashLabel(space, node, offset);
         SaveIndex(&node->labelIndex, offset);
     } else {
 #ifdef STARTUP_INIT_TEST
-        ParamSecruityNode *label = (ParamSecruityNode *)GetTrieNode(&workSpace->paramSpace, node->labelIndex);
-        label->mode = auditData->dacData.mode;
-        label->uid = auditData->dacData.uid;
-        label->gid = auditData->dacData.gid;
+        // the label node may be shared with other prefixes, so point to the new one instead of changing it
+        uint32_t offset = AddParamSecruityNode(space, auditData);
+        PARAM_CHECK(offset != 0, return PARAM_CODE_REACHED_MAX, "Failed to add label");
+        UpdateParamHashLabel(space, node, offset);
+        SaveIndex(&node->labelIndex, offset);
 #endif
         PARAM_LOGE("Error, repeate to add label for name %s", auditData->name);
     }
+    // clients revalidate the handles and permissions they cached for this area
+    atomic_fetch_add_explicit(&space->area->generation, 1, memory_order_release);
+    return 0;
+}
+
+PARAM_STATIC int AddSecurityLabel(const ParamAuditData *auditData, void *context)
+{
+    PARAM_CHECK(auditData != NULL && auditData->name != NULL, return -1, "Invalid auditData");
+    PARAM_CHECK(context != NULL, return -1, "Invalid context");
+    ParamWorkSpace *workSpace = (ParamWorkSpace *)context;
+    int ret = CheckParamName(auditData->name, 1);
+    PARAM_CHECK(ret == 0, return ret, "Illegal param name %s", auditData->name);
+
+    // every area resolves labels in its own trie, so a label is added to all areas it covers
+    for (uint32_t i = PARAM_AREA_DEFAULT; i < PARAM_AREA_MAX; i++) {
+        if (!CheckLabelInWorkSpace(i, auditData->name)) {
+            continue;
+        }
+        WorkSpace *space = GetWorkSpaceByIndex(workSpace, i);
+        PARAM_CHECK(space != NULL, return PARAM_CODE_NOT_INIT, "Invalid workspace for %s", auditData->name);
+        ret = AddSecurityLabelToArea(space, auditData);
+        PARAM_CHECK(ret == 0, return ret, "Failed to add label %s", auditData->name);
+    }
     PARAM_LOGD("AddSecurityLabel label gid %d uid %d mode %o name: %s", auditData->dacData.gid, auditData->dacData.uid,
                auditData->dacData.mode, auditData->name);
     return 0;
@@ -182,9 +361,9 @@ static char *GetServiceCtrlName(const char *name, const char *value)
     return key;
 }
 
-static void CheckAndSendTrigger(ParamWorkSpace *workSpace, uint32_t dataIndex, const char *name, const char *value)
+static void CheckAndSendTrigger(const WorkSpace *workSpace, uint32_t dataIndex, const char *name, const char *value)
 {
-    ParamNode *entry = (ParamNode *)GetTrieNode(&workSpace->paramSpace, dataIndex);
+    ParamNode *entry = (ParamNode *)GetTrieNode(workSpace, dataIndex);
     PARAM_CHECK(entry != NULL, return, "Failed to get data %s ", name);
     uint32_t trigger = 1;
     if ((atomic_load_explicit(&entry->commitId, memory_order_relaxed) & PARAM_FLAGS_TRIGGED) != PARAM_FLAGS_TRIGGED) {
@@ -209,7 +388,8 @@ static void CheckAndSendTrigger(ParamWorkSpace *workSpace, uint32_t dataIndex, c
     PostParamTrigger(EVENT_TRIGGER_PARAM_WATCH, name, value);
 }
 
-static int SystemSetParam(const char *name, const char *value, const ParamSecurityLabel *srcLabel)
+static int SystemSetParam(const char *name, const char *value,
+    const ParamSecurityLabel *srcLabel, ParamSetItem *deferred)
 {
     PARAM_LOGD("SystemSetParam name %s value: %s", name, value);
     int ret = CheckParamName(name, 0);
@@ -226,17 +406,27 @@ static int SystemSetParam(const char *name, const char *value, const ParamSecuri
     }
     PARAM_CHECK(ret == 0, return ret, "Forbit to set parameter %s", name);
 
+    WorkSpace *space = GetWorkSpace(&g_paramWorkSpace, name);
+    PARAM_CHECK(space != NULL, return PARAM_CODE_NOT_INIT, "Invalid workspace for %s", name);
     if (serviceCtrl) {
-        ret = CheckParamValue(&g_paramWorkSpace.paramSpace, NULL, name, value);
+        ret = CheckParamValue(space, NULL, name, value);
         PARAM_CHECK(ret == 0, return ret, "Invalid param value param: %s=%s", name, value);
-        PostParamTrigger(EVENT_TRIGGER_PARAM, name, value);
+        if (deferred == NULL) {
+            PostParamTrigger(EVENT_TRIGGER_PARAM, name, value);
+        }
     } else {
         uint32_t dataIndex = 0;
-        ret = WriteParam(&g_paramWorkSpace.paramSpace, name, value, &dataIndex, 0);
+        ret = WriteParam(space, name, value, &dataIndex, 0);
         PARAM_CHECK(ret == 0, return ret, "Failed to set param %d name %s %s", ret, name, value);
-        ret = WritePersistParam(&g_paramWorkSpace, name, value);
-        PARAM_CHECK(ret == 0, return ret, "Failed to set persist param name %s", name);
-        CheckAndSendTrigger(&g_paramWorkSpace, dataIndex, name, value);
+        if (deferred != NULL) { // persist and trigger once the whole batch is written
+            deferred->workSpace = space;
+            deferred->dataIndex = dataIndex;
+            deferred->epoch = atomic_load_explicit(&space->area->epoch, memory_order_relaxed);
+        } else {
+            ret = WritePersistParam(&g_paramWorkSpace, name, value);
+            PARAM_CHECK(ret == 0, return ret, "Failed to set persist param name %s", name);
+            CheckAndSendTrigger(space, dataIndex, name, value);
+        }
     }
 
     // watcher stoped
@@ -248,6 +438,29 @@ static int SystemSetParam(const char *name, const char *value, const ParamSecuri
     return ret;
 }
 
+static int SystemDelParam(const char *name, const ParamSecurityLabel *srcLabel)
+{
+    PARAM_LOGD("SystemDelParam name %s", name);
+    int ret = CheckParamName(name, 0);
+    PARAM_CHECK(ret == 0, return ret, "Illegal param name %s", name);
+    if (srcLabel != NULL) {
+        ret = CheckParamPermission(&g_paramWorkSpace, srcLabel, name, DAC_WRITE);
+        PARAM_CHECK(ret == 0, return ret, "Forbit to delete parameter %s", name);
+    }
+    PARAM_CHECK(!IS_READY_ONLY(name), return PARAM_CODE_READ_ONLY, "Read-only param can not be deleted %s", name);
+
+    WorkSpace *space = GetWorkSpace(&g_paramWorkSpace, name);
+    PARAM_CHECK(space != NULL, return PARAM_CODE_NOT_INIT, "Invalid workspace for %s", name);
+    ret = DeleteParam(space, name);
+    if (ret != 0) {
+        return ret;
+    }
+    ret = DeletePersistParam(&g_paramWorkSpace, name);
+    PARAM_CHECK(ret == 0, return ret, "Failed to delete persist param %s", name);
+    CheckAndCompactWorkSpace(space);
+    return 0;
+}
+
 static int SendResponseMsg(ParamTaskPtr worker, const ParamMessage *msg, int result)
 {
     ParamResponseMessage *response = NULL;
@@ -260,11 +473,34 @@ static int SendResponseMsg(ParamTaskPtr worker, const ParamMessage *msg, int res
     return 0;
 }
 
+static int SendBatchResponseMsg(ParamTaskPtr worker, const ParamMessage *msg,
+    int result, const ParamSetItem *items, uint32_t count)
+{
+    uint32_t msgSize = sizeof(ParamBatchResponseMessage) + count * sizeof(int32_t);
+    ParamBatchResponseMessage *response = (ParamBatchResponseMessage *)CreateParamMessage(msg->type, msg->key, msgSize);
+    PARAM_CHECK(response != NULL, return PARAM_CODE_ERROR, "Failed to alloc memory for response");
+    response->msg.id.msgId = msg->id.msgId;
+    response->result = result;
+    response->count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        response->results[i] = items[i].result;
+    }
+    response->msg.msgSize = msgSize;
+    ParamTaskSendMsg(worker, (ParamMessage *)response);
+    return 0;
+}
+
 static int SendWatcherNotifyMessage(const TriggerExtData *extData, int cmd, const char *content)
 {
-    UNUSED(cmd);
     PARAM_CHECK(content != NULL, return -1, "Invalid content");
     PARAM_CHECK(extData != NULL && extData->watcher != NULL, return -1, "Invalid extData");
+    if (cmd == CMD_INDEX_FOR_PARA_WAIT_TIMEOUT) { // answer the wait, the connection may carry other requests
+        ParamMessage msg = {};
+        msg.type = MSG_WAIT_PARAM;
+        msg.id.waitId = extData->watcherId;
+        PARAM_CHECK(strcpy_s(msg.key, sizeof(msg.key), content) == EOK, return -1, "Invalid name %s", content);
+        return SendResponseMsg(extData->watcher->stream, &msg, PARAM_CODE_TIMEOUT);
+    }
     uint32_t msgSize = sizeof(ParamMessage) + PARAM_ALIGN(strlen(content) + 1);
     ParamMessage *msg = (ParamMessage *)CreateParamMessage(MSG_NOTIFY_PARAM, "*", msgSize);
     PARAM_CHECK(msg != NULL, return -1, "Failed to create msg ");
@@ -312,37 +548,183 @@ static int HandleParamSet(const ParamTaskPtr worker, const ParamMessage *msg)
             "Failed to decode param %d name %s %s", ret, msg->key, valueContent->content);
     }
 
-    ret = SystemSetParam(msg->key, valueContent->content, srcLabel);
+    if (msg->type == MSG_DEL_PARAM) {
+        ret = SystemDelParam(msg->key, srcLabel);
+    } else {
+        ret = SystemSetParam(msg->key, valueContent->content, srcLabel, NULL);
+    }
     if (srcLabel != NULL && g_paramWorkSpace.paramSecurityOps.securityFreeLabel != NULL) {
         g_paramWorkSpace.paramSecurityOps.securityFreeLabel(srcLabel);
     }
     return SendResponseMsg(worker, msg, ret);
 }
 
-static ParamNode *CheckMatchParamWait(const ParamWorkSpace *worksapce, const char *name, const char *value)
+static uint32_t GetParamSetItemIndex(const ParamSetItem *item)
+{
+    // a later parameter of the batch may compact the area
+    if (item->epoch == atomic_load_explicit(&item->workSpace->area->epoch, memory_order_relaxed)) {
+        return item->dataIndex;
+    }
+    ParamTrieNode *node = FindTrieNode(item->workSpace, item->name, strlen(item->name), NULL);
+    return (node != NULL) ? node->dataIndex : 0;
+}
+
+static int FlushParamSetBatch(const ParamSetItem *items, uint32_t count)
+{
+    const char *names[PARAM_BATCH_MAX] = { NULL };
+    const char *values[PARAM_BATCH_MAX] = { NULL };
+    uint8_t last[PARAM_BATCH_MAX] = { 0 };
+    uint32_t persistCount = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (items[i].result != 0 || items[i].workSpace == NULL) {
+            continue;
+        }
+        // a parameter written more than once is persisted and triggered with its final value only
+        last[i] = 1;
+        for (uint32_t j = i + 1; j < count; j++) {
+            if (items[j].result == 0 && items[j].workSpace != NULL && strcmp(items[i].name, items[j].name) == 0) {
+                last[i] = 0;
+                break;
+            }
+        }
+        if (last[i]) {
+            names[persistCount] = items[i].name;
+            values[persistCount] = items[i].value;
+            persistCount++;
+        }
+    }
+    int ret = WritePersistParams(&g_paramWorkSpace, names, values, persistCount);
+    PARAM_CHECK(ret == 0, return ret, "Failed to set persist params count %u", persistCount);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (items[i].result != 0) {
+            continue;
+        }
+        if (items[i].workSpace == NULL) {
+            PostParamTrigger(EVENT_TRIGGER_PARAM, items[i].name, items[i].value);
+        } else if (last[i]) {
+            CheckAndSendTrigger(items[i].workSpace, GetParamSetItemIndex(&items[i]), items[i].name, items[i].value);
+        }
+    }
+    return 0;
+}
+
+static int DecodeParamSetItem(const ParamMsgContent *content, ParamSetItem *item)
+{
+    const char *sep = strchr(content->content, '=');
+    PARAM_CHECK(sep != NULL, return PARAM_CODE_INVALID_PARAM, "Invalid content %s", content->content);
+    PARAM_CHECK((uint32_t)(sep - content->content) < sizeof(item->name),
+        return PARAM_CODE_INVALID_NAME, "Invalid name in %s", content->content);
+    int ret = memcpy_s(item->name, sizeof(item->name) - 1, content->content, sep - content->content);
+    PARAM_CHECK(ret == EOK, return PARAM_CODE_INVALID_PARAM, "Failed to copy name %s", content->content);
+    item->name[sep - content->content] = '\0';
+    item->value = sep + 1;
+    return 0;
+}
+
+static int HandleParamSetBatch(const ParamTaskPtr worker, const ParamMessage *msg)
+{
+    ParamSetItem *items = (ParamSetItem *)calloc(PARAM_BATCH_MAX, sizeof(ParamSetItem));
+    PARAM_CHECK(items != NULL, return -1, "Failed to alloc memory for batch");
+    uint32_t count = 0;
+    uint32_t offset = 0;
+    const ParamMsgContent *lableContent = NULL;
+    ParamMsgContent *content = GetNextContent(msg, &offset);
+    while (content != NULL) {
+        if (content->type == PARAM_LABEL) {
+            lableContent = content;
+        } else if (content->type == PARAM_NAME_VALUE) {
+            PARAM_CHECK(count < PARAM_BATCH_MAX, free(items);
+                return -1, "Too many parameters in batch");
+            items[count].result = DecodeParamSetItem(content, &items[count]);
+            count++;
+        }
+        content = GetNextContent(msg, &offset);
+    }
+
+    int ret;
+    ParamSecurityLabel *srcLabel = NULL;
+    if (lableContent != NULL && lableContent->contentSize != 0) {
+        PARAM_CHECK(g_paramWorkSpace.paramSecurityOps.securityDecodeLabel != NULL, free(items);
+            return -1, "Can not get decode function");
+        ret = g_paramWorkSpace.paramSecurityOps.securityDecodeLabel(&srcLabel,
+            lableContent->content, lableContent->contentSize);
+        PARAM_CHECK(ret == 0, free(items);
+            return ret, "Failed to decode label %d for batch", ret);
+    }
+
+    // apply in order, then persist and post triggers once for the whole batch
+    int result = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (items[i].result == 0) {
+            items[i].result = SystemSetParam(items[i].name, items[i].value, srcLabel, &items[i]);
+        }
+        result = (result == 0) ? items[i].result : result;
+    }
+    if (srcLabel != NULL && g_paramWorkSpace.paramSecurityOps.securityFreeLabel != NULL) {
+        g_paramWorkSpace.paramSecurityOps.securityFreeLabel(srcLabel);
+    }
+    ret = FlushParamSetBatch(items, count);
+    result = (result == 0) ? ret : result;
+    ret = SendBatchResponseMsg(worker, msg, result, items, count);
+    free(items);
+    return ret;
+}
+
+static int CheckMatchParamWait(const ParamWorkSpace *worksapce, const char *name, const char *value,
+    char *content, uint32_t contentSize)
 {
     uint32_t nameLength = strlen(name);
-    ParamTrieNode *node = FindTrieNode(&worksapce->paramSpace, name, nameLength, NULL);
+    WorkSpace *space = GetWorkSpace(worksapce, name);
+    if (space == NULL) {
+        return 0;
+    }
+    ParamTrieNode *node = FindTrieNode(space, name, nameLength, NULL);
     if (node == NULL || node->dataIndex == 0) {
-        return NULL;
+        return 0;
     }
-    ParamNode *param = (ParamNode *)GetTrieNode(&worksapce->paramSpace, node->dataIndex);
-    if (param == NULL) {
-        return NULL;
+    ParamNode *param = (ParamNode *)GetTrieNode(space, node->dataIndex);
+    if (param == NULL || PARAM_NODE_DELETED(param)) {
+        return 0;
     }
     if ((param->keyLength != nameLength) || (strncmp(param->data, name, nameLength) != 0)) { // compare name
-        return NULL;
+        return 0;
     }
     atomic_store_explicit(&param->commitId,
         atomic_load_explicit(&param->commitId, memory_order_relaxed) | PARAM_FLAGS_WAITED, memory_order_release);
-    if ((strncmp(value, "*", 1) == 0) || (strcmp(param->data + nameLength + 1, value) == 0)) { // compare value
-        return param;
+    // a grown value is kept in a value slot, copy it from one commit
+    char paramValue[PARAM_VALUE_LEN_MAX] = { 0 };
+    uint32_t valueLength = sizeof(paramValue);
+    ParamHandle handle = 0;
+    uint32_t labelIndex = 0;
+    if (ReadParamIndex(worksapce, name, &handle, &labelIndex) != 0 ||
+        ReadParamValue(worksapce, handle, paramValue, &valueLength) != 0) {
+        return 0;
     }
     char *tmp = strstr(value, "*");
-    if (tmp != NULL && (strncmp(param->data + nameLength + 1, value, tmp - value) == 0)) {
-        return param;
+    if ((strncmp(value, "*", 1) != 0) && (strcmp(paramValue, value) != 0) && // compare value
+        (tmp == NULL || strncmp(paramValue, value, tmp - value) != 0)) {
+        return 0;
     }
-    return NULL;
+    int ret = sprintf_s(content, contentSize, "%s=%s", name, paramValue);
+    PARAM_CHECK(ret > 0, return 0, "Failed to format param %s", name);
+    return 1;
+}
+
+static void StartWaitTimer(void)
+{
+    uint64_t now = GetTriggerTime();
+    uint64_t deadline = CheckWaitTriggerTimeout(GetTriggerWorkSpace(), now);
+    if (deadline != 0 && g_paramWorkSpace.timer != NULL) {
+        ParamTimerStart(g_paramWorkSpace.timer, deadline - now, 0);
+    }
+}
+
+static void TimerCallback(ParamTaskPtr timer, void *context)
+{
+    UNUSED(timer);
+    UNUSED(context);
+    StartWaitTimer();
 }
 
 static int HandleParamWaitAdd(const ParamWorkSpace *worksapce, const ParamTaskPtr worker, const ParamMessage *msg)
@@ -361,16 +743,16 @@ static int HandleParamWaitAdd(const ParamWorkSpace *worksapce, const ParamTaskPt
     PARAM_LOGD("HandleParamWaitAdd name %s timeout %d", msg->key, timeout);
     ParamWatcher *watcher = GetParamWatcher(worker);
     PARAM_CHECK(watcher != NULL, return -1, "Failed to get param watcher data");
-    watcher->timeout = timeout;
 
     TriggerExtData extData = {};
     extData.excuteCmd = SendWatcherNotifyMessage;
     extData.watcherId = msg->id.watcherId;
+    extData.timeout = timeout;
     extData.watcher = watcher;
     // first check match, if match send response to client
-    ParamNode *param = CheckMatchParamWait(worksapce, msg->key, valueContent->content);
-    if (param != NULL) {
-        SendWatcherNotifyMessage(&extData, CMD_INDEX_FOR_PARA_WAIT, param->data);
+    char content[PARAM_NAME_LEN_MAX + PARAM_VALUE_LEN_MAX + 2] = { 0 }; // 2 '=' and '\0'
+    if (CheckMatchParamWait(worksapce, msg->key, valueContent->content, content, sizeof(content))) {
+        SendWatcherNotifyMessage(&extData, CMD_INDEX_FOR_PARA_WAIT, content);
         return 0;
     }
 
@@ -384,6 +766,7 @@ static int HandleParamWaitAdd(const ParamWorkSpace *worksapce, const ParamTaskPt
     PARAM_CHECK(trigger != NULL, free(condition);
         return -1, "Failed to add trigger for %s", msg->key);
     free(condition);
+    StartWaitTimer();
     return 0;
 }
 
@@ -424,6 +807,7 @@ PARAM_STATIC int ProcessMessage(const ParamTaskPtr worker, const ParamMessage *m
     int ret = PARAM_CODE_INVALID_PARAM;
     switch (msg->type) {
         case MSG_SET_PARAM:
+        case MSG_DEL_PARAM:
             ret = HandleParamSet(worker, msg);
             break;
         case MSG_WAIT_PARAM:
@@ -435,6 +819,9 @@ PARAM_STATIC int ProcessMessage(const ParamTaskPtr worker, const ParamMessage *m
         case MSG_DEL_WATCHER:
             ret = HandleParamWatcherDel(&g_paramWorkSpace, worker, msg);
             break;
+        case MSG_SET_PARAM_BATCH:
+            ret = HandleParamSetBatch(worker, msg);
+            break;
         default:
             break;
     }
@@ -442,41 +829,48 @@ PARAM_STATIC int ProcessMessage(const ParamTaskPtr worker, const ParamMessage *m
     return 0;
 }
 
-static int LoadDefaultParam_(const char *fileName, uint32_t mode, const char *exclude[], uint32_t count)
+static int CheckDefaultParamLine(const ParamFileLine *line, void *context)
 {
-    uint32_t paramNum = 0;
-    FILE *fp = fopen(fileName, "r");
-    PARAM_CHECK(fp != NULL, return -1, "Open file %s fail", fileName);
-    char *buff = calloc(1, sizeof(SubStringInfo) * (SUBSTR_INFO_VALUE + 1) + PARAM_BUFFER_SIZE);
-    PARAM_CHECK(buff != NULL, (void)fclose(fp);
-        return -1, "Failed to alloc memory for load %s", fileName);
-
-    SubStringInfo *info = (SubStringInfo *)(buff + PARAM_BUFFER_SIZE);
-    while (fgets(buff, PARAM_BUFFER_SIZE, fp) != NULL) {
-        buff[PARAM_BUFFER_SIZE - 1] = '\0';
-        int subStrNumber = GetSubStringInfo(buff, strlen(buff), '=', info, SUBSTR_INFO_VALUE + 1);
-        if (subStrNumber <= SUBSTR_INFO_VALUE) {
-            continue;
+    static const char *exclude[] = {"ctl.", "selinux.restorecon_recursive"};
+    const char *name = line->fields[SUBSTR_INFO_NAME];
+    // 过滤
+    for (size_t i = 0; i < ARRAY_LENGTH(exclude); i++) {
+        if (strncmp(name, exclude[i], strlen(exclude[i])) == 0) {
+            PARAM_LOGI("Do not set %s parameters", name);
+            return -1;
         }
-        // 过滤
-        for (uint32_t i = 0; i < count; i++) {
-            if (strncmp(info[0].value, exclude[i], strlen(exclude[i])) == 0) {
-                PARAM_LOGI("Do not set %s parameters", info[0].value);
-                continue;
-            }
+    }
+    int ret = CheckParamName(name, 0);
+    PARAM_CHECK(ret == 0, return ret, "Illegal param name %s", name);
+    return CheckParamValue(NULL, NULL, name, line->fields[SUBSTR_INFO_VALUE]);
+}
+
+static int LoadDefaultParamLines(const ParamFileLine *lines, uint32_t count, void *context)
+{
+    uint32_t mode = *(uint32_t *)context;
+    uint32_t paramNum = 0;
+    ParamTriePath path = {};
+    for (uint32_t i = 0; i < count; i++) {
+        const char *name = lines[i].fields[SUBSTR_INFO_NAME];
+        uint32_t last = i;
+        while ((last + 1) < count && strcmp(lines[last + 1].fields[SUBSTR_INFO_NAME], name) == 0) {
+            last++;
         }
-        int ret = CheckParamName(info[0].value, 0);
-        PARAM_CHECK(ret == 0, continue, "Illegal param name %s", info[0].value);
-        PARAM_LOGI("Add default parameter %s  %s", info[0].value, info[1].value);
+        // the last line of a name wins as if the lines were set one by one, the first one when it is only added
+        const char *value = ((mode & LOAD_PARAM_ONLY_ADD) || IS_READY_ONLY(name)) ?
+            lines[i].fields[SUBSTR_INFO_VALUE] : lines[last].fields[SUBSTR_INFO_VALUE];
+        i = last;
+        WorkSpace *workSpace = GetWorkSpace(&g_paramWorkSpace, name);
+        PARAM_CHECK(workSpace != NULL, continue, "Invalid workspace for %s", name);
+        ParamTrieNode *node = AddParamTriePath(&path, workSpace, name);
+        PARAM_CHECK(node != NULL, continue, "Failed to add node %s", name);
+        PARAM_LOGI("Add default parameter %s  %s", name, value);
         uint32_t dataIndex = 0;
-        ret = WriteParam(&g_paramWorkSpace.paramSpace,
-            info[0].value, info[1].value, &dataIndex, mode & LOAD_PARAM_ONLY_ADD);
-        PARAM_CHECK(ret == 0, continue, "Failed to set param %d %s", ret, buff);
+        int ret = WriteParamToNode(workSpace, node, name, value, &dataIndex, mode & LOAD_PARAM_ONLY_ADD);
+        PARAM_CHECK(ret == 0, continue, "Failed to set param %d %s", ret, name);
         paramNum++;
     }
-    (void)fclose(fp);
-    free(buff);
-    PARAM_LOGI("Load parameters success %s total %u", fileName, paramNum);
+    PARAM_LOGI("Load parameters success total %u", paramNum);
     return 0;
 }
 
@@ -499,27 +893,9 @@ static int OnIncomingConnect(const ParamTaskPtr server, uint32_t flags)
     PARAM_TRIGGER_HEAD_INIT(watcher->triggerHead);
     ListAddTail(&GetTriggerWorkSpace()->waitList, &watcher->node);
     watcher->stream = client;
-    watcher->timeout = UINT32_MAX;
     return 0;
 }
 
-static void TimerCallback(ParamTaskPtr timer, void *context)
-{
-    UNUSED(context);
-    PARAM_CHECK(GetTriggerWorkSpace() != NULL, return, "Invalid wrokspace");
-    ParamWatcher *watcher = GetNextParamWatcher(GetTriggerWorkSpace(), NULL);
-    while (watcher != NULL) {
-        ParamWatcher *next = GetNextParamWatcher(GetTriggerWorkSpace(), watcher);
-        if (watcher->timeout > 0) {
-            watcher->timeout--;
-        } else {
-            PARAM_LOGD("TimerCallback watcher->timeout %p ", watcher);
-            ParamTaskClose(watcher->stream);
-        }
-        watcher = next;
-    }
-}
-
 static int GetParamValueFromBuffer(const char *name, const char *buffer, char *value, int length)
 {
     size_t bootLen = strlen(OHOS_BOOT);
@@ -559,7 +935,7 @@ static int LoadParamFromCmdLine(void)
             PARAM_CHECK(ret == 0, return -1, "Invalid name %s", cmdLines[i]);
             uint32_t dataIndex = 0;
             PARAM_LOGE("**** cmdLines[%d] %s, value %s", i, cmdLines[i], value);
-            ret = WriteParam(&g_paramWorkSpace.paramSpace, cmdLines[i], value, &dataIndex, 0);
+            ret = WriteParam(GetWorkSpace(&g_paramWorkSpace, cmdLines[i]), cmdLines[i], value, &dataIndex, 0);
             PARAM_CHECK(ret == 0, return -1, "Failed to write param %s %s", cmdLines[i], value);
         } else {
             PARAM_LOGE("Can not find arrt %s", cmdLines[i]);
@@ -574,7 +950,13 @@ static int LoadParamFromCmdLine(void)
 int SystemWriteParam(const char *name, const char *value)
 {
     PARAM_CHECK(name != NULL && value != NULL, return -1, "The name is null");
-    return SystemSetParam(name, value, g_paramWorkSpace.securityLabel);
+    return SystemSetParam(name, value, g_paramWorkSpace.securityLabel, NULL);
+}
+
+int SystemDeleteParam(const char *name)
+{
+    PARAM_CHECK(name != NULL, return -1, "The name is null");
+    return SystemDelParam(name, g_paramWorkSpace.securityLabel);
 }
 
 int SystemReadParam(const char *name, char *value, unsigned int *len)
@@ -593,13 +975,6 @@ int LoadPersistParams(void)
     return LoadPersistParam(&g_paramWorkSpace);
 }
 
-static int ProcessParamFile(const char *fileName, void *context)
-{
-    static const char *exclude[] = {"ctl.", "selinux.restorecon_recursive"};
-    uint32_t mode = *(int *)context;
-    return LoadDefaultParam_(fileName, mode, exclude, ARRAY_LENGTH(exclude));
-}
-
 int LoadDefaultParams(const char *fileName, uint32_t mode)
 {
     PARAM_CHECK(fileName != NULL, return -1, "Invalid fielname for load");
@@ -607,13 +982,14 @@ int LoadDefaultParams(const char *fileName, uint32_t mode)
         return PARAM_CODE_NOT_INIT;
     }
     PARAM_LOGI("load default parameters %s.", fileName);
-    int ret = 0;
-    struct stat st;
-    if ((stat(fileName, &st) == 0) && !S_ISDIR(st.st_mode)) {
-        ret = ProcessParamFile(fileName, &mode);
-    } else {
-        ret = ReadFileInDir(fileName, ".para", ProcessParamFile, &mode);
-    }
+    ParamFileLoader loader = {};
+    loader.ext = ".para";
+    loader.delimiter = '=';
+    loader.fieldCount = SUBSTR_INFO_VALUE + 1;
+    loader.checkLine = CheckDefaultParamLine;
+    loader.loadLines = LoadDefaultParamLines;
+    loader.context = &mode;
+    int ret = LoadParamFiles(fileName, &loader);
 
     // load security label
     ParamSecurityOps *ops = &g_paramWorkSpace.paramSecurityOps;
@@ -623,6 +999,43 @@ int LoadDefaultParams(const char *fileName, uint32_t mode)
     return ret;
 }
 
+static int AddDefaultSecurityLabel(void)
+{
+    ParamAuditData auditData = {};
+    auditData.name = "#";
+    auditData.label = NULL;
+    auditData.dacData.gid = getegid();
+    auditData.dacData.uid = geteuid();
+    auditData.dacData.mode = DAC_ALL_PERMISSION;
+    return AddSecurityLabel(&auditData, (void *)&g_paramWorkSpace);
+}
+
+int SaveParamImage(const char *fileName, const char *paths[], unsigned int count)
+{
+    PARAM_CHECK(fileName != NULL, return -1, "Invalid fielname for image");
+    if (!PARAM_TEST_FLAG(g_paramWorkSpace.flags, WORKSPACE_FLAGS_INIT)) {
+        return PARAM_CODE_NOT_INIT;
+    }
+    return SaveParamImageAreas(&g_paramWorkSpace, fileName, NULL, paths, count);
+}
+
+int LoadParamImage(const char *fileName)
+{
+    PARAM_CHECK(fileName != NULL, return -1, "Invalid fielname for image");
+    if (!PARAM_TEST_FLAG(g_paramWorkSpace.flags, WORKSPACE_FLAGS_INIT)) {
+        return PARAM_CODE_NOT_INIT;
+    }
+    int ret = LoadParamImageAreas(&g_paramWorkSpace, fileName);
+    if (ret != 0) {
+        return ret;
+    }
+    // the image replaces the areas, the label of init and the cmdline are applied again
+    ret = AddDefaultSecurityLabel();
+    PARAM_CHECK(ret == 0, return ret, "Failed to add default dac label");
+    LoadParamFromCmdLine();
+    return 0;
+}
+
 void InitParamService(void)
 {
     PARAM_LOGI("InitParamService pipe: %s.", PIPE_NAME);
@@ -645,19 +1058,12 @@ void InitParamService(void)
 
     if (g_paramWorkSpace.timer == NULL) {
         ParamTimerCreate(&g_paramWorkSpace.timer, TimerCallback, &g_paramWorkSpace);
-        ParamTimerStart(g_paramWorkSpace.timer, 1, MS_UNIT);
-        PARAM_LOGD("Start timer %p", g_paramWorkSpace.timer);
+        PARAM_LOGD("Create timer %p", g_paramWorkSpace.timer);
     }
     ret = InitTriggerWorkSpace();
     PARAM_CHECK(ret == 0, return, "Failed to init trigger");
 
-    ParamAuditData auditData = {};
-    auditData.name = "#";
-    auditData.label = NULL;
-    auditData.dacData.gid = getegid();
-    auditData.dacData.uid = geteuid();
-    auditData.dacData.mode = DAC_ALL_PERMISSION;
-    ret = AddSecurityLabel(&auditData, (void *)&g_paramWorkSpace);
+    ret = AddDefaultSecurityLabel();
     PARAM_CHECK(ret == 0, return, "Failed to add default dac label");
 
     // 读取cmdline的参数
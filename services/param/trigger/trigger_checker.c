@@ -17,35 +17,28 @@
 
 #include <ctype.h>
 #include "init_param.h"
+#include "param_manager.h"
 #include "trigger_manager.h"
 
 #define MAX_CALC_PARAM 100
 // 申请整块能存作为计算的节点
-int CalculatorInit(LogicCalculator *calculator, int dataNumber, int dataUnit, int needCondition)
+int CalculatorInit(LogicCalculator *calculator, int dataNumber, int dataUnit, int needInput)
 {
     PARAM_CHECK(calculator != NULL, return -1, "Invalid param");
-    PARAM_CHECK(dataUnit <= (int)sizeof(LogicData), return -1, "Invalid param");
     PARAM_CHECK(dataNumber <= MAX_CALC_PARAM, return -1, "Invalid param");
-    int dataSize = dataUnit * dataNumber;
-    if (needCondition) {
-        dataSize += MAX_DATA_BUFFER_MAX;
+    calculator->data = NULL;
+    if (dataNumber > 0) {
+        calculator->data = (char *)malloc(dataUnit * dataNumber);
+        PARAM_CHECK(calculator->data != NULL, return -1, "Failed to malloc for calculator");
     }
-    calculator->data = (char *)malloc(dataSize);
-    PARAM_CHECK(calculator->data != NULL, return -1, "Failed to malloc for calculator");
     calculator->dataNumber = dataNumber;
     calculator->endIndex = 0;
     calculator->dataUnit = dataUnit;
 
-    dataSize = dataUnit * dataNumber;
-    calculator->conditionName = calculator->data + dataSize;
-    dataSize += SUPPORT_DATA_BUFFER_MAX;
-    calculator->conditionContent = calculator->data + dataSize;
-    dataSize += SUPPORT_DATA_BUFFER_MAX;
-    calculator->inputName = calculator->data + dataSize;
-    dataSize += SUPPORT_DATA_BUFFER_MAX;
-    calculator->inputContent = calculator->data + dataSize;
-    dataSize += SUPPORT_DATA_BUFFER_MAX;
-    calculator->readContent = calculator->data + dataSize;
+    calculator->inputBuffer[0] = '\0';
+    calculator->inputBuffer[SUPPORT_DATA_BUFFER_MAX] = '\0';
+    calculator->inputName = needInput ? calculator->inputBuffer : NULL;
+    calculator->inputContent = needInput ? calculator->inputBuffer + SUPPORT_DATA_BUFFER_MAX : NULL;
     return memset_s(calculator->triggerContent,
         sizeof(calculator->triggerContent), 0, sizeof(calculator->triggerContent));
 }
@@ -57,12 +50,6 @@ void CalculatorFree(LogicCalculator *calculator)
     calculator->data = NULL;
 }
 
-static void CalculatorClear(LogicCalculator *calculator)
-{
-    PARAM_CHECK(calculator != NULL, return, "Invalid param");
-    calculator->endIndex = 0;
-}
-
 static int CalculatorPushChar(LogicCalculator *calculator, char data)
 {
     PARAM_CHECK(calculator != NULL, return -1, "Invalid param");
@@ -83,31 +70,6 @@ static int CalculatorPopChar(LogicCalculator *calculator, char *data)
     return 0;
 }
 
-static int CalculatorPush(LogicCalculator *calculator, const void *data)
-{
-    PARAM_CHECK(calculator != NULL, return -1, "Invalid param");
-    PARAM_CHECK(calculator->endIndex < calculator->dataNumber, return -1, "More data for calculator support");
-    char *tmpData = (char *)calculator->data + calculator->dataUnit * calculator->endIndex;
-    int ret = memcpy_s(tmpData, calculator->dataUnit, data, calculator->dataUnit);
-    PARAM_CHECK(ret == EOK, return -1, "Failed to copy logic data");
-    calculator->endIndex++;
-    return 0;
-}
-
-static int CalculatorPop(LogicCalculator *calculator, void *data)
-{
-    PARAM_CHECK(calculator != NULL && data != NULL, return -1, "Invalid param");
-    PARAM_CHECK(calculator->endIndex < calculator->dataNumber, return -1, "More data for calculator support");
-    if (calculator->endIndex == 0) {
-        return -1;
-    }
-    char *tmpData = (char *)calculator->data + calculator->dataUnit * (calculator->endIndex - 1);
-    int ret = memcpy_s(data, calculator->dataUnit, tmpData, calculator->dataUnit);
-    PARAM_CHECK(ret == EOK, return -1, "Failed to copy logic data");
-    calculator->endIndex--;
-    return 0;
-}
-
 static int CalculatorLength(const LogicCalculator *calculator)
 {
     PARAM_CHECK(calculator != NULL, return 0, "Invalid param");
@@ -161,40 +123,6 @@ static int CompareValue(const char *condition, const char *value)
     return 0;
 }
 
-static int ComputeSubCondition(const LogicCalculator *calculator, LogicData *data, const char *condition)
-{
-    if (!LOGIC_DATA_TEST_FLAG(data, LOGIC_DATA_FLAGS_ORIGINAL)) {
-        return LOGIC_DATA_TEST_FLAG(data, LOGIC_DATA_FLAGS_TRUE);
-    }
-    uint32_t triggerContentSize = strlen(calculator->triggerContent);
-    // 解析条件, aaaa && bbb=1 && ccc=1的场景
-    char *subStr = strstr(condition + data->startIndex, "=");
-    if (subStr != NULL && ((uint32_t)(subStr - condition) > data->endIndex)) {
-        if (strncmp(condition + data->startIndex, calculator->triggerContent, triggerContentSize) == 0) {
-            return 1;
-        }
-        return 0;
-    }
-    int ret = GetValueFromContent(condition + data->startIndex,
-        data->endIndex - data->startIndex, 0, calculator->conditionName, SUPPORT_DATA_BUFFER_MAX);
-    PARAM_CHECK(ret == 0, return -1, "Failed parse content name");
-    ret = GetValueFromContent(condition + data->startIndex, data->endIndex - data->startIndex,
-        strlen(calculator->conditionName) + 1, calculator->conditionContent, SUPPORT_DATA_BUFFER_MAX);
-    PARAM_CHECK(ret == 0, return -1, "Failed parse content value");
-    // check name
-    if ((calculator->inputName != NULL) && (strcmp(calculator->conditionName, calculator->inputName) == 0)) {
-        return CompareValue(calculator->conditionContent, calculator->inputContent);
-    } else if (calculator->conditionName != NULL && strlen(calculator->conditionName) > 0) {
-        uint32_t len = SUPPORT_DATA_BUFFER_MAX;
-        ret = SystemReadParam(calculator->conditionName, calculator->readContent, &len);
-        if (ret != 0) {
-            return 0;
-        }
-        return CompareValue(calculator->conditionContent, calculator->readContent);
-    }
-    return 0;
-}
-
 int GetValueFromContent(const char *content, uint32_t contentSize, uint32_t start, char *value, uint32_t valueSize)
 {
     uint32_t contentIndex = start;
@@ -213,58 +141,6 @@ int GetValueFromContent(const char *content, uint32_t contentSize, uint32_t star
     return -1;
 }
 
-int ComputeCondition(LogicCalculator *calculator, const char *condition)
-{
-    PARAM_CHECK(calculator != NULL && condition != NULL, return -1, "Invalid calculator");
-    uint32_t currIndex = 0;
-    uint32_t start = 0;
-    int noneOper = 1;
-    CalculatorClear(calculator);
-    LogicData data1 = {};
-    LogicData data2 = {};
-    while (currIndex < strlen(condition)) {
-        if (condition[currIndex] == '|' || condition[currIndex] == '&') {
-            noneOper = 0;
-            int ret = CalculatorPop(calculator, (void*)&data2);
-            int ret1 = CalculatorPop(calculator, (void*)&data1);
-            PARAM_CHECK((ret == 0 && ret1 == 0), return -1, "Failed to pop data");
-
-            ret = ComputeSubCondition(calculator, &data1, condition);
-            data1.flags = 0;
-            if (condition[currIndex] == '|' && ret == 1) {
-                LOGIC_DATA_SET_FLAG(&data1, LOGIC_DATA_FLAGS_TRUE);
-            } else if ((condition[currIndex] == '|' || ret == 1) &&
-                (ComputeSubCondition(calculator, &data2, condition) == 1)) {
-                LOGIC_DATA_SET_FLAG(&data1, LOGIC_DATA_FLAGS_TRUE);
-            }
-            ret = CalculatorPush(calculator, (void *)&data1);
-            PARAM_CHECK(ret == 0, return -1, "Failed to push data");
-            start = currIndex + 1; // 跳过符号
-        } else if (isspace(condition[currIndex])) {
-            if (start == currIndex) {
-                start = ++currIndex;
-                continue;
-            }
-            data1.flags = LOGIC_DATA_FLAGS_ORIGINAL;
-            data1.startIndex = start;
-            data1.endIndex = currIndex;
-            int ret = CalculatorPush(calculator, (void *)&data1);
-            PARAM_CHECK(ret == 0, return -1, "Failed to push data");
-            start = currIndex + 1;
-        }
-        currIndex++;
-    }
-    if (noneOper) {
-        data1.flags = LOGIC_DATA_FLAGS_ORIGINAL;
-        data1.startIndex = start;
-        data1.endIndex = strlen(condition);
-    } else {
-        int ret = CalculatorPop(calculator, &data1);
-        PARAM_CHECK(ret == 0, return -1, "Invalid calculator");
-    }
-    return ComputeSubCondition(calculator, &data1, condition);
-}
-
 int ConvertInfixToPrefix(const char *condition, char *prefix, uint32_t prefixLen)
 {
     PARAM_CHECK(condition != NULL, return -1, "Invalid condition");
@@ -319,6 +195,148 @@ int ConvertInfixToPrefix(const char *condition, char *prefix, uint32_t prefixLen
     return 0;
 }
 
+static uint32_t GetConditionTokenCount(const char *condition)
+{
+    uint32_t count = 0;
+    const char *token = condition + strspn(condition, " ");
+    while (*token != '\0') {
+        count++;
+        token += strcspn(token, " ");
+        token += strspn(token, " ");
+    }
+    return count;
+}
+
+static int CopyConditionString(char *strings, uint32_t size, uint16_t *offset, const char *str, uint32_t len)
+{
+    int ret = memcpy_s(strings + *offset, size - *offset, str, len);
+    PARAM_CHECK(ret == EOK, return -1, "Failed to copy condition");
+    *offset += len + 1; // strings are zeroed, the terminator is kept
+    return 0;
+}
+
+static int CompileConditionOperand(ConditionOp *op, const char *token, uint32_t tokenLen,
+    char *strings, uint32_t size, uint16_t *offset)
+{
+    const char *equal = memchr(token, '=', tokenLen);
+    // a word without '=' is the trigger content when a parameter follows, as "boot" in "boot aaa=1 &"
+    if (equal == NULL && strchr(token + tokenLen, '=') != NULL) {
+        op->type = CONDITION_OP_CONTENT;
+        op->name = *offset;
+        return CopyConditionString(strings, size, offset, token, tokenLen);
+    }
+    uint32_t nameLen = (equal != NULL) ? (uint32_t)(equal - token) : tokenLen;
+    op->type = CONDITION_OP_PARAM;
+    op->name = *offset;
+    int ret = CopyConditionString(strings, size, offset, token, nameLen);
+    PARAM_CHECK(ret == 0, return -1, "Failed to copy name");
+    op->value = *offset;
+    if (equal == NULL) {
+        return CopyConditionString(strings, size, offset, "", 0);
+    }
+    return CopyConditionString(strings, size, offset, equal + 1, tokenLen - nameLen - 1);
+}
+
+int CompileCondition(const char *condition, ConditionCode **code)
+{
+    PARAM_CHECK(condition != NULL && code != NULL, return -1, "Invalid condition");
+    uint32_t count = GetConditionTokenCount(condition);
+    uint32_t size = strlen(condition) + count + count + 1; // two terminators at most for every token
+    PARAM_CHECK(size <= UINT16_MAX, return -1, "Condition is too long %s", condition);
+    ConditionCode *result = (ConditionCode *)calloc(1, sizeof(ConditionCode) + count * sizeof(ConditionOp) + size);
+    PARAM_CHECK(result != NULL, return -1, "Failed to alloc memory for condition");
+    char *strings = (char *)&result->op[count];
+    uint16_t offset = 0;
+    uint32_t depth = 0;
+    const char *token = condition + strspn(condition, " ");
+    while (*token != '\0') {
+        uint32_t tokenLen = strcspn(token, " ");
+        ConditionOp *op = &result->op[result->count++];
+        int ret = 0;
+        if (tokenLen == 1 && (token[0] == CONDITION_OP_AND || token[0] == CONDITION_OP_OR)) {
+            op->type = token[0];
+            ret = (depth >= 2) ? 0 : -1; // 2 operands
+            depth--;
+        } else {
+            ret = CompileConditionOperand(op, token, tokenLen, strings, size, &offset);
+            depth++;
+        }
+        PARAM_CHECK(ret == 0 && depth <= MAX_CONDITION_NUMBER, free(result);
+            return -1, "Invalid condition %s", condition);
+        token += tokenLen;
+        token += strspn(token, " ");
+    }
+    PARAM_CHECK(depth <= 1, free(result);
+        return -1, "Invalid condition %s", condition);
+    *code = result;
+    return 0;
+}
+
+static int ComputeParamOperand(LogicCalculator *calculator, ConditionOp *op, const char *strings)
+{
+    const char *name = strings + op->name;
+    const char *value = strings + op->value;
+    if (name[0] == '\0') {
+        return 0;
+    }
+    if (calculator->inputName != NULL && strcmp(name, calculator->inputName) == 0) {
+        return CompareValue(value, calculator->inputContent);
+    }
+    // the handle is kept until the parameter is deleted or its area changes, then resolved again
+    ParamWorkSpace *workSpace = GetParamWorkSpace();
+    if (op->handle != 0 && op->generation != GetParamAreaGeneration(workSpace, PARAM_HANDLE_AREA(op->handle))) {
+        op->handle = 0;
+    }
+    for (int retry = 0; retry < 2; retry++) { // 2 the cached handle, then a new one
+        if (op->handle == 0) {
+            // read before the lookup, so a compaction meanwhile makes the handle stale
+            uint32_t generation = GetParamAreaGeneration(workSpace, GetWorkSpaceIndex(name));
+            ParamHandle handle = 0;
+            if (ReadParamWithCheck(workSpace, name, DAC_READ, &handle) != 0) {
+                return 0;
+            }
+            op->handle = handle;
+            op->generation = generation;
+        }
+        uint32_t len = sizeof(calculator->readContent);
+        if (ReadParamValue(workSpace, op->handle, calculator->readContent, &len) == 0) {
+            return CompareValue(value, calculator->readContent);
+        }
+        op->handle = 0;
+    }
+    return 0;
+}
+
+int ComputeCondition(LogicCalculator *calculator, ConditionCode *code)
+{
+    PARAM_CHECK(calculator != NULL, return -1, "Invalid calculator");
+    if (code == NULL || code->count == 0) {
+        return 0;
+    }
+    // the results are a stack of bits, MAX_CONDITION_NUMBER deep at most
+    const char *strings = (const char *)&code->op[code->count];
+    uint64_t stack = 0;
+    uint32_t depth = 0;
+    for (uint32_t i = 0; i < code->count; i++) {
+        ConditionOp *op = &code->op[i];
+        uint64_t result = 0;
+        if (op->type == CONDITION_OP_AND || op->type == CONDITION_OP_OR) {
+            depth -= 2; // 2 operands
+            uint64_t left = (stack >> depth) & 1;
+            uint64_t right = (stack >> (depth + 1)) & 1;
+            result = (op->type == CONDITION_OP_AND) ? (left & right) : (left | right);
+        } else if (op->type == CONDITION_OP_CONTENT) {
+            uint32_t contentLen = strlen(calculator->triggerContent);
+            result = (strncmp(strings + op->name, calculator->triggerContent, contentLen) == 0) ? 1 : 0;
+        } else {
+            result = (ComputeParamOperand(calculator, op, strings) == 1) ? 1 : 0;
+        }
+        stack = (stack & ~(1ULL << depth)) | (result << depth);
+        depth++;
+    }
+    return (int)(stack & 1);
+}
+
 int CheckMatchSubCondition(const char *condition, const char *input, int length)
 {
     PARAM_CHECK(condition != NULL, return 0, "Invalid condition");
@@ -21,6 +21,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "init_cmds.h"
@@ -68,6 +69,74 @@ CommandNode *GetNextCmdNode(const TriggerNode *trigger, const CommandNode *curr)
     return curr->next;
 }
 
+static ListNode *GetTriggerIndexBucket(const TriggerHeader *triggerHead, const char *name, uint32_t nameLen)
+{
+    return &triggerHead->paramIndex[GetTrieKeyHash(name, nameLen) % TRIGGER_INDEX_BUCKETS];
+}
+
+static int IsTriggerIndexed(const TriggerNode *trigger, const char *name, uint32_t nameLen)
+{
+    const TriggerIndexNode *index = trigger->index;
+    while (index != NULL) {
+        if (strncmp(index->name, name, nameLen) == 0 && index->name[nameLen] == '\0') {
+            return 1;
+        }
+        index = index->next;
+    }
+    return 0;
+}
+
+static int AddTriggerIndex(TriggerHeader *triggerHead, TriggerNode *trigger)
+{
+    if (triggerHead->paramIndex == NULL) {
+        triggerHead->paramIndex = (ListNode *)calloc(TRIGGER_INDEX_BUCKETS, sizeof(ListNode));
+        PARAM_CHECK(triggerHead->paramIndex != NULL, return -1, "Failed to alloc memory for trigger index");
+        for (uint32_t i = 0; i < TRIGGER_INDEX_BUCKETS; i++) {
+            ListInit(&triggerHead->paramIndex[i]);
+        }
+    }
+    // the condition is in prefix form, such as "aaa=1 bbb=* &", every "name=value" refers to a parameter
+    const char *token = trigger->condition;
+    while (*token != '\0') {
+        uint32_t tokenLen = strcspn(token, " ");
+        const char *equal = memchr(token, '=', tokenLen);
+        uint32_t nameLen = (equal != NULL) ? (uint32_t)(equal - token) : 0;
+        if (nameLen > 0 && !IsTriggerIndexed(trigger, token, nameLen)) {
+            TriggerIndexNode *index = (TriggerIndexNode *)calloc(1, sizeof(TriggerIndexNode) + nameLen + 1);
+            PARAM_CHECK(index != NULL, return -1, "Failed to alloc memory for trigger index");
+            int ret = memcpy_s(index->name, nameLen + 1, token, nameLen);
+            PARAM_CHECK(ret == EOK, free(index);
+                return -1, "Failed to copy index name");
+            index->name[nameLen] = '\0';
+            index->trigger = trigger;
+            index->next = trigger->index;
+            trigger->index = index;
+            ListAddTail(GetTriggerIndexBucket(triggerHead, token, nameLen), &index->node);
+        }
+        token += tokenLen;
+        token += strspn(token, " ");
+    }
+    return 0;
+}
+
+static TriggerIndexNode *GetNextTriggerIndex(const TriggerHeader *triggerHead,
+    const char *name, const TriggerIndexNode *curr)
+{
+    if (triggerHead->paramIndex == NULL) {
+        return NULL;
+    }
+    ListNode *bucket = GetTriggerIndexBucket(triggerHead, name, strlen(name));
+    ListNode *node = (curr != NULL) ? curr->node.next : bucket->next;
+    while (node != bucket) {
+        TriggerIndexNode *index = ListEntry(node, TriggerIndexNode, node);
+        if (strcmp(index->name, name) == 0) {
+            return index;
+        }
+        node = node->next;
+    }
+    return NULL;
+}
+
 TriggerNode *AddTrigger(TriggerHeader *triggerHead, const char *name, const char *condition, uint16_t extDataSize)
 {
     PARAM_CHECK(triggerHead != NULL && name != NULL, return NULL, "triggerHead is null");
@@ -92,6 +161,10 @@ TriggerNode *AddTrigger(TriggerHeader *triggerHead, const char *name, const char
         PARAM_CHECK(ret == 0, free(node);
             return NULL, "Failed to convert condition for trigger");
         node->condition = cond;
+        // the trigger can still be executed by name when its condition is invalid
+        if (CompileCondition(cond, &node->code) != 0) {
+            PARAM_LOGE("Failed to compile condition %s for trigger %s", condition, name);
+        }
     }
     node->flags = 0;
     node->firstCmd = NULL;
@@ -102,6 +175,11 @@ TriggerNode *AddTrigger(TriggerHeader *triggerHead, const char *name, const char
     node->extDataOffset = triggerNodeLen + conditionLen;
     ListAddTail(&triggerHead->triggerList, &node->node);
     triggerHead->triggerCount++;
+    if (node->condition != NULL) {
+        ret = AddTriggerIndex(triggerHead, node);
+        PARAM_CHECK(ret == 0, FreeTrigger(node);
+            return NULL, "Failed to index trigger %s", name);
+    }
     return node;
 }
 
@@ -119,6 +197,70 @@ void ClearTrigger(TriggerHeader *head)
     ListInit(&head->triggerList);
 }
 
+static void SwapWaitTimeout(TriggerWorkSpace *workSpace, uint32_t i, uint32_t j)
+{
+    WaitTimeout tmp = workSpace->waitTimeout[i];
+    workSpace->waitTimeout[i] = workSpace->waitTimeout[j];
+    workSpace->waitTimeout[j] = tmp;
+    workSpace->waitTimeout[i].trigger->timeoutIndex = i + 1;
+    workSpace->waitTimeout[j].trigger->timeoutIndex = j + 1;
+}
+
+static void SiftWaitTimeout(TriggerWorkSpace *workSpace, uint32_t index)
+{
+    WaitTimeout *heap = workSpace->waitTimeout;
+    while (index > 0 && heap[(index - 1) / 2].deadline > heap[index].deadline) { // 2 children per node
+        SwapWaitTimeout(workSpace, index, (index - 1) / 2);
+        index = (index - 1) / 2;
+    }
+    while (1) {
+        uint32_t min = index;
+        uint32_t left = index * 2 + 1;
+        if (left < workSpace->waitTimeoutCount && heap[left].deadline < heap[min].deadline) {
+            min = left;
+        }
+        if (left + 1 < workSpace->waitTimeoutCount && heap[left + 1].deadline < heap[min].deadline) {
+            min = left + 1;
+        }
+        if (min == index) {
+            break;
+        }
+        SwapWaitTimeout(workSpace, index, min);
+        index = min;
+    }
+}
+
+static int AddWaitTimeout(TriggerWorkSpace *workSpace, TriggerNode *trigger, uint64_t deadline)
+{
+    if (workSpace->waitTimeoutCount >= workSpace->waitTimeoutSize) {
+        uint32_t size = (workSpace->waitTimeoutSize == 0) ? WAIT_TIMEOUT_INIT_SIZE : workSpace->waitTimeoutSize * 2;
+        WaitTimeout *heap = (WaitTimeout *)realloc(workSpace->waitTimeout, size * sizeof(WaitTimeout));
+        PARAM_CHECK(heap != NULL, return -1, "Failed to alloc memory for wait timeout");
+        workSpace->waitTimeout = heap;
+        workSpace->waitTimeoutSize = size;
+    }
+    uint32_t index = workSpace->waitTimeoutCount;
+    workSpace->waitTimeoutCount++;
+    workSpace->waitTimeout[index].deadline = deadline;
+    workSpace->waitTimeout[index].trigger = trigger;
+    trigger->timeoutIndex = index + 1;
+    SiftWaitTimeout(workSpace, index);
+    return 0;
+}
+
+static void DelWaitTimeout(TriggerWorkSpace *workSpace, TriggerNode *trigger)
+{
+    uint32_t index = trigger->timeoutIndex - 1;
+    trigger->timeoutIndex = 0;
+    workSpace->waitTimeoutCount--;
+    if (index == workSpace->waitTimeoutCount) {
+        return;
+    }
+    workSpace->waitTimeout[index] = workSpace->waitTimeout[workSpace->waitTimeoutCount];
+    workSpace->waitTimeout[index].trigger->timeoutIndex = index + 1;
+    SiftWaitTimeout(workSpace, index);
+}
+
 void FreeTrigger(TriggerNode *trigger)
 {
     PARAM_CHECK(trigger != NULL && trigger->triggerHead != NULL, return, "trigger is null");
@@ -133,8 +275,23 @@ void FreeTrigger(TriggerNode *trigger)
     }
     trigger->lastCmd = NULL;
     trigger->firstCmd = NULL;
+    free(trigger->code);
+    trigger->code = NULL;
+    while (trigger->index != NULL) {
+        TriggerIndexNode *index = trigger->index;
+        trigger->index = index->next;
+        ListRemove(&index->node);
+        free(index);
+    }
+    if (trigger->timeoutIndex != 0) {
+        DelWaitTimeout(GetTriggerWorkSpace(), trigger);
+    }
     ListRemove(&trigger->node);
     triggerHead->triggerCount--;
+    if (triggerHead->triggerCount == 0) {
+        free(triggerHead->paramIndex);
+        triggerHead->paramIndex = NULL;
+    }
 
     // 如果在执行队列，从队列中移走
     if (!TRIGGER_IN_QUEUE(trigger)) {
@@ -250,16 +407,33 @@ static int CheckParamTriggerMatch(TriggerWorkSpace *workSpace, LogicCalculator *
             return 0;
         }
     }
-    return ComputeCondition(calculator, condition);
+    return ComputeCondition(calculator, trigger->code);
 }
 
 static int CheckOtherTriggerMatch(TriggerWorkSpace *workSpace, LogicCalculator *calculator,
     TriggerNode *trigger, const char *content, uint32_t contentSize)
 {
+    UNUSED(workSpace);
     UNUSED(content);
     UNUSED(contentSize);
-    const char *condition = GetTriggerCondition(workSpace, trigger);
-    return ComputeCondition(calculator, condition);
+    return ComputeCondition(calculator, trigger->code);
+}
+
+static int CheckParamTriggerIndex(TriggerWorkSpace *workSpace, const TriggerHeader *triggerHead,
+    LogicCalculator *calculator, const char *content, uint32_t contentSize)
+{
+    UNUSED(workSpace);
+    // the names of one trigger are unique, so the next match belongs to another trigger and survives a free
+    TriggerIndexNode *index = GetNextTriggerIndex(triggerHead, calculator->inputName, NULL);
+    while (index != NULL) {
+        TriggerIndexNode *next = GetNextTriggerIndex(triggerHead, calculator->inputName, index);
+        TriggerNode *trigger = index->trigger;
+        if (ComputeCondition(calculator, trigger->code) == 1) {
+            calculator->triggerExecuter(trigger, content, contentSize);
+        }
+        index = next;
+    }
+    return 0;
 }
 
 static int CheckParamWaitMatch(TriggerWorkSpace *workSpace, int type,
@@ -268,14 +442,7 @@ static int CheckParamWaitMatch(TriggerWorkSpace *workSpace, int type,
     UNUSED(type);
     ParamWatcher *watcher = GetNextParamWatcher(workSpace, NULL);
     while (watcher != NULL) {
-        TriggerNode *trigger = GetNextTrigger(&watcher->triggerHead, NULL);
-        while (trigger != NULL) {
-            TriggerNode *next = GetNextTrigger(&watcher->triggerHead, trigger);
-            if (CheckParamTriggerMatch(workSpace, calculator, trigger, content, contentSize) == 1) {
-                calculator->triggerExecuter(trigger, content, contentSize);
-            }
-            trigger = next;
-        }
+        CheckParamTriggerIndex(workSpace, &watcher->triggerHead, calculator, content, contentSize);
         watcher = GetNextParamWatcher(workSpace, watcher);
     }
     return 0;
@@ -307,6 +474,9 @@ static int CheckTrigger_(TriggerWorkSpace *workSpace,
     PARAM_CHECK((uint32_t)type < sizeof(triggerCheckMatch) / sizeof(triggerCheckMatch[0]),
         return -1, "Failed to get check function");
     PARAM_CHECK(triggerCheckMatch[type] != NULL, return -1, "Failed to get check function");
+    if (type == TRIGGER_PARAM && calculator->inputName != NULL) {
+        return CheckParamTriggerIndex(workSpace, &workSpace->triggerHead[type], calculator, content, contentSize);
+    }
 
     TriggerNode *trigger = GetNextTrigger(&workSpace->triggerHead[type], NULL);
     while (trigger != NULL) {
@@ -326,7 +496,7 @@ int CheckTrigger(TriggerWorkSpace *workSpace, int type,
     PARAM_LOGD("CheckTrigger type: %d content: %s ", type, content);
     int ret;
     LogicCalculator calculator;
-    CalculatorInit(&calculator, MAX_CONDITION_NUMBER, sizeof(LogicData), 1);
+    CalculatorInit(&calculator, 0, 0, 1); // conditions are compiled, no stack is needed
     calculator.triggerExecuter = triggerExecuter;
     if (type == TRIGGER_PARAM || type == TRIGGER_PARAM_WAIT) {
         ret = GetValueFromContent(content, contentSize,
@@ -357,19 +527,14 @@ int CheckTrigger(TriggerWorkSpace *workSpace, int type,
 
 int MarkTriggerToParam(const TriggerWorkSpace *workSpace, const TriggerHeader *triggerHead, const char *name)
 {
+    UNUSED(workSpace);
+    PARAM_CHECK(triggerHead != NULL && name != NULL, return 0, "Invalid param");
     int ret = 0;
-    TriggerNode *trigger = GetNextTrigger(triggerHead, NULL);
-    while (trigger != NULL) {
-        if (GetTriggerCondition(workSpace, trigger) == NULL) {
-            trigger = GetNextTrigger(triggerHead, trigger);
-            continue;
-        }
-        const char *tmp = strstr(GetTriggerCondition(workSpace, trigger), name);
-        if (tmp != NULL && strncmp(tmp + strlen(name), "=", 1) == 0) {
-            TRIGGER_SET_FLAG(trigger, TRIGGER_FLAGS_RELATED);
-            ret = 1;
-        }
-        trigger = GetNextTrigger(triggerHead, trigger);
+    TriggerIndexNode *index = GetNextTriggerIndex(triggerHead, name, NULL);
+    while (index != NULL) {
+        TRIGGER_SET_FLAG(index->trigger, TRIGGER_FLAGS_RELATED);
+        ret = 1;
+        index = GetNextTriggerIndex(triggerHead, name, index);
     }
     return ret;
 }
@@ -411,7 +576,13 @@ TriggerNode *AddWatcherTrigger(ParamWatcher *watcher,
     PARAM_CHECK(localData != NULL, return NULL, "Failed to get trigger ext data");
     localData->excuteCmd = extData->excuteCmd;
     localData->watcherId = extData->watcherId;
+    localData->timeout = extData->timeout;
     localData->watcher = watcher;
+    if (triggerType == TRIGGER_PARAM_WAIT) {
+        ret = AddWaitTimeout(GetTriggerWorkSpace(), trigger, GetTriggerTime() + (uint64_t)extData->timeout * MS_UNIT);
+        PARAM_CHECK(ret == 0, FreeTrigger(trigger);
+            return NULL, "Failed to add timeout for %s", name);
+    }
     return trigger;
 }
 
@@ -443,6 +614,28 @@ void ClearWatcherTrigger(const ParamWatcher *watcher)
     }
 }
 
+uint64_t GetTriggerTime(void)
+{
+    struct timespec now = {};
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    const uint64_t nsPerMs = 1000 * 1000;
+    return (uint64_t)now.tv_sec * MS_UNIT + (uint64_t)now.tv_nsec / nsPerMs;
+}
+
+uint64_t CheckWaitTriggerTimeout(TriggerWorkSpace *workSpace, uint64_t now)
+{
+    PARAM_CHECK(workSpace != NULL, return 0, "Invalid workSpace");
+    while (workSpace->waitTimeoutCount > 0 && workSpace->waitTimeout[0].deadline <= now) {
+        TriggerNode *trigger = workSpace->waitTimeout[0].trigger;
+        TriggerExtData *extData = TRIGGER_GET_EXT_DATA(trigger, TriggerExtData);
+        if (extData != NULL && extData->excuteCmd != NULL) {
+            extData->excuteCmd(extData, CMD_INDEX_FOR_PARA_WAIT_TIMEOUT, trigger->name);
+        }
+        FreeTrigger(trigger);
+    }
+    return (workSpace->waitTimeoutCount > 0) ? workSpace->waitTimeout[0].deadline : 0;
+}
+
 static void DumpTriggerQueue(const TriggerWorkSpace *workSpace, int index)
 {
     PARAM_CHECK(workSpace != NULL, return, "Invalid workSpace ");
@@ -386,6 +386,13 @@ void CloseTriggerWorkSpace(void)
     }
     free(g_triggerWorkSpace.executeQueue.executeQueue);
     g_triggerWorkSpace.executeQueue.executeQueue = NULL;
+    for (uint32_t i = 0; i < g_triggerWorkSpace.waitTimeoutCount; i++) {
+        g_triggerWorkSpace.waitTimeout[i].trigger->timeoutIndex = 0;
+    }
+    free(g_triggerWorkSpace.waitTimeout);
+    g_triggerWorkSpace.waitTimeout = NULL;
+    g_triggerWorkSpace.waitTimeoutCount = 0;
+    g_triggerWorkSpace.waitTimeoutSize = 0;
     ParamTaskClose(g_triggerWorkSpace.eventHandle);
     g_triggerWorkSpace.eventHandle = NULL;
 }
@@ -216,26 +216,29 @@ static int FilterParam(const char *name, const std::string &keyPrefix)
 
 void WatcherManager::SendLocalChange(const std::string &keyPrefix, ParamWatcherPtr watcher)
 {
-    struct Context {
-        char *buffer;
-        ParamWatcherPtr watcher;
-        std::string keyPrefix;
-    };
     WATCHER_LOGD("SendLocalChange key %s  ", keyPrefix.c_str());
+    // only walk the sub trie of the last whole segment of the key prefix
+    std::string root = keyPrefix;
+    if (root.rfind("*") == root.length() - 1) {
+        size_t pos = root.rfind(".");
+        root = (pos == std::string::npos) ? "" : root.substr(0, pos);
+    }
+    void *cursor = nullptr;
+    int ret = SystemTraversalParameterBegin(root.empty() ? nullptr : root.c_str(), &cursor);
+    WATCHER_CHECK(ret == 0, return, "Failed to traversal %s", keyPrefix.c_str());
     std::vector<char> buffer(PARAM_NAME_LEN_MAX + PARAM_CONST_VALUE_LEN_MAX);
-    struct Context context = {buffer.data(), watcher, keyPrefix};
-    // walk watcher
-    SystemTraversalParameter([](ParamHandle handle, void *cookie) {
-            struct Context *context = (struct Context *)(cookie);
-            SystemGetParameterName(handle, context->buffer, PARAM_NAME_LEN_MAX);
-            if (!FilterParam(context->buffer, context->keyPrefix)) {
-                return;
-            }
-            uint32_t size = PARAM_CONST_VALUE_LEN_MAX;
-            SystemGetParameterValue(handle, context->buffer + PARAM_NAME_LEN_MAX, &size);
-            WATCHER_LOGD("SendLocalChange key %s value: %s ", context->buffer, context->buffer + PARAM_NAME_LEN_MAX);
-            context->watcher->ProcessParameterChange(context->buffer, context->buffer + PARAM_NAME_LEN_MAX);
-        }, (void *)&context);
+    ParamHandle handle = 0;
+    while (SystemTraversalParameterNext(cursor, &handle) == 0) {
+        SystemGetParameterName(handle, buffer.data(), PARAM_NAME_LEN_MAX);
+        if (!FilterParam(buffer.data(), keyPrefix)) {
+            continue;
+        }
+        uint32_t size = PARAM_CONST_VALUE_LEN_MAX;
+        SystemGetParameterValue(handle, buffer.data() + PARAM_NAME_LEN_MAX, &size);
+        WATCHER_LOGD("SendLocalChange key %s value: %s ", buffer.data(), buffer.data() + PARAM_NAME_LEN_MAX);
+        watcher->ProcessParameterChange(buffer.data(), buffer.data() + PARAM_NAME_LEN_MAX);
+    }
+    SystemTraversalParameterEnd(cursor);
 }
 
 void WatcherManager::RunLoop()
@@ -13,6 +13,8 @@
  * limitations under the License.
  */
 
+#include <poll.h>
+
 #include "init_unittest.h"
 #include "init_utils.h"
 #include "param_request.h"
@@ -205,6 +207,119 @@ void TestClientApi(char testBuffer[], uint32_t size, const char *name, const cha
     EXPECT_EQ(strcmp(testBuffer, value), 0);
 }
 
+static void TestCachedParameter(const char *name, const char *value)
+{
+    char testBuffer[PARAM_BUFFER_SIZE] = { 0 };
+    u_int32_t len = sizeof(testBuffer);
+    CachedHandle handle = CachedParameterCreate(name);
+    EXPECT_NE(handle, nullptr);
+    SystemSetParameter(name, value);
+    int ret = CachedParameterGet(handle, testBuffer, &len);
+    EXPECT_EQ(ret, 0);
+    EXPECT_EQ(strcmp(testBuffer, value), 0);
+    // the cached handle sees the new value
+    SystemSetParameter(name, name);
+    len = sizeof(testBuffer);
+    ret = CachedParameterGet(handle, testBuffer, &len);
+    EXPECT_EQ(ret, 0);
+    EXPECT_EQ(strcmp(testBuffer, name), 0);
+    CachedParameterDestroy(handle);
+    EXPECT_EQ(CachedParameterCreate("&&&&.test.tttt"), nullptr);
+    // fill and hit the cache of parameter names
+    ClientCheckParamValue(name, name);
+    ClientCheckParamValue(name, name);
+}
+
+static void TestGetParameters(const char *name, const char *value)
+{
+    const char *names[] = { name, "persist.111.ffff.bbbb.cccc.dddd.eeee", "test.get.parameters.none" };
+    const uint32_t count = ARRAY_LENGTH(names);
+    char buffers[count][PARAM_BUFFER_SIZE] = { { 0 } };
+    char *values[count] = { buffers[0], buffers[1], buffers[2] };
+    uint32_t lens[count] = { 0 };
+    int ret = SystemSetParameter(name, value);
+    EXPECT_EQ(ret, 0);
+    for (uint32_t j = 0; j < count; j++) {
+        lens[j] = PARAM_BUFFER_SIZE;
+    }
+    ret = SystemGetParameters(names, values, lens, count);
+    EXPECT_EQ(ret, PARAM_CODE_NOT_FOUND);
+    EXPECT_EQ(strcmp(buffers[0], value), 0);
+    EXPECT_EQ(lens[2], 0); // 2 not found
+
+    // the batch returns what the parameters read one by one return
+    for (uint32_t j = 0; j < count; j++) {
+        char single[PARAM_BUFFER_SIZE] = { 0 };
+        uint32_t len = PARAM_BUFFER_SIZE;
+        ret = SystemGetParameter(names[j], single, &len);
+        EXPECT_EQ(ret, (lens[j] == 0) ? PARAM_CODE_NOT_FOUND : 0);
+        if (ret == 0) {
+            EXPECT_EQ(strcmp(buffers[j], single), 0);
+        }
+    }
+}
+
+static void TestSetParameters(const char *name, const char *value)
+{
+    std::string name1 = std::string(name) + ".batch.1";
+    std::string name2 = std::string(name) + ".batch.2";
+    const char *names[] = { name1.c_str(), name2.c_str(), name1.c_str() };
+    const char *values[] = { "1", value, value };
+    const uint32_t count = ARRAY_LENGTH(names);
+    int results[count] = { 0 };
+    int ret = SystemSetParameters(names, values, results, count);
+    EXPECT_EQ(ret, 0);
+    for (uint32_t i = 0; i < count; i++) {
+        EXPECT_EQ(results[i], 0);
+    }
+    ClientCheckParamValue(name1.c_str(), value);
+    ClientCheckParamValue(name2.c_str(), value);
+    // nothing is sent when one of the names is illegal
+    const char *illegal[] = { name1.c_str(), "&&&&.test.tttt" };
+    ret = SystemSetParameters(illegal, values, nullptr, ARRAY_LENGTH(illegal));
+    EXPECT_NE(ret, 0);
+}
+
+static void TestAsyncParameter(const char *name, const char *value)
+{
+    static int result = -1;
+    static int done = 0;
+    ParameterAsyncCallback callback = [](const char *paramName, const char *, int ret, void *context) {
+        EXPECT_STREQ(paramName, (const char *)context);
+        result = ret;
+        done++;
+    };
+    // the event fd is there before the first request and does not change with the connection
+    int eventFd = SystemGetParameterEventFd();
+    EXPECT_GE(eventFd, 0);
+    int ret = SystemSetParameterAsync(name, value, callback, (void *)name);
+    EXPECT_EQ(ret, 0);
+    ret = SystemWaitParameterAsync(name, value, 1, callback, (void *)name);
+    EXPECT_EQ(ret, 0);
+    EXPECT_EQ(SystemGetParameterEventFd(), eventFd);
+    const int maxCount = 100;
+    const int pollTimeout = 50; // 50ms
+    struct pollfd fds = { eventFd, POLLIN, 0 };
+    for (int i = 0; i < maxCount && done < 2; i++) { // 2 set and wait
+        if (poll(&fds, 1, pollTimeout) > 0) {
+            SystemProcessParameterEvents();
+        }
+    }
+    EXPECT_EQ(done, 2);
+    EXPECT_EQ(result, 0);
+    ClientCheckParamValue(name, value);
+}
+
+static void TestWaitParameterLocal(const char *name, const char *value)
+{
+    int ret = SystemSetParameter(name, value);
+    EXPECT_EQ(ret, 0);
+    EXPECT_EQ(SystemWaitParameter(name, value, 1), 0);
+    EXPECT_EQ(SystemWaitParameter(name, "*", 1), 0);
+    EXPECT_EQ(SystemWaitParameter(name, (std::string(value).substr(0, 4) + "*").c_str(), 1), 0); // 4 prefix
+    EXPECT_EQ(SystemWaitParameter(name, "test.wait.other.value", 1), PARAM_CODE_TIMEOUT);
+}
+
 void TestClient(int index)
 {
     char testBuffer[PARAM_BUFFER_SIZE] = { 0 };
@@ -231,6 +346,11 @@ void TestClient(int index)
         }
         case 2: { // 2 api test
             TestClientApi(testBuffer, PARAM_BUFFER_SIZE, name.c_str(), value.c_str());
+            TestCachedParameter((name + ".cached").c_str(), value.c_str());
+            TestGetParameters(name.c_str(), value.c_str());
+            TestSetParameters(name.c_str(), value.c_str());
+            TestAsyncParameter((name + ".async").c_str(), value.c_str());
+            TestWaitParameterLocal((name + ".wait").c_str(), value.c_str());
             break;
         }
         case 3: // 3 Traversal test
@@ -12,10 +12,14 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <grp.h>
 #include <memory>
+#include <pwd.h>
+#include <sys/stat.h>
 
 #include "init_param.h"
 #include "init_unittest.h"
+#include "param_security.h"
 #include "param_stub.h"
 #include "trigger_manager.h"
 
@@ -36,6 +40,79 @@ static int CheckServerParamValue(const char *name, const char *expectValue)
 
 extern "C" {
 extern void TimerCallbackForSave(ParamTaskPtr timer, void *context);
+extern int RegisterSecurityDacOps(ParamSecurityOps *ops, int isInit);
+extern void OnReceiveAlloc(uv_handle_t *handle, size_t suggestedSize, uv_buf_t *buf);
+extern void OnReceiveRequest(uv_stream_t *handle, ssize_t nread, const uv_buf_t *buf);
+}
+
+static const uint32_t RECEIVE_MSG_COUNT = 3;
+static uint32_t g_receivedIds[RECEIVE_MSG_COUNT] = { 0 };
+static uint32_t g_receivedCount = 0;
+
+static int RecordReceivedMessage(const ParamTaskPtr stream, const ParamMessage *msg)
+{
+    (void)stream;
+    if (g_receivedCount < RECEIVE_MSG_COUNT) {
+        g_receivedIds[g_receivedCount] = msg->id.msgId;
+    }
+    g_receivedCount++;
+    return 0;
+}
+
+// 模拟一次读取，数据写入OnReceiveAlloc分配的缓冲区
+static void FeedStreamTask(LibuvStreamTask *client, const char *data, uint32_t size)
+{
+    uv_buf_t buf = {};
+    OnReceiveAlloc((uv_handle_t *)&client->stream.pipe, size, &buf);
+    ASSERT_NE(buf.base, nullptr);
+    ASSERT_GE(buf.len, size);
+    (void)memcpy_s(buf.base, buf.len, data, size);
+    OnReceiveRequest((uv_stream_t *)&client->stream.pipe, size, &buf);
+}
+
+static bool IsLocalGroup(gid_t gid)
+{
+    gid_t groups[PARAM_BUFFER_SIZE] = { 0 };
+    int num = getgroups(PARAM_BUFFER_SIZE, groups);
+    for (int i = 0; i < num; i++) {
+        if (groups[i] == gid) {
+            return true;
+        }
+    }
+    return gid == getegid();
+}
+
+// 查找属于某个组的用户：组成员列表中的用户或与组同名的用户，跳过本进程所在的组
+static bool GetGroupMember(gid_t *gid, uid_t *uid)
+{
+    FILE *fpForGroup = fopen(GROUP_FILE_PATH, "r");
+    FILE *fpForUser = fopen(USER_FILE_PATH, "r");
+    bool found = false;
+    struct group *group = nullptr;
+    while (fpForGroup != nullptr && fpForUser != nullptr && !found && (group = fgetgrent(fpForGroup)) != nullptr) {
+        if (IsLocalGroup(group->gr_gid)) {
+            continue;
+        }
+        struct passwd *user = nullptr;
+        (void)fseek(fpForUser, 0, SEEK_SET);
+        while (!found && (user = fgetpwent(fpForUser)) != nullptr) {
+            found = strcmp(user->pw_name, group->gr_name) == 0;
+            for (int i = 0; !found && group->gr_mem[i] != nullptr; i++) {
+                found = strcmp(user->pw_name, group->gr_mem[i]) == 0;
+            }
+            if (found) {
+                *gid = group->gr_gid;
+                *uid = user->pw_uid;
+            }
+        }
+    }
+    if (fpForGroup != nullptr) {
+        (void)fclose(fpForGroup);
+    }
+    if (fpForUser != nullptr) {
+        (void)fclose(fpForUser);
+    }
+    return found;
 }
 
 static ParamTask *g_worker = nullptr;
@@ -261,6 +338,333 @@ public:
         return 0;
     }
 
+    int TestWorkSpaceExtend()
+    {
+        const int paramCount = 1000;
+        WorkSpace *workSpace = &GetParamWorkSpace()->paramSpace;
+        uint32_t dataSize = workSpace->area->dataSize;
+        char name[PARAM_NAME_LEN_MAX] = { 0 };
+        for (int i = 0; i < paramCount; i++) {
+            int ret = sprintf_s(name, sizeof(name), "extend.test.%d.aaaa.bbbb", i);
+            PARAM_CHECK(ret > 0, return -1, "Failed to format name");
+            ret = SystemWriteParam(name, "extend");
+            EXPECT_EQ(ret, 0);
+        }
+        EXPECT_GT(workSpace->area->dataSize, dataSize);
+        EXPECT_LE(workSpace->area->dataSize + sizeof(ParamTrieHeader), workSpace->spaceSizeMax);
+        CheckServerParamValue("extend.test.0.aaaa.bbbb", "extend");
+        CheckServerParamValue("extend.test.999.aaaa.bbbb", "extend");
+        return 0;
+    }
+
+    int TestParamValueSlot()
+    {
+        WorkSpace *workSpace = &GetParamWorkSpace()->paramSpace;
+        const char *name = "test.value.slot.aaaa";
+        // a short value takes its size class only
+        uint32_t currOffset = workSpace->area->currOffset;
+        uint32_t offset = AddParamNode(workSpace, name, strlen(name), "1", 1);
+        EXPECT_NE(offset, 0);
+        EXPECT_LT(workSpace->area->currOffset - currOffset, sizeof(ParamNode) + strlen(name) + PARAM_VALUE_LEN_MAX);
+
+        EXPECT_EQ(SystemWriteParam(name, "1"), 0);
+        ParamTrieNode *node = FindTrieNode(workSpace, name, strlen(name), NULL);
+        PARAM_CHECK(node != NULL, return -1, "Failed to find %s", name);
+        ParamNode *entry = (ParamNode *)GetTrieNode(workSpace, node->dataIndex);
+        PARAM_CHECK(entry != NULL, return -1, "Failed to find %s", name);
+        EXPECT_EQ(atomic_load(&entry->valueIndex), 0);
+
+        // a longer value moves to a slot, and back to the node when it fits again
+        std::string value(PARAM_VALUE_LEN_MAX - 1, 'a');
+        EXPECT_EQ(SystemWriteParam(name, value.c_str()), 0);
+        uint32_t valueIndex = atomic_load(&entry->valueIndex);
+        EXPECT_NE(valueIndex, 0);
+        CheckServerParamValue(name, value.c_str());
+        EXPECT_EQ(SystemWriteParam(name, "2"), 0);
+        EXPECT_EQ(atomic_load(&entry->valueIndex), 0);
+        CheckServerParamValue(name, "2");
+
+        // the freed slot is used again
+        currOffset = workSpace->area->currOffset;
+        EXPECT_EQ(SystemWriteParam(name, value.c_str()), 0);
+        EXPECT_EQ(atomic_load(&entry->valueIndex), valueIndex);
+        EXPECT_EQ(workSpace->area->currOffset, currOffset);
+        CheckServerParamValue(name, value.c_str());
+        return 0;
+    }
+
+    int TestWorkSpaceArea()
+    {
+        const char *name = "vendor.area.test.aaaa.bbbb";
+        int ret = SystemWriteParam(name, "vendor");
+        EXPECT_EQ(ret, 0);
+        WorkSpace *space = GetWorkSpace(GetParamWorkSpace(), name);
+        EXPECT_NE(space, &GetParamWorkSpace()->paramSpace);
+        ParamTrieNode *node = FindTrieNode(space, name, strlen(name), nullptr);
+        EXPECT_NE(node, nullptr);
+        node = FindTrieNode(&GetParamWorkSpace()->paramSpace, name, strlen(name), nullptr);
+        EXPECT_EQ(node, nullptr);
+
+        ParamHandle handle = 0;
+        ret = ReadParamWithCheck(GetParamWorkSpace(), name, DAC_READ, &handle);
+        EXPECT_EQ(ret, 0);
+        EXPECT_EQ(PARAM_HANDLE_AREA(handle), GetWorkSpaceIndex(name));
+
+        // labels of the parent prefix are visible in the area
+        uint32_t labelIndex = 0;
+        FindTrieNode(space, name, strlen(name), &labelIndex);
+        EXPECT_NE(labelIndex, 0);
+        EXPECT_EQ(CheckLabelInWorkSpace(GetWorkSpaceIndex(name), "#"), 1);
+        EXPECT_EQ(CheckLabelInWorkSpace(GetWorkSpaceIndex(name), "vendor"), 1);
+        EXPECT_EQ(CheckLabelInWorkSpace(GetWorkSpaceIndex(name), "vendor.area."), 1);
+        EXPECT_EQ(CheckLabelInWorkSpace(GetWorkSpaceIndex(name), "vend"), 0);
+        EXPECT_EQ(CheckLabelInWorkSpace(PARAM_AREA_DEFAULT, "vendor.area."), 0);
+        CheckServerParamValue(name, "vendor");
+        return 0;
+    }
+
+    int TestTrieArray()
+    {
+        WorkSpace space = {};
+        space.trieType = PARAM_TRIE_ARRAY;
+        int ret = InitWorkSpace(PARAM_DEFAULT_PATH"/__parameters__/trie_array", &space, 0);
+        EXPECT_EQ(ret, 0);
+        EXPECT_EQ(space.area->trieType, PARAM_TRIE_ARRAY);
+        const int nodeCount = 100;
+        char name[PARAM_NAME_LEN_MAX] = { 0 };
+        for (int i = 0; i < nodeCount; i++) {
+            ret = sprintf_s(name, sizeof(name), "array.test.%d.aaaa.bbbb", nodeCount - i);
+            PARAM_CHECK(ret > 0, return -1, "Failed to format name");
+            ParamTrieNode *node = AddTrieNode(&space, name, strlen(name));
+            EXPECT_NE(node, nullptr);
+        }
+        for (int i = 0; i < nodeCount; i++) {
+            ret = sprintf_s(name, sizeof(name), "array.test.%d.aaaa.bbbb", nodeCount - i);
+            PARAM_CHECK(ret > 0, return -1, "Failed to format name");
+            ParamTrieNode *node = FindTrieNode(&space, name, strlen(name), nullptr);
+            EXPECT_NE(node, nullptr);
+            EXPECT_EQ(strcmp(node->key, "bbbb"), 0);
+        }
+        ParamTrieNode *node = FindTrieNode(&space, "array.test.0.aaaa", strlen("array.test.0.aaaa"), nullptr);
+        EXPECT_EQ(node, nullptr);
+        node = FindTrieNode(&space, "array.test", strlen("array.test"), nullptr);
+        EXPECT_NE(node, nullptr);
+        int count = 0;
+        TraversalTrieNode(&space, node, [](const WorkSpace *, const ParamTrieNode *, void *cookie) {
+                (*(int *)cookie)++;
+                return 0;
+            }, &count);
+        EXPECT_EQ(count, nodeCount * 3 + 1); // 3 node for every name
+        CloseWorkSpace(&space);
+        return 0;
+    }
+
+    int TestParamCursor()
+    {
+        const int paramCount = 20;
+        char name[PARAM_NAME_LEN_MAX] = { 0 };
+        for (int i = 0; i < paramCount; i++) {
+            int ret = sprintf_s(name, sizeof(name), "cursor.test.%d.aaaa", i);
+            PARAM_CHECK(ret > 0, return -1, "Failed to format name");
+            ret = SystemWriteParam(name, "cursor");
+            EXPECT_EQ(ret, 0);
+        }
+        const char *prefixs[] = { "cursor.test", "cursor.test.", "cursor.test.1.aaaa", "cursor.none" };
+        const int counts[] = { paramCount, paramCount, 1, 0 };
+        for (size_t i = 0; i < sizeof(prefixs) / sizeof(prefixs[0]); i++) {
+            ParamCursor cursor;
+            int ret = ParamCursorBegin(&cursor, GetParamWorkSpace(), prefixs[i]);
+            EXPECT_EQ(ret, 0);
+            int count = 0;
+            ParamHandle handle = 0;
+            while ((ret = ParamCursorNext(&cursor, &handle)) == 0) {
+                ret = ReadParamName(GetParamWorkSpace(), handle, name, sizeof(name));
+                EXPECT_EQ(ret, 0);
+                EXPECT_EQ(strncmp(name, "cursor.test.", strlen("cursor.test.")), 0);
+                count++;
+            }
+            EXPECT_EQ(ret, PARAM_CODE_NOT_FOUND);
+            EXPECT_EQ(count, counts[i]);
+            ParamCursorEnd(&cursor);
+        }
+
+        // parameters of other areas are walked too
+        ParamCursor cursor;
+        ParamCursorBegin(&cursor, GetParamWorkSpace(), nullptr);
+        ParamHandle handle = 0;
+        int areaCount = 0;
+        while (ParamCursorNext(&cursor, &handle) == 0) {
+            areaCount += (PARAM_HANDLE_AREA(handle) != PARAM_AREA_DEFAULT) ? 1 : 0;
+        }
+        ParamCursorEnd(&cursor);
+        EXPECT_GT(areaCount, 0);
+        return 0;
+    }
+
+    int TestParamHashIndex()
+    {
+        const int paramCount = 200;
+        WorkSpace *space = &GetParamWorkSpace()->paramSpace;
+        char name[PARAM_NAME_LEN_MAX] = { 0 };
+        for (int i = 0; i < paramCount; i++) {
+            int ret = sprintf_s(name, sizeof(name), "hash.test.%d.aaaa", i);
+            PARAM_CHECK(ret > 0, return -1, "Failed to format name");
+            ret = SystemWriteParam(name, "hash");
+            EXPECT_EQ(ret, 0);
+        }
+        for (int i = 0; i < paramCount; i++) {
+            int ret = sprintf_s(name, sizeof(name), "hash.test.%d.aaaa", i);
+            PARAM_CHECK(ret > 0, return -1, "Failed to format name");
+            uint32_t dataIndex = 0;
+            uint32_t labelIndex = 0;
+            ret = FindParamHashEntry(space, name, strlen(name), &dataIndex, &labelIndex);
+            EXPECT_EQ(ret, 0);
+            uint32_t trieLabel = 0;
+            ParamTrieNode *node = FindTrieNode(space, name, strlen(name), &trieLabel);
+            EXPECT_NE(node, nullptr);
+            EXPECT_EQ(dataIndex, node->dataIndex);
+            EXPECT_EQ(labelIndex, trieLabel);
+        }
+        uint32_t dataIndex = 0;
+        uint32_t labelIndex = 0;
+        EXPECT_EQ(FindParamHashEntry(space, "hash.test.0", strlen("hash.test.0"), &dataIndex, &labelIndex),
+            PARAM_CODE_NOT_FOUND);
+
+        // a label added later is seen by the parameters below it
+        ParamAuditData auditData = {};
+        auditData.name = "hash.test.1";
+        auditData.label = "hash.test.1";
+        auditData.dacData.gid = 203; // 203 test dac gid
+        auditData.dacData.uid = geteuid();
+        auditData.dacData.mode = 0666; // 0666 test mode
+        AddSecurityLabel(&auditData, GetParamWorkSpace());
+        int ret = FindParamHashEntry(space, "hash.test.1.aaaa", strlen("hash.test.1.aaaa"), &dataIndex, &labelIndex);
+        EXPECT_EQ(ret, 0);
+        ParamSecruityNode *label = (ParamSecruityNode *)GetTrieNode(space, labelIndex);
+        EXPECT_NE(label, nullptr);
+        EXPECT_EQ(label->gid, auditData.dacData.gid);
+        CheckServerParamValue("hash.test.1.aaaa", "hash");
+
+        // a label above keeps the nearer label of hash.test.1
+        auditData.name = "hash.test";
+        auditData.label = "hash.test";
+        auditData.dacData.gid = 204; // 204 test dac gid
+        AddSecurityLabel(&auditData, GetParamWorkSpace());
+        ret = FindParamHashEntry(space, "hash.test.1.aaaa", strlen("hash.test.1.aaaa"), &dataIndex, &labelIndex);
+        EXPECT_EQ(ret, 0);
+        label = (ParamSecruityNode *)GetTrieNode(space, labelIndex);
+        EXPECT_NE(label, nullptr);
+        EXPECT_EQ(label->gid, 203); // 203 test dac gid
+        ret = FindParamHashEntry(space, "hash.test.2.aaaa", strlen("hash.test.2.aaaa"), &dataIndex, &labelIndex);
+        EXPECT_EQ(ret, 0);
+        label = (ParamSecruityNode *)GetTrieNode(space, labelIndex);
+        EXPECT_NE(label, nullptr);
+        EXPECT_EQ(label->gid, auditData.dacData.gid);
+        return 0;
+    }
+
+    int TestAreaGeneration()
+    {
+        const char *name = "generation.test.aaaa.bbbb";
+        SystemWriteParam(name, "1001");
+        uint32_t index = GetWorkSpaceIndex(name);
+        uint32_t generation = GetParamAreaGeneration(GetParamWorkSpace(), index);
+        ParamAuditData auditData = {};
+        auditData.name = "generation.test";
+        auditData.label = "generation.test";
+        auditData.dacData.gid = getegid();
+        auditData.dacData.uid = geteuid();
+        auditData.dacData.mode = 0666; // 0666 test mode
+        AddSecurityLabel(&auditData, GetParamWorkSpace());
+        // handles cached by clients are checked again after a label is added
+        EXPECT_NE(GetParamAreaGeneration(GetParamWorkSpace(), index), generation);
+        CheckServerParamValue(name, "1001");
+        return 0;
+    }
+
+    int TestWaitParamValue()
+    {
+        const char *name = "wait.local.aaaa.bbbb";
+        SystemWriteParam(name, "wait.local.1001");
+        EXPECT_EQ(WaitParamValue(GetParamWorkSpace(), name, "wait.local.1001", 1), 0);
+        EXPECT_EQ(WaitParamValue(GetParamWorkSpace(), name, "wait.local*", 1), 0);
+        EXPECT_EQ(WaitParamValue(GetParamWorkSpace(), name, "wait.local", 1), PARAM_CODE_TIMEOUT);
+
+        // woken up by the creation of the parameter and by the update of its value
+        pthread_t tid;
+        pthread_create(&tid, nullptr, [](void *) -> void * {
+                const int delay = 100 * 1000; // 100ms
+                usleep(delay);
+                SystemWriteParam("wait.local.aaaa.cccc", "1001");
+                usleep(delay);
+                SystemWriteParam("wait.local.aaaa.cccc", "1002");
+                return nullptr;
+            }, nullptr);
+        EXPECT_EQ(WaitParamValue(GetParamWorkSpace(), "wait.local.aaaa.cccc", "1002", 3), 0); // 3s
+        pthread_join(tid, nullptr);
+        return 0;
+    }
+
+    int TestParamChangeSerial()
+    {
+        ParamWorkSpace *workSpace = GetParamWorkSpace();
+        atomic_uint *all = GetParamChangeSerial(workSpace, nullptr);
+        atomic_uint *persist = GetParamChangeSerial(workSpace, "persist.change.test");
+        EXPECT_NE(all, nullptr);
+        EXPECT_EQ(persist, GetParamChangeSerial(workSpace, "persist"));
+        EXPECT_NE(persist, GetParamChangeSerial(workSpace, "change.test"));
+        uint32_t allSerial = atomic_load(all);
+        uint32_t persistSerial = atomic_load(persist);
+        SystemWriteParam("change.test.aaaa", "1001");
+        EXPECT_NE(atomic_load(all), allSerial);
+        EXPECT_EQ(atomic_load(persist), persistSerial);
+        SystemWriteParam("persist.change.test.aaaa", "1001");
+        EXPECT_NE(atomic_load(persist), persistSerial);
+
+        uint32_t serial = atomic_load(persist);
+        EXPECT_EQ(WaitParamChange(workSpace, "persist", &serial, 1), PARAM_CODE_TIMEOUT);
+        pthread_t tid;
+        pthread_create(&tid, nullptr, [](void *) -> void * {
+                usleep(100 * 1000); // 100ms
+                SystemWriteParam("persist.change.test.aaaa", "1002");
+                return nullptr;
+            }, nullptr);
+        uint32_t last = serial;
+        EXPECT_EQ(WaitParamChange(workSpace, "persist", &serial, 3), 0); // 3s
+        EXPECT_NE(serial, last);
+        pthread_join(tid, nullptr);
+        return 0;
+    }
+
+    int TestReadParamValues()
+    {
+        const char *names[] = {
+            "batch.test.aaaa", "batch.test.bbbb", "const.batch.test.cccc", "batch.test.none"
+        };
+        const char *expects[] = { "1001", "1002", "1003", "" };
+        const uint32_t count = sizeof(names) / sizeof(names[0]);
+        ParamHandle handles[count] = { 0 };
+        char buffers[count][PARAM_VALUE_LEN_MAX] = { { 0 } };
+        char *values[count] = { nullptr };
+        uint32_t lens[count] = { 0 };
+        for (uint32_t i = 0; i < count; i++) {
+            if (strlen(expects[i]) > 0) {
+                SystemWriteParam(names[i], expects[i]);
+            }
+            ReadParamWithCheck(GetParamWorkSpace(), names[i], DAC_READ, &handles[i]);
+            values[i] = buffers[i];
+            lens[i] = PARAM_VALUE_LEN_MAX;
+        }
+        values[1] = nullptr; // get the length only
+        int ret = ReadParamValues(GetParamWorkSpace(), handles, values, lens, count);
+        EXPECT_EQ(ret, 0);
+        EXPECT_EQ(strcmp(buffers[0], expects[0]), 0);
+        EXPECT_EQ(lens[1], strlen(expects[1]) + 1);
+        EXPECT_EQ(strcmp(buffers[2], expects[2]), 0); // 2 in the const area
+        EXPECT_EQ(lens[3], 0); // 3 not found
+        return 0;
+    }
+
     int TestPersistParam()
     {
         LoadPersistParams();
@@ -281,9 +685,329 @@ public:
         SystemWriteParam("persist.111.bbbb.cccc.dddd.1110", "1108");
         SystemWriteParam("persist.111.bbbb.cccc.dddd.1111", "1108");
         if (GetParamWorkSpace() != nullptr) {
-            TimerCallbackForSave(nullptr, &(GetParamWorkSpace()->paramSpace));
+            TimerCallbackForSave(nullptr, GetParamWorkSpace());
+        }
+        LoadPersistParams();
+        return 0;
+    }
+
+    int TestPersistJournal()
+    {
+        const char *name = "persist.journal.test.aaaa";
+        LoadPersistParams();
+        EXPECT_EQ(SystemWriteParam(name, "1"), 0);
+        struct stat st = {};
+        EXPECT_EQ(stat(PARAM_PERSIST_JOURNAL_PATH, &st), 0);
+        EXPECT_GT(st.st_size, 0);
+
+        // a record torn by power loss is dropped
+        FILE *fp = fopen(PARAM_PERSIST_JOURNAL_PATH, "a");
+        PARAM_CHECK(fp != NULL, return -1, "Failed to open journal");
+        (void)fputs("torn", fp);
+        (void)fclose(fp);
+
+        // changed in memory only, the journal brings the saved value back and is compacted
+        uint32_t dataIndex = 0;
+        EXPECT_EQ(WriteParam(GetWorkSpace(GetParamWorkSpace(), name), name, "0", &dataIndex, 0), 0);
+        CheckServerParamValue(name, "0");
+        LoadPersistParams();
+        CheckServerParamValue(name, "1");
+        EXPECT_EQ(stat(PARAM_PERSIST_JOURNAL_PATH, &st), 0);
+        EXPECT_EQ(st.st_size, 0);
+
+        // a long journal is compacted by the save timer
+        char value[PARAM_VALUE_LEN_MAX] = { 0 };
+        for (int i = 0; st.st_size < PARAM_PERSIST_JOURNAL_MAX; i++) {
+            int ret = sprintf_s(value, sizeof(value), "%d", i);
+            PARAM_CHECK(ret > 0, return -1, "Failed to format value");
+            EXPECT_EQ(SystemWriteParam(name, value), 0);
+            EXPECT_EQ(stat(PARAM_PERSIST_JOURNAL_PATH, &st), 0);
         }
+        TimerCallbackForSave(nullptr, GetParamWorkSpace());
+        EXPECT_EQ(stat(PARAM_PERSIST_JOURNAL_PATH, &st), 0);
+        EXPECT_EQ(st.st_size, 0);
+        LoadPersistParams();
+        CheckServerParamValue(name, value);
+        return 0;
+    }
+
+    // 保存失败时保留原快照和journal
+    int TestPersistSaveFail()
+    {
+        const char *name = "persist.journal.test.bbbb";
+        LoadPersistParams();
+        EXPECT_EQ(SystemWriteParam(name, "1"), 0);
+        struct stat st = {};
+        EXPECT_EQ(stat(PARAM_PERSIST_JOURNAL_PATH, &st), 0);
+        off_t journalSize = st.st_size;
+        EXPECT_GT(journalSize, 0);
+
+        PersistParamOps ops = {};
+        EXPECT_EQ(RegisterPersistParamOps(&ops), 0);
+        PERSIST_SAVE_HANDLE handle = nullptr;
+        EXPECT_EQ(ops.batchSaveBegin(&handle), 0);
+        EXPECT_EQ(ops.batchSave(handle, name, "2"), 0);
+        EXPECT_NE(ops.batchSaveEnd(handle, -1), 0);
+        EXPECT_NE(stat(PARAM_PERSIST_SAVE_TMP_PATH, &st), 0);
+        EXPECT_EQ(stat(PARAM_PERSIST_JOURNAL_PATH, &st), 0);
+        EXPECT_EQ(st.st_size, journalSize);
+
+        uint32_t dataIndex = 0;
+        EXPECT_EQ(WriteParam(GetWorkSpace(GetParamWorkSpace(), name), name, "0", &dataIndex, 0), 0);
         LoadPersistParams();
+        CheckServerParamValue(name, "1");
+        return 0;
+    }
+
+    int WriteTestFile(const char *fileName, const char *content)
+    {
+        CheckAndCreateDir(fileName);
+        FILE *fp = fopen(fileName, "w");
+        PARAM_CHECK(fp != nullptr, return -1, "Failed to open %s", fileName);
+        (void)fputs(content, fp);
+        (void)fclose(fp);
+        return 0;
+    }
+
+    int TestLoadParamFiles()
+    {
+        const char *dir = PARAM_DEFAULT_PATH "/param_load";
+        WriteTestFile(PARAM_DEFAULT_PATH "/param_load/a.para",
+            "# comment\n"
+            "test.load.aaaa.bbbb = 1\n"
+            "test.load.aaaa.bbbb=2\n"
+            "test.load.aaaa.cccc=3\n"
+            "const.test.load.dddd=first\n"
+            "const.test.load.dddd=second\n"
+            "ctl.start.test.load=1\n"
+            "\n"
+            "   test.load.eeee.ffff =  value with spaces  \r\n"
+            "test.load.last=end");
+        WriteTestFile(PARAM_DEFAULT_PATH "/param_load/b.para", "test.load.aaaa.gggg=4\ntest.load.hhhh=5\n");
+        WriteTestFile(PARAM_DEFAULT_PATH "/param_load/c.para.dac", "test.load.label. root:root:0777\n");
+        LoadDefaultParams(dir, LOAD_PARAM_NORMAL);
+        CheckServerParamValue("test.load.aaaa.bbbb", "2");
+        CheckServerParamValue("test.load.aaaa.cccc", "3");
+        CheckServerParamValue("const.test.load.dddd", "first");
+        CheckServerParamValue("test.load.eeee.ffff", "value with spaces");
+        CheckServerParamValue("test.load.last", "end");
+        CheckServerParamValue("test.load.aaaa.gggg", "4");
+        CheckServerParamValue("test.load.hhhh", "5");
+        char value[PARAM_VALUE_LEN_MAX] = { 0 };
+        uint32_t len = sizeof(value);
+        EXPECT_NE(SystemReadParam("ctl.start.test.load", value, &len), 0);
+        WorkSpace *space = GetWorkSpace(GetParamWorkSpace(), "test.load.label");
+        PARAM_CHECK(space != nullptr, return -1, "Failed to get workspace");
+        ParamTrieNode *node = FindTrieNode(space, "test.load.label", strlen("test.load.label"), nullptr);
+        EXPECT_NE(node, nullptr);
+        if (node != nullptr) {
+            EXPECT_NE(node->labelIndex, 0);
+        }
+
+        // only the parameters not set yet are added
+        WriteTestFile(PARAM_DEFAULT_PATH "/param_load/a.para", "test.load.aaaa.bbbb=9\ntest.load.iiii=6\n");
+        LoadDefaultParams(PARAM_DEFAULT_PATH "/param_load/a.para", LOAD_PARAM_ONLY_ADD);
+        CheckServerParamValue("test.load.aaaa.bbbb", "2");
+        CheckServerParamValue("test.load.iiii", "6");
+        return 0;
+    }
+
+    int TestParamImage()
+    {
+        const char *dir = PARAM_DEFAULT_PATH "/param_image";
+        const char *fileName = PARAM_DEFAULT_PATH "/param_image/test.para";
+        const char *image = PARAM_DEFAULT_PATH "/param_image/param_image";
+        const int paramCount = 500;
+        CheckAndCreateDir(fileName);
+        FILE *fp = fopen(fileName, "w");
+        PARAM_CHECK(fp != nullptr, return -1, "Failed to open %s", fileName);
+        for (int i = 0; i < paramCount; i++) {
+            (void)fprintf(fp, "test.image.%d.aaaa.bbbb=%d\n", i, i);
+        }
+        (void)fclose(fp);
+
+        EXPECT_EQ(LoadDefaultParams(dir, LOAD_PARAM_NORMAL), 0);
+        CheckServerParamValue("test.image.499.aaaa.bbbb", "499");
+        const char *paths[] = { dir };
+        EXPECT_EQ(SaveParamImage(image, paths, sizeof(paths) / sizeof(paths[0])), 0);
+
+        // the image brings back the parameters of the files
+        EXPECT_EQ(SystemWriteParam("test.image.0.aaaa.bbbb", "changed"), 0);
+        EXPECT_EQ(LoadParamImage(image), 0);
+        for (int i = 0; i < paramCount; i++) {
+            char name[PARAM_NAME_LEN_MAX] = { 0 };
+            char value[PARAM_BUFFER_SIZE] = { 0 };
+            uint32_t len = sizeof(value);
+            EXPECT_GT(sprintf_s(name, sizeof(name), "test.image.%d.aaaa.bbbb", i), 0);
+            EXPECT_EQ(SystemReadParam(name, value, &len), 0);
+            EXPECT_EQ(atoi(value), i);
+        }
+        EXPECT_EQ(SystemWriteParam("test.image.0.aaaa.bbbb", "changed"), 0);
+        CheckServerParamValue("test.image.0.aaaa.bbbb", "changed");
+
+        // the image is out of date once a parameter file is changed
+        fp = fopen(fileName, "a");
+        PARAM_CHECK(fp != nullptr, return -1, "Failed to open %s", fileName);
+        (void)fputs("test.image.new=1\n", fp);
+        (void)fclose(fp);
+        EXPECT_NE(LoadParamImage(image), 0);
+        CheckServerParamValue("test.image.0.aaaa.bbbb", "changed");
+
+        // so is it when a value is changed and the size is kept
+        EXPECT_EQ(SaveParamImage(image, paths, sizeof(paths) / sizeof(paths[0])), 0);
+        fp = fopen(fileName, "r+");
+        PARAM_CHECK(fp != nullptr, return -1, "Failed to open %s", fileName);
+        (void)fseek(fp, strlen("test.image.0.aaaa.bbbb="), SEEK_SET);
+        (void)fputc('9', fp);
+        (void)fclose(fp);
+        EXPECT_NE(LoadParamImage(image), 0);
+        CheckServerParamValue("test.image.0.aaaa.bbbb", "changed");
+
+        // an image built for another security backend is not loaded
+        EXPECT_EQ(SaveParamImage(image, paths, sizeof(paths) / sizeof(paths[0])), 0);
+        fp = fopen(image, "r+");
+        PARAM_CHECK(fp != nullptr, return -1, "Failed to open %s", image);
+        (void)fseek(fp, sizeof(uint32_t) * 4, SEEK_SET); // 4 magic, version, headerSize and trieType
+        uint32_t security = 0;
+        (void)fwrite(&security, sizeof(security), 1, fp);
+        (void)fclose(fp);
+        EXPECT_NE(LoadParamImage(image), 0);
+        CheckServerParamValue("test.image.0.aaaa.bbbb", "changed");
+        return 0;
+    }
+
+    int TestDeleteParam()
+    {
+        const char *name = "test.delete.aaaa.bbbb";
+        char value[PARAM_VALUE_LEN_MAX] = {0};
+        uint32_t len = sizeof(value);
+        EXPECT_EQ(SystemWriteParam(name, "1"), 0);
+        ParamHandle handle = 0;
+        EXPECT_EQ(ReadParamWithCheck(GetParamWorkSpace(), name, DAC_READ, &handle), 0);
+        EXPECT_EQ(SystemDeleteParam(name), 0);
+        EXPECT_EQ(SystemReadParam(name, value, &len), PARAM_CODE_NOT_FOUND);
+        len = sizeof(value);
+        EXPECT_EQ(ReadParamValue(GetParamWorkSpace(), handle, value, &len), PARAM_CODE_NOT_FOUND);
+        EXPECT_EQ(SystemDeleteParam(name), PARAM_CODE_NOT_FOUND);
+        EXPECT_EQ(SystemDeleteParam("const.test.delete"), PARAM_CODE_READ_ONLY);
+
+        // add again after deleted
+        EXPECT_EQ(SystemWriteParam(name, "2"), 0);
+        CheckServerParamValue(name, "2");
+
+        // delete from the client
+        if (g_worker == nullptr) {
+            g_worker = CreateAndGetStreamTask();
+        }
+        uint32_t msgSize = sizeof(ParamMessage) + sizeof(ParamMsgContent) + PARAM_ALIGN(strlen(name) + 1);
+        ParamMessage *request = (ParamMessage *)CreateParamMessage(MSG_DEL_PARAM, name, msgSize);
+        PARAM_CHECK(request != nullptr, return -1, "Failed to malloc for delete");
+        uint32_t offset = 0;
+        EXPECT_EQ(FillParamMsgContent(request, &offset, PARAM_VALUE, name, strlen(name)), 0);
+        ProcessMessage((const ParamTaskPtr)g_worker, (const ParamMessage *)request);
+        free(request);
+        len = sizeof(value);
+        EXPECT_EQ(SystemReadParam(name, value, &len), PARAM_CODE_NOT_FOUND);
+        return 0;
+    }
+
+    int TestCompactWorkSpace()
+    {
+        const int paramCount = 200;
+        char name[PARAM_NAME_LEN_MAX] = {0};
+        char value[PARAM_VALUE_LEN_MAX] = {0};
+        for (int i = 0; i < paramCount; i++) {
+            (void)sprintf_s(name, sizeof(name), "test.compact.%d.aaaa.bbbb", i);
+            (void)sprintf_s(value, sizeof(value), "value.%d", i);
+            EXPECT_EQ(SystemWriteParam(name, value), 0);
+        }
+        ParamHandle handle = 0;
+        EXPECT_EQ(ReadParamWithCheck(GetParamWorkSpace(), "test.compact.1.aaaa.bbbb", DAC_READ, &handle), 0);
+        for (int i = 0; i < paramCount; i++) {
+            if ((i % 10) != 1) { // 10 keep one of ten
+                (void)sprintf_s(name, sizeof(name), "test.compact.%d.aaaa.bbbb", i);
+                EXPECT_EQ(SystemDeleteParam(name), 0);
+            }
+        }
+        WorkSpace *space = GetWorkSpace(GetParamWorkSpace(), "test.compact.1.aaaa.bbbb");
+        PARAM_CHECK(space != nullptr && space->area != nullptr, return -1, "Invalid workspace");
+        uint32_t size = space->area->currOffset;
+        ParamTrieHeader *oldArea = space->area;
+        EXPECT_EQ(CompactWorkSpace(space), 0);
+        EXPECT_LT(space->area->currOffset, size);
+        EXPECT_EQ(space->area->deletedSize, 0);
+
+        // 被替换的区域保留到关闭工作区，读者可能还在使用
+        EXPECT_EQ(CompactWorkSpace(space), 0);
+        EXPECT_EQ(oldArea->currOffset, size);
+        EXPECT_NE(atomic_load(&oldArea->replaced), 0);
+
+        // the handle of the old area is not valid any more
+        uint32_t len = sizeof(value);
+        EXPECT_NE(ReadParamValue(GetParamWorkSpace(), handle, value, &len), 0);
+        for (int i = 1; i < paramCount; i += 10) { // 10 keep one of ten
+            (void)sprintf_s(name, sizeof(name), "test.compact.%d.aaaa.bbbb", i);
+            (void)sprintf_s(value, sizeof(value), "value.%d", i);
+            CheckServerParamValue(name, value);
+        }
+        len = sizeof(value);
+        EXPECT_EQ(SystemReadParam("test.compact.0.aaaa.bbbb", value, &len), PARAM_CODE_NOT_FOUND);
+        EXPECT_EQ(SystemWriteParam("test.compact.0.aaaa.bbbb", "new"), 0);
+        CheckServerParamValue("test.compact.0.aaaa.bbbb", "new");
+
+        // 32次压缩后epoch回绕，旧句柄的偏移可能落在节点中间
+        EXPECT_EQ(ReadParamWithCheck(GetParamWorkSpace(), "test.compact.1.aaaa.bbbb", DAC_READ, &handle), 0);
+        len = sizeof(value);
+        EXPECT_EQ(ReadParamValue(GetParamWorkSpace(), handle, value, &len), 0);
+        ParamHandle stale = PARAM_HANDLE(PARAM_HANDLE_AREA(handle), PARAM_HANDLE_EPOCH(handle),
+            PARAM_HANDLE_OFFSET(handle) + sizeof(uint32_t));
+        len = sizeof(value);
+        EXPECT_NE(ReadParamValue(GetParamWorkSpace(), stale, value, &len), 0);
+        return 0;
+    }
+
+    // 相同的label只保存一份，权限结果按label缓存
+    int TestSecurityLabelIntern()
+    {
+        ParamWorkSpace *workSpace = GetParamWorkSpace();
+        workSpace->securityLabel->cred.gid = 9999; // 9999 test gid
+        WorkSpace *space = GetWorkSpace(workSpace, "label6.test");
+        PARAM_CHECK(space != nullptr && space->area != nullptr, return -1, "Invalid workspace");
+        uint32_t count = space->area->securityNodeCount;
+        const char *prefixes[] = { "label6.test.aaa", "label6.test.bbb", "label6.test.ccc" };
+        ParamAuditData auditData = {};
+        auditData.label = "label6.test";
+        auditData.dacData.gid = 206; // 206 test gid
+        auditData.dacData.uid = geteuid();
+        auditData.dacData.mode = 0400; // 0400 only the user can read
+        uint32_t labelIndex[sizeof(prefixes) / sizeof(prefixes[0])] = {0};
+        for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+            auditData.name = prefixes[i];
+            EXPECT_EQ(AddSecurityLabel(&auditData, workSpace), 0);
+            ParamTrieNode *node = FindTrieNode(space, prefixes[i], strlen(prefixes[i]), nullptr);
+            PARAM_CHECK(node != nullptr, return -1, "Failed to find %s", prefixes[i]);
+            labelIndex[i] = node->labelIndex;
+        }
+        EXPECT_EQ(space->area->securityNodeCount, count + 1);
+        EXPECT_EQ(labelIndex[0], labelIndex[1]);
+        EXPECT_EQ(labelIndex[0], labelIndex[2]);
+
+        // 其他前缀复用同一个label的权限结果
+        uint32_t hit = 0;
+        uint32_t miss = 0;
+        EXPECT_EQ(CheckParamPermission(workSpace, workSpace->securityLabel, "label6.test.aaa.1", DAC_READ), 0);
+        GetParamPermissionCacheStat(workSpace, &hit, &miss);
+        EXPECT_EQ(CheckParamPermission(workSpace, workSpace->securityLabel, "label6.test.bbb.1", DAC_READ), 0);
+        uint32_t newHit = 0;
+        uint32_t newMiss = 0;
+        GetParamPermissionCacheStat(workSpace, &newHit, &newMiss);
+        EXPECT_EQ(newHit, hit + 1);
+        EXPECT_EQ(newMiss, miss);
+
+        auditData.name = "label6.test.ddd";
+        auditData.dacData.gid = 207; // 207 another test gid
+        EXPECT_EQ(AddSecurityLabel(&auditData, workSpace), 0);
+        EXPECT_EQ(space->area->securityNodeCount, count + 2); // 2 two different labels
         return 0;
     }
 
@@ -360,6 +1084,84 @@ public:
         return 0;
     }
 
+    int TestServiceProcessBatchMessage()
+    {
+        if (g_worker == nullptr) {
+            g_worker = CreateAndGetStreamTask();
+        }
+        const char *contents[] = {
+            "batch.aaa.bbb.1=value1", "batch.aaa.bbb.2=value2", "batch..aaa=value", "batch.aaa.bbb.1=value3"
+        };
+        ParamMessage *request = (ParamMessage *)CreateParamMessage(MSG_SET_PARAM_BATCH, "*", PARAM_BUFFER_SIZE * 4);
+        PARAM_CHECK(request != nullptr, return -1, "Failed to malloc for batch");
+        uint32_t offset = 0;
+        for (size_t i = 0; i < sizeof(contents) / sizeof(contents[0]); i++) {
+            int ret = FillParamMsgContent(request, &offset, PARAM_NAME_VALUE, contents[i], strlen(contents[i]));
+            EXPECT_EQ(ret, 0);
+        }
+        request->msgSize = offset + sizeof(ParamMessage);
+        ProcessMessage((const ParamTaskPtr)g_worker, (const ParamMessage *)request);
+        free(request);
+        // applied in order, the invalid name does not stop the others
+        CheckServerParamValue("batch.aaa.bbb.1", "value3");
+        CheckServerParamValue("batch.aaa.bbb.2", "value2");
+        return 0;
+    }
+
+    int TestReceiveRequest()
+    {
+        // 连续的三个消息，大小不同
+        const uint32_t msgSize = sizeof(ParamMessage) + PARAM_ALIGN(1);
+        char data[(msgSize + PARAM_ALIGN(1) * RECEIVE_MSG_COUNT) * RECEIVE_MSG_COUNT] = { 0 };
+        uint32_t sizes[RECEIVE_MSG_COUNT] = { 0 };
+        uint32_t dataSize = 0;
+        for (uint32_t i = 0; i < RECEIVE_MSG_COUNT; i++) {
+            ParamMessage *msg = (ParamMessage *)(data + dataSize);
+            msg->type = MSG_SET_PARAM;
+            msg->msgSize = msgSize + PARAM_ALIGN(1) * i;
+            msg->id.msgId = i + 1;
+            sizes[i] = msg->msgSize;
+            dataSize += msg->msgSize;
+        }
+        LibuvStreamTask *client = (LibuvStreamTask *)calloc(1, sizeof(LibuvStreamTask));
+        PARAM_CHECK(client != nullptr, return -1, "Failed to alloc client");
+        client->recvMessage = RecordReceivedMessage;
+
+        // 一个消息分多次读取：头部不完整、消息不完整、剩余部分
+        g_receivedCount = 0;
+        FeedStreamTask(client, data, sizeof(uint32_t));
+        FeedStreamTask(client, data + sizeof(uint32_t), sizes[0] / 2 - sizeof(uint32_t)); // 2 split in the middle
+        EXPECT_EQ(g_receivedCount, 0);
+        FeedStreamTask(client, data + sizes[0] / 2, sizes[0] - sizes[0] / 2); // 2 split in the middle
+        EXPECT_EQ(g_receivedCount, 1);
+        EXPECT_EQ(g_receivedIds[0], 1);
+        EXPECT_EQ(client->recvBuffer, nullptr);
+
+        // 多个消息一次读取
+        g_receivedCount = 0;
+        FeedStreamTask(client, data, dataSize);
+        EXPECT_EQ(g_receivedCount, RECEIVE_MSG_COUNT);
+        for (uint32_t i = 0; i < RECEIVE_MSG_COUNT; i++) {
+            EXPECT_EQ(g_receivedIds[i], i + 1);
+        }
+        EXPECT_EQ(client->recvBuffer, nullptr);
+
+        // 一次读取以不完整的消息结束，剩余部分在下一次读取
+        g_receivedCount = 0;
+        uint32_t split = sizes[0] + sizes[1] / 2; // 2 split the second message in the middle
+        FeedStreamTask(client, data, split);
+        EXPECT_EQ(g_receivedCount, 1);
+        EXPECT_NE(client->recvBuffer, nullptr);
+        FeedStreamTask(client, data + split, dataSize - split);
+        EXPECT_EQ(g_receivedCount, RECEIVE_MSG_COUNT);
+        for (uint32_t i = 0; i < RECEIVE_MSG_COUNT; i++) {
+            EXPECT_EQ(g_receivedIds[i], i + 1);
+        }
+        EXPECT_EQ(client->recvBuffer, nullptr);
+        free(client);
+        return 0;
+    }
+
     int AddWatch(int type, const char *name, const char *value)
     {
         if (g_worker == nullptr) {
@@ -408,6 +1210,158 @@ public:
         return 0;
     }
 
+    // 值变长后保存在value slot中，等待按当前值匹配
+    int TestAddParamWait4()
+    {
+        const char *name = "wait.aaa.bbb.ccc.grown";
+        const char *value = "wait4.grown.aaaa.bbbb.cc";
+        SystemWriteParam(name, "w");
+        SystemWriteParam(name, value);
+        if (g_worker == nullptr) {
+            g_worker = CreateAndGetStreamTask();
+        }
+        ParamWatcher *watcher = GetParamWatcher((ParamTaskPtr)g_worker);
+        PARAM_CHECK(watcher != nullptr, return -1, "Failed to get watcher");
+        uint32_t count = watcher->triggerHead.triggerCount;
+        AddWatch(MSG_WAIT_PARAM, name, value);
+        EXPECT_EQ(watcher->triggerHead.triggerCount, count);
+        AddWatch(MSG_WAIT_PARAM, name, "w");
+        EXPECT_EQ(watcher->triggerHead.triggerCount, count + 1);
+        SystemWriteParam(name, "w");
+        EXPECT_EQ(watcher->triggerHead.triggerCount, count);
+        return 0;
+    }
+
+    // 权限结果缓存，label更新后失效
+    int TestPermissionCache()
+    {
+        ParamWorkSpace *workSpace = GetParamWorkSpace();
+        workSpace->securityLabel->cred.gid = 9999; // 9999 test gid
+        const char *name = "label5.test.aaa.bbb";
+        ParamAuditData auditData = {};
+        auditData.name = "label5.test";
+        auditData.label = "label5.test";
+        auditData.dacData.gid = 203; // 203 test gid
+        auditData.dacData.uid = geteuid();
+        auditData.dacData.mode = 0400; // 0400 only the user can read
+        EXPECT_EQ(AddSecurityLabel(&auditData, workSpace), 0);
+
+        uint32_t hit = 0;
+        uint32_t miss = 0;
+        GetParamPermissionCacheStat(workSpace, &hit, &miss);
+        EXPECT_EQ(CheckParamPermission(workSpace, workSpace->securityLabel, name, DAC_READ), 0);
+        EXPECT_EQ(CheckParamPermission(workSpace, workSpace->securityLabel, name, DAC_READ), 0);
+        EXPECT_NE(CheckParamPermission(workSpace, workSpace->securityLabel, name, DAC_WRITE), 0);
+        EXPECT_NE(CheckParamPermission(workSpace, workSpace->securityLabel, name, DAC_WRITE), 0);
+        uint32_t newHit = 0;
+        uint32_t newMiss = 0;
+        GetParamPermissionCacheStat(workSpace, &newHit, &newMiss);
+        EXPECT_EQ(newHit, hit + 2); // 2 second read and write
+        EXPECT_EQ(newMiss, miss + 2); // 2 first read and write
+
+        // 其他进程的检查不使用缓存
+        ParamSecurityLabel srcLabel = {};
+        srcLabel.cred.uid = geteuid() + 1;
+        srcLabel.cred.gid = 9999; // 9999 test gid
+        EXPECT_NE(CheckParamPermission(workSpace, &srcLabel, name, DAC_READ), 0);
+        GetParamPermissionCacheStat(workSpace, &hit, &miss);
+        EXPECT_EQ(hit, newHit);
+        EXPECT_EQ(miss, newMiss);
+
+        auditData.dacData.mode = 0600; // 0600 the user can read and write
+        EXPECT_EQ(AddSecurityLabel(&auditData, workSpace), 0);
+        EXPECT_EQ(CheckParamPermission(workSpace, workSpace->securityLabel, name, DAC_WRITE), 0);
+
+        workSpace->securityLabel->cred.uid = geteuid() + 1;
+        EXPECT_NE(CheckParamPermission(workSpace, workSpace->securityLabel, name, DAC_WRITE), 0);
+        workSpace->securityLabel->cred.uid = geteuid();
+        EXPECT_EQ(CheckParamPermission(workSpace, workSpace->securityLabel, name, DAC_WRITE), 0);
+        return 0;
+    }
+
+    // 附加组变化后权限结果缓存失效
+    int TestPermissionCacheGroups()
+    {
+        gid_t groups[PARAM_LOCAL_GROUP_MAX] = { 0 };
+        int count = getgroups(PARAM_LOCAL_GROUP_MAX - 1, groups);
+        if (count < 0 || setgroups(count, groups) != 0) {
+            return 0; // 没有修改附加组的权限
+        }
+        ParamWorkSpace *workSpace = GetParamWorkSpace();
+        ParamSecurityOps ops = {};
+        EXPECT_EQ(RegisterSecurityDacOps(&ops, 1), 0);
+        ParamSecurityOps savedOps = workSpace->paramSecurityOps;
+        ParamSecurityLabel savedLabel = *workSpace->securityLabel;
+        workSpace->paramSecurityOps.securityCheckParamPermission = ops.securityCheckParamPermission;
+        const uid_t otherId = 0x7ffffff0; // not a user or group
+        workSpace->securityLabel->cred.uid = otherId;
+        workSpace->securityLabel->cred.gid = otherId;
+        const char *name = "label7.test.aaa";
+        ParamAuditData auditData = {};
+        auditData.name = "label7.test";
+        auditData.label = "label7.test";
+        auditData.dacData.uid = otherId + 1;
+        auditData.dacData.gid = 207; // 207 test gid
+        auditData.dacData.mode = 0040; // 0040 only the group can read
+        EXPECT_EQ(AddSecurityLabel(&auditData, workSpace), 0);
+
+        EXPECT_NE(CheckParamPermission(workSpace, workSpace->securityLabel, name, DAC_READ), 0);
+        groups[count] = auditData.dacData.gid;
+        EXPECT_EQ(setgroups(count + 1, groups), 0);
+        EXPECT_EQ(CheckParamPermission(workSpace, workSpace->securityLabel, name, DAC_READ), 0);
+        EXPECT_EQ(setgroups(count, groups), 0);
+        EXPECT_NE(CheckParamPermission(workSpace, workSpace->securityLabel, name, DAC_READ), 0);
+
+        workSpace->paramSecurityOps = savedOps;
+        *workSpace->securityLabel = savedLabel;
+        return 0;
+    }
+
+    int TestDacGroupMember()
+    {
+        gid_t gid = 0;
+        uid_t uid = 0;
+        if (!GetGroupMember(&gid, &uid)) {
+            return 0;
+        }
+        ParamSecurityOps ops = {};
+        EXPECT_EQ(RegisterSecurityDacOps(&ops, 1), 0);
+        const uid_t otherId = 0x7ffffff0; // not a user or group
+        ParamSecurityLabel srcLabel = {};
+        srcLabel.cred.uid = uid;
+        srcLabel.cred.gid = otherId;
+        ParamAuditData auditData = {};
+        auditData.name = "test.dac.group";
+        auditData.dacData.uid = otherId;
+        auditData.dacData.gid = gid;
+        auditData.dacData.mode = 0060; // 0060 only the group can read and write
+        // 第二次检查使用缓存
+        EXPECT_EQ(ops.securityCheckParamPermission(&srcLabel, &auditData, DAC_READ), DAC_RESULT_PERMISSION);
+        EXPECT_EQ(ops.securityCheckParamPermission(&srcLabel, &auditData, DAC_READ), DAC_RESULT_PERMISSION);
+        auditData.dacData.gid = otherId + 1;
+        EXPECT_EQ(ops.securityCheckParamPermission(&srcLabel, &auditData, DAC_READ), DAC_RESULT_FORBIDED);
+        return 0;
+    }
+
+    // 超时后只删除该等待
+    int TestParamWaitTimeout()
+    {
+        const char *name = "wait.aaa.bbb.ccc.444";
+        uint64_t start = GetTriggerTime();
+        AddWatch(MSG_WAIT_PARAM, name, "wait4");
+        uint64_t end = GetTriggerTime();
+        ParamWatcher *watcher = (ParamWatcher *)ParamGetTaskUserData(g_worker);
+        EXPECT_NE(watcher, nullptr);
+        uint32_t count = watcher->triggerHead.triggerCount;
+        EXPECT_GT(count, 0);
+        const uint64_t timeout = DEFAULT_PARAM_WAIT_TIMEOUT * MS_UNIT;
+        EXPECT_GE(CheckWaitTriggerTimeout(GetTriggerWorkSpace(), start + timeout - 1), start + timeout);
+        EXPECT_EQ(watcher->triggerHead.triggerCount, count);
+        CheckWaitTriggerTimeout(GetTriggerWorkSpace(), end + timeout);
+        EXPECT_EQ(watcher->triggerHead.triggerCount, count - 1);
+        return 0;
+    }
+
     int TestAddParamWatch1()
     {
         const char *name = "watch.aaa.bbb.ccc.111";
@@ -494,6 +1448,24 @@ HWTEST_F(ParamUnitTest, TestPersistParam, TestSize.Level0)
     test.TestPersistParam();
 }
 
+HWTEST_F(ParamUnitTest, TestPersistJournal, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestPersistJournal();
+}
+
+HWTEST_F(ParamUnitTest, TestPersistSaveFail, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestPersistSaveFail();
+}
+
+HWTEST_F(ParamUnitTest, TestLoadParamFiles, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestLoadParamFiles();
+}
+
 HWTEST_F(ParamUnitTest, TestSetParam_1, TestSize.Level0)
 {
     ParamUnitTest test;
@@ -560,6 +1532,18 @@ HWTEST_F(ParamUnitTest, TestAddSecurityLabel4, TestSize.Level0)
     test.TestAddSecurityLabel4();
 }
 
+HWTEST_F(ParamUnitTest, TestPermissionCache, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestPermissionCache();
+}
+
+HWTEST_F(ParamUnitTest, TestPermissionCacheGroups, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestPermissionCacheGroups();
+}
+
 HWTEST_F(ParamUnitTest, TestUpdateParam, TestSize.Level0)
 {
     ParamUnitTest test;
@@ -570,6 +1554,66 @@ HWTEST_F(ParamUnitTest, TestUpdateParam, TestSize.Level0)
     test.TestUpdateParam("net.tcp.default_init_rwnd", "60");
 }
 
+HWTEST_F(ParamUnitTest, TestWorkSpaceExtend, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestWorkSpaceExtend();
+}
+
+HWTEST_F(ParamUnitTest, TestParamValueSlot, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestParamValueSlot();
+}
+
+HWTEST_F(ParamUnitTest, TestWorkSpaceArea, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestWorkSpaceArea();
+}
+
+HWTEST_F(ParamUnitTest, TestTrieArray, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestTrieArray();
+}
+
+HWTEST_F(ParamUnitTest, TestParamCursor, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestParamCursor();
+}
+
+HWTEST_F(ParamUnitTest, TestParamHashIndex, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestParamHashIndex();
+}
+
+HWTEST_F(ParamUnitTest, TestAreaGeneration, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestAreaGeneration();
+}
+
+HWTEST_F(ParamUnitTest, TestWaitParamValue, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestWaitParamValue();
+}
+
+HWTEST_F(ParamUnitTest, TestParamChangeSerial, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestParamChangeSerial();
+}
+
+HWTEST_F(ParamUnitTest, TestReadParamValues, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestReadParamValues();
+}
+
 HWTEST_F(ParamUnitTest, TestServiceProcessMessage, TestSize.Level0)
 {
     ParamUnitTest test;
@@ -577,6 +1621,18 @@ HWTEST_F(ParamUnitTest, TestServiceProcessMessage, TestSize.Level0)
     test.TestServiceProcessMessage("wertt.2222.wwww.3333", "wwww.eeeee", 0);
 }
 
+HWTEST_F(ParamUnitTest, TestServiceProcessBatchMessage, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestServiceProcessBatchMessage();
+}
+
+HWTEST_F(ParamUnitTest, TestReceiveRequest, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestReceiveRequest();
+}
+
 HWTEST_F(ParamUnitTest, TestAddParamWait1, TestSize.Level0)
 {
     ParamUnitTest test;
@@ -595,6 +1651,24 @@ HWTEST_F(ParamUnitTest, TestAddParamWait3, TestSize.Level0)
     test.TestAddParamWait3();
 }
 
+HWTEST_F(ParamUnitTest, TestAddParamWait4, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestAddParamWait4();
+}
+
+HWTEST_F(ParamUnitTest, TestDacGroupMember, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestDacGroupMember();
+}
+
+HWTEST_F(ParamUnitTest, TestParamWaitTimeout, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestParamWaitTimeout();
+}
+
 HWTEST_F(ParamUnitTest, TestAddParamWatch1, TestSize.Level0)
 {
     ParamUnitTest test;
@@ -659,4 +1733,28 @@ HWTEST_F(ParamUnitTest, TestPowerCtrl, TestSize.Level0)
     EXPECT_NE(ret, 0);
     ret = test.TestPowerCtrl("reboot", 0772);
     EXPECT_EQ(ret, 0);
+}
+
+HWTEST_F(ParamUnitTest, TestParamImage, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestParamImage();
+}
+
+HWTEST_F(ParamUnitTest, TestDeleteParam, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestDeleteParam();
+}
+
+HWTEST_F(ParamUnitTest, TestCompactWorkSpace, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestCompactWorkSpace();
+}
+
+HWTEST_F(ParamUnitTest, TestSecurityLabelIntern, TestSize.Level0)
+{
+    ParamUnitTest test;
+    test.TestSecurityLabelIntern();
 }
\ No newline at end of file
@@ -66,6 +66,24 @@ static int TestTriggerExecute(TriggerNode *trigger, const char *content, uint32_
     return 0;
 }
 
+static uint64_t g_eventCount = 0;
+static bool g_eventInOrder = true;
+static void TestEventProcess(uint64_t eventId, const char *content, uint32_t size)
+{
+    g_eventInOrder = g_eventInOrder && (eventId == g_eventCount) && (content != nullptr) && (size == strlen(content) + 1);
+    g_eventCount++;
+}
+
+static uint32_t g_timeoutOrder[triggerBuffer] = { 0 };
+static uint32_t g_timeoutCount = 0;
+static int TestWaitTimeoutCmd(const TriggerExtData *extData, int cmd, const char *content)
+{
+    if (cmd == CMD_INDEX_FOR_PARA_WAIT_TIMEOUT && g_timeoutCount < triggerBuffer) {
+        g_timeoutOrder[g_timeoutCount++] = extData->watcherId;
+    }
+    return 0;
+}
+
 class TriggerUnitTest : public ::testing::Test {
 public:
     TriggerUnitTest() {}
@@ -288,6 +306,36 @@ public:
         return 0;
     }
 
+    int TestCheckParamTrigger6()
+    {
+        const char *triggerName = "param:test_param.666";
+        const char *param = "test_param.aaa.666.2222";
+        char buffer[triggerBuffer];
+        int ret = sprintf_s(buffer, sizeof(buffer), "%s=1 || %s=2", param, param);
+        EXPECT_GE(ret, 0);
+        TriggerNode *node = AddTrigger(GetTriggerHeader(TRIGGER_PARAM), triggerName, buffer, 0);
+        EXPECT_NE(node, nullptr);
+        // only the triggers referring to the exact name are checked, and only once
+        g_matchTrigger = 0;
+        ret = sprintf_s(buffer, sizeof(buffer), "%s=%s", param, "2");
+        EXPECT_GE(ret, 0);
+        CheckTrigger(GetTriggerWorkSpace(), TRIGGER_PARAM, buffer, strlen(buffer), TestTriggerExecute);
+        EXPECT_EQ(1, g_matchTrigger);
+        g_matchTrigger = 0;
+        const char *subName = "aaa.666.2222=2";
+        CheckTrigger(GetTriggerWorkSpace(), TRIGGER_PARAM, subName, strlen(subName), TestTriggerExecute);
+        EXPECT_EQ(0, g_matchTrigger);
+        EXPECT_EQ(MarkTriggerToParam(GetTriggerWorkSpace(), GetTriggerHeader(TRIGGER_PARAM), param), 1);
+        EXPECT_EQ(MarkTriggerToParam(GetTriggerWorkSpace(), GetTriggerHeader(TRIGGER_PARAM), "aaa.666.2222"), 0);
+
+        FreeTrigger(node);
+        g_matchTrigger = 0;
+        CheckTrigger(GetTriggerWorkSpace(), TRIGGER_PARAM, buffer, strlen(buffer), TestTriggerExecute);
+        EXPECT_EQ(0, g_matchTrigger);
+        EXPECT_EQ(MarkTriggerToParam(GetTriggerWorkSpace(), GetTriggerHeader(TRIGGER_PARAM), param), 0);
+        return 0;
+    }
+
     // test for trigger aaaa:test_param.aaa 被加入unknown执行
     int TestCheckParamTrigger5()
     {
@@ -331,6 +379,39 @@ public:
     }
 
     // 普通的属性trigger
+    int TestCompileCondition()
+    {
+        const char *condition = "(test.compile.aaa=111||test.compile.aaa=222)&&test.compile.bbb=3*";
+        char prefix[triggerBuffer] = { 0 };
+        int ret = ConvertInfixToPrefix(condition, prefix, sizeof(prefix));
+        EXPECT_EQ(ret, 0);
+        ConditionCode *code = nullptr;
+        ret = CompileCondition(prefix, &code);
+        EXPECT_EQ(ret, 0);
+        if (code == nullptr) {
+            return -1;
+        }
+        EXPECT_EQ(code->count, 5); // 5 ops: 3 operands and 2 operators
+
+        LogicCalculator calculator;
+        CalculatorInit(&calculator, 0, 0, 1);
+        strcpy_s(calculator.inputName, SUPPORT_DATA_BUFFER_MAX, "test.compile.aaa");
+        strcpy_s(calculator.inputContent, SUPPORT_DATA_BUFFER_MAX, "222");
+        SystemWriteParam("test.compile.bbb", "123");
+        EXPECT_EQ(ComputeCondition(&calculator, code), 0);
+        SystemWriteParam("test.compile.bbb", "333");
+        EXPECT_EQ(ComputeCondition(&calculator, code), 1);
+        strcpy_s(calculator.inputContent, SUPPORT_DATA_BUFFER_MAX, "333");
+        EXPECT_EQ(ComputeCondition(&calculator, code), 0);
+        CalculatorFree(&calculator);
+        free(code);
+
+        code = nullptr;
+        EXPECT_NE(CompileCondition("test.compile.aaa=1 &", &code), 0);
+        EXPECT_EQ(code, nullptr);
+        return 0;
+    }
+
     int TestExecuteParamTrigger1()
     {
         const char *triggerName = "aaaa:test_param.eee";
@@ -482,6 +563,92 @@ public:
         return 0;
     }
 
+    int TestEventRing()
+    {
+        ParamTaskPtr eventTask = nullptr;
+        int ret = ParamEventTaskCreate(&eventTask, TestEventProcess, nullptr);
+        EXPECT_EQ(ret, 0);
+        g_eventCount = 0;
+        g_eventInOrder = true;
+        const uint64_t count = EVENT_SLOT_COUNT * 2;
+        char content[PARAM_CONST_VALUE_LEN_MAX] = { 0 };
+        for (uint64_t i = 0; i < count; i++) {
+            // every 8th event does not fit in a slot
+            uint32_t size = ((i % 8) == 0) ? EVENT_SLOT_CONTENT_MAX + 1 : 16;
+            (void)memset_s(content, sizeof(content), 'a' + (i % 26), size);
+            content[size] = '\0';
+            ret = ParamEventSend(eventTask, i, content, size);
+            EXPECT_EQ(ret, 0);
+        }
+        for (int i = 0; i < 10 && g_eventCount < count; i++) { // 10 max loop
+            uv_run(uv_default_loop(), UV_RUN_NOWAIT);
+        }
+        LibuvEventTask *task = (LibuvEventTask *)eventTask;
+        EXPECT_EQ(g_eventCount, count);
+        EXPECT_EQ(g_eventInOrder, true);
+        EXPECT_EQ(atomic_load(&task->stat.posted), count);
+        EXPECT_GE(atomic_load(&task->stat.overflowed), count / 8); // 8 every 8th event
+        EXPECT_EQ(atomic_load(&task->stat.dropped), 0);
+
+        // a slot claimed by a producer that has not filled it yet holds back the overflow list
+        g_eventCount = 0;
+        g_eventInOrder = true;
+        uint32_t claimed = atomic_fetch_add(&task->head, 1);
+        for (uint64_t i = 1; i <= EVENT_SLOT_COUNT; i++) { // the last one overflows
+            ret = ParamEventSend(eventTask, i, "event", strlen("event"));
+            EXPECT_EQ(ret, 0);
+        }
+        uv_run(uv_default_loop(), UV_RUN_NOWAIT);
+        EXPECT_EQ(g_eventCount, 0);
+        LibuvEventSlot *slot = &task->slots[claimed & (EVENT_SLOT_COUNT - 1)];
+        slot->eventId = 0;
+        slot->contentSize = strlen("event") + 1;
+        ret = strcpy_s(slot->content, sizeof(slot->content), "event");
+        EXPECT_EQ(ret, 0);
+        atomic_store(&slot->sequence, claimed + 1);
+        for (int i = 0; i < 10 && g_eventCount <= EVENT_SLOT_COUNT; i++) { // 10 max loop
+            uv_run(uv_default_loop(), UV_RUN_NOWAIT);
+        }
+        EXPECT_EQ(g_eventCount, EVENT_SLOT_COUNT + 1);
+        EXPECT_EQ(g_eventInOrder, true);
+        ParamTaskClose(eventTask);
+        uv_run(uv_default_loop(), UV_RUN_NOWAIT);
+        return 0;
+    }
+
+    int TestWaitTimeoutHeap()
+    {
+        ParamWatcher watcher = {};
+        ListInit(&watcher.node);
+        PARAM_TRIGGER_HEAD_INIT(watcher.triggerHead);
+        const uint32_t timeouts[] = { 5, 1, 4, 2, 3, 100 };
+        uint64_t start = GetTriggerTime();
+        for (uint32_t i = 0; i < sizeof(timeouts) / sizeof(timeouts[0]); i++) {
+            TriggerExtData extData = {};
+            extData.excuteCmd = TestWaitTimeoutCmd;
+            extData.watcherId = i;
+            extData.timeout = timeouts[i];
+            TriggerNode *trigger = AddWatcherTrigger(&watcher, TRIGGER_PARAM_WAIT, "test.wait.timeout", nullptr, &extData);
+            EXPECT_NE(trigger, nullptr);
+        }
+        // 已应答的等待从堆中移除
+        DelWatcherTrigger(&watcher, 2); // 2 timeout 4s
+        g_timeoutCount = 0;
+        uint64_t next = CheckWaitTriggerTimeout(GetTriggerWorkSpace(), start + 3500); // 3500ms
+        EXPECT_EQ(g_timeoutCount, 3); // 3 expired
+        EXPECT_EQ(g_timeoutOrder[0], 1);
+        EXPECT_EQ(g_timeoutOrder[1], 3);
+        EXPECT_EQ(g_timeoutOrder[2], 4); // 4 timeout 3s
+        EXPECT_GE(next, start + 5 * MS_UNIT); // 5s
+        CheckWaitTriggerTimeout(GetTriggerWorkSpace(), start + 50 * MS_UNIT); // 50s
+        EXPECT_EQ(g_timeoutCount, 4); // 4 expired
+        EXPECT_EQ(g_timeoutOrder[3], 0);
+        EXPECT_EQ(watcher.triggerHead.triggerCount, 1);
+        ClearWatcherTrigger(&watcher);
+        EXPECT_EQ(watcher.triggerHead.triggerCount, 0);
+        return 0;
+    }
+
     int TestDumpTrigger()
     {
         DumpTrigger(GetTriggerWorkSpace());
@@ -546,12 +713,30 @@ HWTEST_F(TriggerUnitTest, TestCheckParamTrigger5, TestSize.Level0)
     test.TestCheckParamTrigger5();
 }
 
+HWTEST_F(TriggerUnitTest, TestCheckParamTrigger6, TestSize.Level0)
+{
+    TriggerUnitTest test;
+    test.TestCheckParamTrigger6();
+}
+
 HWTEST_F(TriggerUnitTest, TestParamEvent, TestSize.Level0)
 {
     TriggerUnitTest test;
     test.TestParamEvent();
 }
 
+HWTEST_F(TriggerUnitTest, TestEventRing, TestSize.Level0)
+{
+    TriggerUnitTest test;
+    test.TestEventRing();
+}
+
+HWTEST_F(TriggerUnitTest, TestWaitTimeoutHeap, TestSize.Level0)
+{
+    TriggerUnitTest test;
+    test.TestWaitTimeoutHeap();
+}
+
 HWTEST_F(TriggerUnitTest, ComputerCondition, TestSize.Level0)
 {
     TriggerUnitTest test;
@@ -561,6 +746,12 @@ HWTEST_F(TriggerUnitTest, ComputerCondition, TestSize.Level0)
     test.TestComputeCondition("aaa=111||(aaa=222&&aaa=333)");
 }
 
+HWTEST_F(TriggerUnitTest, TestCompileCondition, TestSize.Level0)
+{
+    TriggerUnitTest test;
+    test.TestCompileCondition();
+}
+
 HWTEST_F(TriggerUnitTest, TestExecuteParamTrigger1, TestSize.Level0)
 {
     TriggerUnitTest test;